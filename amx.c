@@ -0,0 +1,226 @@
+/*
+ * CPUID
+ *
+ * A simple and small tool to dump/decode CPUID information.
+ *
+ * Copyright (c) 2010-2025, Steven Noonan <steven@uplinklabs.net>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "prefix.h"
+
+#include "amx.h"
+#include "isa.h"
+#include "state.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static void query(struct cpuid_state_t *state, struct cpu_regs_t *regs,
+                  uint32_t leaf, uint32_t subleaf)
+{
+	ZERO_REGS(regs);
+	regs->eax = leaf;
+	regs->ecx = subleaf;
+	state->cpuid_call(regs, state);
+}
+
+static const struct {
+	uint32_t mask;
+	const char *name;
+} amx_features[] = {
+	{ AMX_INT8,      "amx-int8" },
+	{ AMX_BF16,      "amx-bf16" },
+	{ AMX_COMPLEX,   "amx-complex" },
+	{ AMX_FP16,      "amx-fp16" },
+	{ AMX_FP8,       "amx-fp8" },
+	{ AMX_TRANSPOSE, "amx-transpose" },
+	{ AMX_TF32,      "amx-tf32" },
+	{ AMX_AVX512,    "amx-avx512" },
+	{ AMX_MOVRS,     "amx-movrs" },
+};
+
+const char *amx_feature_name(uint32_t bit)
+{
+	uint32_t i;
+	for (i = 0; i < NELEM(amx_features); i++)
+		if (amx_features[i].mask == (1u << bit))
+			return amx_features[i].name;
+	return NULL;
+}
+
+int amx_probe(struct cpuid_state_t *state, struct amx_info_t *info)
+{
+	struct cpu_regs_t regs;
+	uint32_t i, maxleaf, leaf7_edx;
+
+	memset(info, 0, sizeof(struct amx_info_t));
+
+	query(state, &regs, 0, 0);
+	maxleaf = regs.eax;
+	if (maxleaf < 7)
+		return 1;
+
+	query(state, &regs, 7, 0);
+	leaf7_edx = regs.edx;
+	if (!(leaf7_edx & 0x01000000))
+		return 1;
+
+	/* Older parts only have the leaf 7 flags for the data types. */
+	if (leaf7_edx & 0x02000000)
+		info->features |= AMX_INT8;
+	if (leaf7_edx & 0x00400000)
+		info->features |= AMX_BF16;
+	if (regs.eax >= 1) {
+		query(state, &regs, 7, 1);
+		if (regs.eax & 0x00200000)
+			info->features |= AMX_FP16;
+		if (regs.edx & 0x00000100)
+			info->features |= AMX_COMPLEX;
+	}
+
+	if (maxleaf >= 0x1D) {
+		query(state, &regs, 0x1D, 0);
+		info->palette_count = regs.eax;
+		if (info->palette_count > AMX_MAX_PALETTES)
+			info->palette_count = AMX_MAX_PALETTES;
+		for (i = 1; i <= info->palette_count; i++) {
+			struct amx_palette_t *p = &info->palettes[i];
+			query(state, &regs, 0x1D, i);
+			p->total_bytes = regs.eax & 0xffff;
+			p->bytes_per_tile = regs.eax >> 16;
+			p->bytes_per_row = regs.ebx & 0xffff;
+			p->max_names = regs.ebx >> 16;
+			p->max_rows = regs.ecx & 0xffff;
+		}
+	}
+
+	if (maxleaf >= 0x1E) {
+		uint32_t max;
+		query(state, &regs, 0x1E, 0);
+		max = regs.eax;
+		info->tmul_maxk = regs.ebx & 0xff;
+		info->tmul_maxn = (regs.ebx >> 8) & 0xffff;
+		if (max >= 1) {
+			query(state, &regs, 0x1E, 1);
+			info->features |= regs.eax & (AMX_INT8 | AMX_BF16 | AMX_COMPLEX | AMX_FP16 |
+			                              AMX_FP8 | AMX_TRANSPOSE | AMX_TF32 |
+			                              AMX_AVX512 | AMX_MOVRS);
+		}
+	}
+
+	return 0;
+}
+
+/* TDP* style operations: A and B elements of 'elem_bytes', accumulated into
+ * 32-bit C elements.
+ */
+static const struct {
+	uint32_t feature;
+	const char *name;
+	const char *acc;
+	uint32_t elem_bytes;
+} amx_types[] = {
+	{ AMX_INT8, "int8", "int32", 1 },
+	{ AMX_BF16, "bf16", "fp32",  2 },
+	{ AMX_FP16, "fp16", "fp32",  2 },
+	{ AMX_FP8,  "fp8",  "fp32",  1 },
+	{ AMX_TF32, "tf32", "fp32",  4 },
+};
+
+/* Picks how many C tiles to keep along M and N so that they, one A tile per
+ * row and one B tile per column all fit in the tile registers. The product
+ * is the data reuse, so it is maximized, preferring square blocks.
+ */
+static void pick_blocking(uint32_t names, uint32_t *m_tiles, uint32_t *n_tiles)
+{
+	uint32_t m, n;
+
+	*m_tiles = *n_tiles = 1;
+	for (m = 1; m < names; m++) {
+		for (n = 1; m * n + m + n <= names; n++) {
+			uint32_t best = *m_tiles * *n_tiles;
+			if (m * n > best ||
+			    (m * n == best && (m > n ? m - n : n - m) <
+			     (*m_tiles > *n_tiles ? *m_tiles - *n_tiles : *n_tiles - *m_tiles))) {
+				*m_tiles = m;
+				*n_tiles = n;
+			}
+		}
+	}
+}
+
+void amx_print_config(struct cpuid_state_t *state, const struct amx_info_t *info)
+{
+	const struct amx_palette_t *p = &info->palettes[1];
+	struct xsave_state_t xs;
+	struct isa_usable_t usable[16];
+	const char *status = isa_status_name(ISA_UNSUPPORTED);
+	uint32_t i, n, count, row_bytes, m_tiles, n_tiles;
+
+	xsave_probe(state, &xs);
+	count = isa_usable(state, &xs, usable, NELEM(usable));
+	for (i = 0; i < count; i++)
+		if (strcmp(usable[i].name, "AMX") == 0)
+			status = isa_status_name(usable[i].status);
+
+	printf("{\n  \"status\": \"%s\",\n  \"features\": [", status);
+	for (i = 0, n = 0; i < NELEM(amx_features); i++)
+		if (info->features & amx_features[i].mask)
+			printf("%s\"%s\"", n++ ? ", " : "", amx_features[i].name);
+	printf("],\n");
+
+	if (info->palette_count < 1 || !p->max_names || !p->max_rows) {
+		printf("  \"palette\": null\n}\n");
+		return;
+	}
+
+	printf("  \"palette\": 1,\n  \"tiles\": %u,\n  \"max_rows\": %u,\n  \"bytes_per_row\": %u,\n"
+	       "  \"bytes_per_tile\": %u,\n  \"tmul_maxk\": %u,\n  \"tmul_maxn\": %u,\n",
+	       p->max_names, p->max_rows, p->bytes_per_row, p->bytes_per_tile,
+	       info->tmul_maxk, info->tmul_maxn);
+
+	pick_blocking(p->max_names, &m_tiles, &n_tiles);
+	printf("  \"blocking\": { \"m_tiles\": %u, \"n_tiles\": %u, \"c_tiles\": %u, "
+	       "\"a_tiles\": %u, \"b_tiles\": %u },\n",
+	       m_tiles, n_tiles, m_tiles * n_tiles, m_tiles, n_tiles);
+
+	/* A C tile row is limited by the tile width and by TMUL's N; a B tile
+	 * has K / (4 / elem_bytes) rows, limited by TMUL's K.
+	 */
+	row_bytes = p->bytes_per_row;
+	if (info->tmul_maxn && info->tmul_maxn < row_bytes)
+		row_bytes = info->tmul_maxn;
+
+	printf("  \"types\": [");
+	for (i = 0, n = 0; i < NELEM(amx_types); i++) {
+		uint32_t tile_m, tile_n, tile_k;
+		if (!(info->features & amx_types[i].feature))
+			continue;
+		tile_m = p->max_rows;
+		tile_n = row_bytes / 4;
+		tile_k = p->bytes_per_row / amx_types[i].elem_bytes;
+		if (info->tmul_maxk && info->tmul_maxk * 4 / amx_types[i].elem_bytes < tile_k)
+			tile_k = info->tmul_maxk * 4 / amx_types[i].elem_bytes;
+		printf("%s\n    { \"type\": \"%s\", \"acc\": \"%s\", \"tile_m\": %u, \"tile_n\": %u, "
+		       "\"tile_k\": %u, \"block_m\": %u, \"block_n\": %u }",
+		       n++ ? "," : "", amx_types[i].name, amx_types[i].acc,
+		       tile_m, tile_n, tile_k, tile_m * m_tiles, tile_n * n_tiles);
+	}
+	printf("\n  ]\n}\n");
+}
+
+/* vim: set ts=4 sts=4 sw=4 noet: */
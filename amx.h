@@ -0,0 +1,74 @@
+/*
+ * CPUID
+ *
+ * A simple and small tool to dump/decode CPUID information.
+ *
+ * Copyright (c) 2010-2025, Steven Noonan <steven@uplinklabs.net>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef __amx_h
+#define __amx_h
+
+struct cpuid_state_t;
+
+/* AMX data type bits, as in leaf 0x1E subleaf 1 EAX. On processors without
+ * that subleaf they are filled in from the leaf 7 flags instead.
+ */
+#define AMX_INT8      0x0001
+#define AMX_BF16      0x0002
+#define AMX_COMPLEX   0x0004
+#define AMX_FP16      0x0008
+#define AMX_FP8       0x0010
+#define AMX_TRANSPOSE 0x0020
+#define AMX_TF32      0x0040
+#define AMX_AVX512    0x0080
+#define AMX_MOVRS     0x0100
+
+/* One tile palette, from leaf 0x1D subleaf N. */
+struct amx_palette_t {
+	uint32_t total_bytes;     /* all tile registers together */
+	uint32_t bytes_per_tile;
+	uint32_t bytes_per_row;
+	uint32_t max_names;       /* tile registers */
+	uint32_t max_rows;
+};
+
+#define AMX_MAX_PALETTES 8
+
+struct amx_info_t {
+	uint32_t palette_count;   /* highest palette; palette 0 is the init state */
+	struct amx_palette_t palettes[AMX_MAX_PALETTES + 1];
+	uint32_t tmul_maxk;       /* rows (K) a TMUL instruction handles */
+	uint32_t tmul_maxn;       /* column bytes (N) a TMUL instruction handles */
+	uint32_t features;        /* AMX_* */
+};
+
+/* Reads leaves 0x1D and 0x1E on the current CPU. Returns nonzero if the
+ * processor has no AMX-TILE.
+ */
+int amx_probe(struct cpuid_state_t *state, struct amx_info_t *info);
+
+/* Name of AMX_* bit 'bit' (e.g. "amx-int8"), or NULL. */
+const char *amx_feature_name(uint32_t bit);
+
+/* Prints the palette 1 tile shapes, per data type, and a GEMM blocking
+ * that fits the tile registers, as JSON.
+ */
+void amx_print_config(struct cpuid_state_t *state, const struct amx_info_t *info);
+
+#endif
+
+/* vim: set ts=4 sts=4 sw=4 noet: */
@@ -0,0 +1,277 @@
+/*
+ * CPUID
+ *
+ * A simple and small tool to dump/decode CPUID information.
+ *
+ * Copyright (c) 2010-2025, Steven Noonan <steven@uplinklabs.net>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "prefix.h"
+
+#include "bench.h"
+#include "clock.h"
+#include "state.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <string.h>
+
+struct bench_leaf_result_t {
+	uint32_t eax;
+	uint32_t ecx;
+	struct bench_stats_t stats;
+};
+
+struct bench_worker_t {
+	struct cpuid_state_t state;
+	struct cpu_timer_t timer;
+	timer_backend_t backend;
+	const struct cpuid_leaf_t *leaves;
+	struct bench_leaf_result_t *results;
+	uint32_t count;
+	uint32_t cpu;
+	uint32_t samples;
+	int failed;
+};
+
+static int cycles_compare(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+	return (x > y) - (x < y);
+}
+
+void bench_measure(struct cpuid_state_t *state, const struct cpu_timer_t *timer,
+                   uint32_t eax, uint32_t ecx,
+                   uint32_t samples, struct bench_stats_t *stats)
+{
+	uint64_t *cycles;
+	struct cpu_regs_t regs;
+	uint32_t i;
+
+	memset(stats, 0, sizeof(struct bench_stats_t));
+	if (!samples)
+		return;
+
+	cycles = (uint64_t *)malloc(sizeof(uint64_t) * samples);
+	if (!cycles)
+		return;
+
+	/* Warm up the caches and the hypervisor's exit path. */
+	for (i = 0; i < 16; i++) {
+		ZERO_REGS(&regs);
+		regs.eax = eax;
+		regs.ecx = ecx;
+		state->cpuid_call(&regs, state);
+	}
+
+	for (i = 0; i < samples; i++) {
+		uint64_t s, e;
+		ZERO_REGS(&regs);
+		regs.eax = eax;
+		regs.ecx = ecx;
+		s = timer_start(timer);
+		state->cpuid_call(&regs, state);
+		e = timer_stop(timer);
+		cycles[i] = timer_elapsed(timer, s, e);
+	}
+
+	qsort(cycles, samples, sizeof(uint64_t), cycles_compare);
+
+	stats->samples = samples;
+	stats->min = cycles[0];
+	stats->median = cycles[samples / 2];
+	stats->p99 = cycles[(samples * 99) / 100 < samples ? (samples * 99) / 100 : samples - 1];
+	stats->max = cycles[samples - 1];
+
+	free(cycles);
+}
+
+static void *bench_worker(void *ptr)
+{
+	struct bench_worker_t *worker = (struct bench_worker_t *)ptr;
+	uint32_t i;
+
+	if (worker->state.thread_bind(&worker->state, worker->cpu) != 0) {
+		worker->failed = 1;
+		return NULL;
+	}
+
+	/* Opened here, since a perf counter follows the opening thread. */
+	if (timer_open(&worker->timer, worker->backend, &worker->state) != 0) {
+		worker->failed = 2;
+		return NULL;
+	}
+
+	for (i = 0; i < worker->count; i++) {
+		worker->results[i].eax = worker->leaves[i].input.eax;
+		worker->results[i].ecx = worker->leaves[i].input.ecx;
+		bench_measure(&worker->state, &worker->timer,
+		              worker->results[i].eax, worker->results[i].ecx,
+		              worker->samples, &worker->results[i].stats);
+	}
+
+	timer_close(&worker->timer);
+	return NULL;
+}
+
+static void print_text(const struct bench_worker_t *worker, uint32_t nworkers)
+{
+	uint32_t w, i;
+	for (w = 0; w < nworkers; w++) {
+		printf("CPU %u:\n", worker[w].cpu);
+		if (worker[w].failed == 2) {
+			printf("  '%s' timer unavailable\n\n", timer_name(worker[w].backend));
+			continue;
+		}
+		if (worker[w].failed) {
+			printf("  failed to bind to CPU\n\n");
+			continue;
+		}
+		printf("  timer: %s, overhead %" PRIu64 " %s (subtracted)\n",
+		       timer_name(worker[w].timer.backend), worker[w].timer.overhead,
+		       timer_unit(&worker[w].timer));
+		printf("  %-8s %-7s %10s %10s %10s %10s\n",
+		       "Leaf", "Subleaf", "min", "median", "p99", "max");
+		for (i = 0; i < worker[w].count; i++) {
+			const struct bench_leaf_result_t *r = &worker[w].results[i];
+			printf("  %08x %-7u %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 "\n",
+			       r->eax, r->ecx,
+			       r->stats.min, r->stats.median, r->stats.p99, r->stats.max);
+		}
+		printf("\n");
+	}
+}
+
+static void print_csv(const struct bench_worker_t *worker, uint32_t nworkers)
+{
+	uint32_t w, i;
+	printf("cpu,timer,unit,leaf,subleaf,samples,min,median,p99,max\n");
+	for (w = 0; w < nworkers; w++) {
+		if (worker[w].failed)
+			continue;
+		for (i = 0; i < worker[w].count; i++) {
+			const struct bench_leaf_result_t *r = &worker[w].results[i];
+			printf("%u,%s,%s,0x%08x,%u,%u,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 "\n",
+			       worker[w].cpu, timer_name(worker[w].timer.backend),
+			       timer_unit(&worker[w].timer), r->eax, r->ecx, r->stats.samples,
+			       r->stats.min, r->stats.median, r->stats.p99, r->stats.max);
+		}
+	}
+}
+
+static void print_json(const struct bench_worker_t *worker, uint32_t nworkers, uint32_t samples)
+{
+	uint32_t w, i;
+	printf("{\n  \"samples\": %u,\n  \"cpus\": [", samples);
+	for (w = 0; w < nworkers; w++) {
+		printf("%s\n    {\n      \"cpu\": %u,\n", w ? "," : "", worker[w].cpu);
+		printf("      \"bound\": %s,\n", worker[w].failed == 1 ? "false" : "true");
+		printf("      \"timer\": \"%s\",\n", timer_name(worker[w].failed ? worker[w].backend : worker[w].timer.backend));
+		printf("      \"unit\": \"%s\",\n", timer_unit(&worker[w].timer));
+		printf("      \"overhead\": %" PRIu64 ",\n      \"leaves\": [", worker[w].timer.overhead);
+		for (i = 0; !worker[w].failed && i < worker[w].count; i++) {
+			const struct bench_leaf_result_t *r = &worker[w].results[i];
+			printf("%s\n        { \"leaf\": \"0x%08x\", \"subleaf\": %u, "
+			       "\"min\": %" PRIu64 ", \"median\": %" PRIu64 ", "
+			       "\"p99\": %" PRIu64 ", \"max\": %" PRIu64 " }",
+			       i ? "," : "", r->eax, r->ecx,
+			       r->stats.min, r->stats.median, r->stats.p99, r->stats.max);
+		}
+		printf("\n      ]\n    }");
+	}
+	printf("\n  ]\n}\n");
+}
+
+int bench_run(struct cpuid_state_t *state, const struct bench_options_t *opts)
+{
+	struct bench_worker_t *workers;
+	struct thread_t **threads;
+	uint32_t nworkers, w, ret = 0;
+
+	if (opts->cpu_end < opts->cpu_start)
+		return 1;
+
+	nworkers = opts->cpu_end - opts->cpu_start + 1;
+	workers = (struct bench_worker_t *)calloc(nworkers, sizeof(struct bench_worker_t));
+	threads = (struct thread_t **)calloc(nworkers, sizeof(struct thread_t *));
+	if (!workers || !threads) {
+		free(workers);
+		free(threads);
+		return 1;
+	}
+
+	for (w = 0; w < nworkers; w++) {
+		struct bench_worker_t *worker = &workers[w];
+		uint32_t cpu = opts->cpu_start + w;
+
+		/* Each worker gets a private state, since they may run in parallel. */
+		INIT_CPUID_STATE(&worker->state);
+		worker->state.cpuid_call = state->cpuid_call;
+		worker->cpu = cpu;
+		worker->samples = opts->samples;
+		worker->backend = opts->timer;
+		worker->timer.fd = -1;
+
+		/* Leaves were captured per CPU; fall back to CPU 0's list. */
+		if (state->cpuid_leaves && cpu < state->cpu_logical_count && state->cpuid_leaves[cpu])
+			worker->leaves = state->cpuid_leaves[cpu];
+		else if (state->cpuid_leaves)
+			worker->leaves = state->cpuid_leaves[0];
+
+		while (worker->leaves && worker->leaves[worker->count].input.eax != 0xFFFFFFFF)
+			worker->count++;
+
+		worker->results = (struct bench_leaf_result_t *)calloc(worker->count + 1, sizeof(struct bench_leaf_result_t));
+		assert(worker->results);
+	}
+
+	for (w = 0; w < nworkers; w++) {
+		threads[w] = thread_spawn(bench_worker, &workers[w]);
+		if (!threads[w])
+			workers[w].failed = 1;
+		if (!opts->parallel) {
+			thread_join(threads[w]);
+			threads[w] = NULL;
+		}
+	}
+	for (w = 0; w < nworkers; w++)
+		thread_join(threads[w]);
+
+	switch (opts->output) {
+	case BENCH_OUTPUT_TEXT:
+		print_text(workers, nworkers);
+		break;
+	case BENCH_OUTPUT_CSV:
+		print_csv(workers, nworkers);
+		break;
+	case BENCH_OUTPUT_JSON:
+		print_json(workers, nworkers, opts->samples);
+		break;
+	}
+
+	for (w = 0; w < nworkers; w++) {
+		if (workers[w].failed)
+			ret = 1;
+		free(workers[w].results);
+		FREE_CPUID_STATE(&workers[w].state);
+	}
+	free(workers);
+	free(threads);
+
+	return ret;
+}
+
+/* vim: set ts=4 sts=4 sw=4 noet: */
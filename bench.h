@@ -0,0 +1,67 @@
+/*
+ * CPUID
+ *
+ * A simple and small tool to dump/decode CPUID information.
+ *
+ * Copyright (c) 2010-2025, Steven Noonan <steven@uplinklabs.net>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef __bench_h
+#define __bench_h
+
+#include "clock.h"
+
+struct cpuid_state_t;
+
+typedef enum {
+	BENCH_OUTPUT_TEXT = 0,
+	BENCH_OUTPUT_CSV,
+	BENCH_OUTPUT_JSON
+} bench_output_t;
+
+struct bench_options_t {
+	bench_output_t output;
+	uint32_t samples;
+	uint32_t cpu_start;
+	uint32_t cpu_end;
+	timer_backend_t timer;
+	unsigned parallel:1;
+};
+
+struct bench_stats_t {
+	uint32_t samples;
+	uint64_t min;
+	uint64_t median;
+	uint64_t p99;
+	uint64_t max;
+};
+
+/* Times 'samples' individual CPUID calls of (eax, ecx) on whatever CPU the
+ * calling thread is bound to. Results are in the timer's units, with the
+ * timer's own overhead already subtracted.
+ */
+void bench_measure(struct cpuid_state_t *state, const struct cpu_timer_t *timer,
+                   uint32_t eax, uint32_t ecx,
+                   uint32_t samples, struct bench_stats_t *stats);
+
+/* Benchmarks every leaf captured in state->cpuid_leaves on the CPUs in
+ * [cpu_start, cpu_end], and prints the results.
+ */
+int bench_run(struct cpuid_state_t *state, const struct bench_options_t *opts);
+
+#endif
+
+/* vim: set ts=4 sts=4 sw=4 noet: */
@@ -34,6 +34,11 @@ struct cache_desc_index_t {
 	struct cache_desc_t desc;
 };
 
+struct cache_desc_span_t {
+	uint8_t first;
+	uint8_t count;
+};
+
 #define MB * 1024
 static const struct cache_desc_index_t descs[] = {
 	{ 0x01, {NO, CODE_TLB,    32, PAGES_4K, 0x04, 0, 0, 0} },
@@ -67,7 +72,7 @@ static const struct cache_desc_index_t descs[] = {
 	{ 0x3c, {L2, UNIFIED,    256, SECTORED, 0x04, 64, 0, 0} },
 	{ 0x3d, {L2, UNIFIED,    384, SECTORED, 0x06, 64, 0, 0} },
 	{ 0x3e, {L2, UNIFIED,    512, SECTORED, 0x04, 64, 0, 0} },
-	{ 0x40, {INVALID_LEVEL, INVALID_TYPE, 0, 0, 0, 0, 0, 0} }, /* Special case, see create_description() */
+	{ 0x40, {INVALID_LEVEL, INVALID_TYPE, 0, 0, 0, 0, 0, 0} }, /* Special case, see describe_descriptor() */
 	{ 0x41, {L2, UNIFIED,    128, NONE, 0x04, 32, 0, 0} },
 	{ 0x42, {L2, UNIFIED,    256, NONE, 0x04, 32, 0, 0} },
 	{ 0x43, {L2, UNIFIED,    512, NONE, 0x04, 32, 0, 0} },
@@ -165,35 +170,71 @@ static const struct cache_desc_index_t descs[] = {
 	{ 0xec, {L3, UNIFIED,  24 MB, NONE, 0x18, 64, 0, 0} },
 
 	/* Special cases, not described in this table, but handled in the
-	 * create_description() function. */
+	 * describe_descriptor() function. */
 	{ 0xf0, {INVALID_LEVEL, INVALID_TYPE, 0, 0, 0, 0, 0, 0} },
 	{ 0xf1, {INVALID_LEVEL, INVALID_TYPE, 0, 0, 0, 0, 0, 0} },
 	{ 0xfe, {INVALID_LEVEL, INVALID_TYPE, 0, 0, 0, 0, 0, 0} },
 	{ 0xff, {INVALID_LEVEL, INVALID_TYPE, 0, 0, 0, 0, 0, 0} },
-
-	{ 0x00, {INVALID_LEVEL, INVALID_TYPE, 0, 0, 0, 0, 0, 0} }
 };
 static const struct cache_desc_index_t descriptor_49[] = {
 	{ 0x49, {L2, UNIFIED,  4 MB, NONE, 0x10, 64, 0, 0} },
 	{ 0x49, {L3, UNIFIED,  4 MB, NONE, 0x10, 64, 0, 0} }
 };
+
+/* For each descriptor byte, where its entries start in descs[] and how many
+ * there are. Generated from descs[] by tools/desc_index.pl, which has to be
+ * rerun after any edit to descs[]; 'make check' fails while it is stale.
+ */
+static const struct cache_desc_span_t desc_index[256] = {
+	/* 0x00 */ {   0, 0 }, {   0, 1 }, {   1, 1 }, {   2, 1 }, {   3, 1 }, {   4, 1 }, {   5, 1 }, {   0, 0 },
+	/* 0x08 */ {   6, 1 }, {   7, 1 }, {   8, 1 }, {   9, 1 }, {  10, 1 }, {  11, 1 }, {  12, 1 }, {   0, 0 },
+	/* 0x10 */ {  13, 1 }, {   0, 0 }, {   0, 0 }, {   0, 0 }, {   0, 0 }, {  14, 1 }, {   0, 0 }, {   0, 0 },
+	/* 0x18 */ {   0, 0 }, {   0, 0 }, {  15, 1 }, {   0, 0 }, {   0, 0 }, {  16, 1 }, {   0, 0 }, {   0, 0 },
+	/* 0x20 */ {   0, 0 }, {  17, 1 }, {  18, 1 }, {  19, 1 }, {  20, 1 }, {  21, 1 }, {   0, 0 }, {   0, 0 },
+	/* 0x28 */ {   0, 0 }, {  22, 1 }, {   0, 0 }, {   0, 0 }, {  23, 1 }, {   0, 0 }, {   0, 0 }, {   0, 0 },
+	/* 0x30 */ {  24, 1 }, {   0, 0 }, {   0, 0 }, {   0, 0 }, {   0, 0 }, {   0, 0 }, {   0, 0 }, {   0, 0 },
+	/* 0x38 */ {   0, 0 }, {  25, 1 }, {  26, 1 }, {  27, 1 }, {  28, 1 }, {  29, 1 }, {  30, 1 }, {   0, 0 },
+	/* 0x40 */ {  31, 1 }, {  32, 1 }, {  33, 1 }, {  34, 1 }, {  35, 1 }, {  36, 1 }, {  37, 1 }, {  38, 1 },
+	/* 0x48 */ {  39, 1 }, {   0, 0 }, {  40, 1 }, {  41, 1 }, {  42, 1 }, {  43, 1 }, {  44, 1 }, {  45, 1 },
+	/* 0x50 */ {  46, 1 }, {  47, 1 }, {  48, 1 }, {   0, 0 }, {   0, 0 }, {  49, 1 }, {  50, 1 }, {  51, 1 },
+	/* 0x58 */ {   0, 0 }, {  52, 1 }, {  53, 1 }, {  54, 1 }, {  55, 1 }, {  56, 1 }, {   0, 0 }, {   0, 0 },
+	/* 0x60 */ {  57, 1 }, {  58, 1 }, {   0, 0 }, {  59, 2 }, {  61, 1 }, {   0, 0 }, {  62, 1 }, {  63, 1 },
+	/* 0x68 */ {  64, 1 }, {   0, 0 }, {  65, 1 }, {  66, 1 }, {  67, 1 }, {  68, 1 }, {   0, 0 }, {   0, 0 },
+	/* 0x70 */ {  69, 1 }, {  70, 1 }, {  71, 1 }, {  72, 1 }, {   0, 0 }, {   0, 0 }, {  73, 1 }, {  74, 1 },
+	/* 0x78 */ {  75, 1 }, {  76, 1 }, {  77, 1 }, {  78, 1 }, {  79, 1 }, {  80, 1 }, {  81, 1 }, {  82, 1 },
+	/* 0x80 */ {  83, 1 }, {  84, 1 }, {  85, 1 }, {  86, 1 }, {  87, 1 }, {  88, 1 }, {  89, 1 }, {  90, 1 },
+	/* 0x88 */ {  91, 1 }, {  92, 1 }, {  93, 1 }, {   0, 0 }, {   0, 0 }, {  94, 1 }, {   0, 0 }, {   0, 0 },
+	/* 0x90 */ {   0, 0 }, {   0, 0 }, {   0, 0 }, {   0, 0 }, {   0, 0 }, {   0, 0 }, {   0, 0 }, {   0, 0 },
+	/* 0x98 */ {   0, 0 }, {   0, 0 }, {   0, 0 }, {   0, 0 }, {   0, 0 }, {   0, 0 }, {   0, 0 }, {   0, 0 },
+	/* 0xa0 */ {  95, 1 }, {   0, 0 }, {   0, 0 }, {   0, 0 }, {   0, 0 }, {   0, 0 }, {   0, 0 }, {   0, 0 },
+	/* 0xa8 */ {   0, 0 }, {   0, 0 }, {   0, 0 }, {   0, 0 }, {   0, 0 }, {   0, 0 }, {   0, 0 }, {   0, 0 },
+	/* 0xb0 */ {  96, 1 }, {  97, 2 }, {  99, 1 }, { 100, 1 }, { 101, 1 }, { 102, 1 }, { 103, 1 }, {   0, 0 },
+	/* 0xb8 */ {   0, 0 }, {   0, 0 }, { 104, 1 }, {   0, 0 }, {   0, 0 }, {   0, 0 }, {   0, 0 }, {   0, 0 },
+	/* 0xc0 */ { 105, 1 }, { 106, 1 }, { 107, 1 }, { 108, 2 }, { 110, 1 }, {   0, 0 }, {   0, 0 }, {   0, 0 },
+	/* 0xc8 */ {   0, 0 }, {   0, 0 }, { 111, 1 }, {   0, 0 }, {   0, 0 }, {   0, 0 }, {   0, 0 }, {   0, 0 },
+	/* 0xd0 */ { 112, 1 }, { 113, 1 }, { 114, 1 }, {   0, 0 }, {   0, 0 }, {   0, 0 }, { 115, 1 }, { 116, 1 },
+	/* 0xd8 */ { 117, 1 }, {   0, 0 }, {   0, 0 }, {   0, 0 }, { 118, 1 }, { 119, 1 }, { 120, 1 }, {   0, 0 },
+	/* 0xe0 */ {   0, 0 }, {   0, 0 }, { 121, 1 }, { 122, 1 }, { 123, 1 }, {   0, 0 }, {   0, 0 }, {   0, 0 },
+	/* 0xe8 */ {   0, 0 }, {   0, 0 }, { 124, 1 }, { 125, 1 }, { 126, 1 }, {   0, 0 }, {   0, 0 }, {   0, 0 },
+	/* 0xf0 */ { 127, 1 }, { 128, 1 }, {   0, 0 }, {   0, 0 }, {   0, 0 }, {   0, 0 }, {   0, 0 }, {   0, 0 },
+	/* 0xf8 */ {   0, 0 }, {   0, 0 }, {   0, 0 }, {   0, 0 }, {   0, 0 }, {   0, 0 }, { 129, 1 }, { 130, 1 }
+};
 #undef MB
 
 #define DELIM() { \
-		if (rem_types >= 2 && num_types >= 3) { \
-			safe_strcat(buffer, ", ", sizeof(buffer)); \
+		if (rem_types < num_types && rem_types >= 2 && num_types >= 3) { \
+			safe_strcat(buffer, ", ", bufsize); \
 		} else if (num_types >= 2 && rem_types < num_types) { \
-			safe_strcat(buffer, " or ", sizeof(buffer)); \
+			safe_strcat(buffer, " or ", bufsize); \
 		} \
 	}
 #define ADD_TYPE(type) { \
-		safe_strcat(buffer, type, sizeof(buffer)); \
+		safe_strcat(buffer, type, bufsize); \
 		rem_types--; \
 	}
-static const char *page_types(uint32_t attrs)
+static const char *page_types(char *buffer, size_t bufsize, uint32_t attrs)
 {
 	uint32_t num_types, rem_types;
-	static char buffer[48];
 
 	buffer[0] = 0;
 
@@ -220,7 +261,7 @@ static const char *page_types(uint32_t attrs)
 		ADD_TYPE("1GB");
 	}
 
-	strcat(buffer, " pages");
+	safe_strcat(buffer, " pages", bufsize);
 	return buffer;
 }
 #undef DELIM
@@ -243,9 +284,8 @@ static const char *type(cache_type_t type)
 	return NULL;
 }
 
-static const char *level(cache_level_t level)
+static const char *level(char *buffer, cache_level_t level)
 {
-	static char buffer[8];
 	buffer[0] = 0;
 	if (level == INVALID_LEVEL || level > LMAX)
 		return NULL;
@@ -255,9 +295,8 @@ static const char *level(cache_level_t level)
 	return buffer;
 }
 
-static const char *associativity(uint8_t assoc)
+static const char *associativity(char *buffer, uint8_t assoc)
 {
-	static char buffer[32];
 	switch(assoc) {
 	case 0x00:
 		return "unknown associativity";
@@ -270,9 +309,8 @@ static const char *associativity(uint8_t assoc)
 	return buffer;
 }
 
-static const char *size(uint32_t size)
+static const char *size(char *buffer, uint32_t size)
 {
-	static char buffer[16];
 	if (size >= 1024) {
 		sprintf(buffer, "%dMB", size / 1024);
 	} else {
@@ -288,7 +326,7 @@ static const char *size(uint32_t size)
 
 char *describe_cache(uint32_t ncpus, const struct cache_desc_t *desc, char *buffer, size_t bufsize, int indent)
 {
-	char temp[64], temp1[32];
+	char temp[64], temp1[32], pagebuf[48], levelbuf[8], sizebuf[16], assocbuf[32];
 	uint32_t instances = 0;
 
 	buffer[0] = 0;
@@ -309,14 +347,14 @@ char *describe_cache(uint32_t ncpus, const struct cache_desc_t *desc, char *buff
 	case STOREONLY_TLB:
 		/* e.g. "Code TLB: 2MB or 4MB pages" */
 		if (desc->level != NO) {
-			sprintf(temp1, "%s %s", level(desc->level), type(desc->type));
+			sprintf(temp1, "%s %s", level(levelbuf, desc->level), type(desc->type));
 			ADD_LINE("%17s: %s",
 				temp1,
-				page_types(desc->attrs));
+				page_types(pagebuf, sizeof(pagebuf), desc->attrs));
 		} else {
 			ADD_LINE("%17s: %s",
 				type(desc->type),
-				page_types(desc->attrs));
+				page_types(pagebuf, sizeof(pagebuf), desc->attrs));
 		}
 		indent += 19;
 		break;
@@ -327,15 +365,15 @@ char *describe_cache(uint32_t ncpus, const struct cache_desc_t *desc, char *buff
 			/* e.g. "16 x 32KB L1 data cache" */
 			ADD_LINE("%2d x %5s %s %s",
 				instances,
-				size(desc->size),
-				level(desc->level),
+				size(sizebuf, desc->size),
+				level(levelbuf, desc->level),
 				type(desc->type));
 			indent += 11;
 		} else {
 			/* e.g. "32KB L1 data cache" */
 			ADD_LINE("%5s %s %s",
-				size(desc->size),
-				level(desc->level),
+				size(sizebuf, desc->size),
+				level(levelbuf, desc->level),
 				type(desc->type));
 			indent += 6;
 		}
@@ -351,7 +389,7 @@ char *describe_cache(uint32_t ncpus, const struct cache_desc_t *desc, char *buff
 
 	if (desc->assoc != 0) {
 		/* e.g. "8-way set associative" */
-		ADD_LINE("%s", associativity(desc->assoc));
+		ADD_LINE("%s", associativity(assocbuf, desc->assoc));
 	}
 
 	if (desc->attrs & SECTORED) {
@@ -371,6 +409,8 @@ char *describe_cache(uint32_t ncpus, const struct cache_desc_t *desc, char *buff
 	case DATA_TLB:
 	case CODE_TLB:
 	case SHARED_TLB:
+	case LOADONLY_TLB:
+	case STOREONLY_TLB:
 		ADD_LINE("%d entries", desc->size);
 		break;
 	default:
@@ -409,63 +449,67 @@ char *describe_cache(uint32_t ncpus, const struct cache_desc_t *desc, char *buff
 }
 #undef ADD_LINE
 
-static char *create_description(const struct cache_desc_index_t *idx)
+static const char *describe_descriptor(const struct cache_desc_index_t *idx, char *buffer, size_t bufsize)
 {
-	const struct cache_desc_t *desc = &idx->desc;
-	char buffer[256];
-
-#if 0
-	/* For debugging */
-	sprintf(buffer, "0x%02x: ", idx->descriptor);
-#endif
-
 	/* Special cases. */
 	switch(idx->descriptor) {
-	case 0x40: return strdup("  No L2 cache, or if L2 cache exists, no L3 cache");
-	case 0xF0: return strdup("  64-byte prefetching");
-	case 0xF1: return strdup("  128-byte prefetching");
-	case 0xFE: return strdup("  [NOTICE] For TLB data, see Deterministic Address Translation leaf instead");
-	case 0xFF: return strdup("  [NOTICE] For cache data, see Deterministic Cache Parameters leaf instead");
+	case 0x40: return "  No L2 cache, or if L2 cache exists, no L3 cache";
+	case 0xF0: return "  64-byte prefetching";
+	case 0xF1: return "  128-byte prefetching";
+	case 0xFE: return "  [NOTICE] For TLB data, see Deterministic Address Translation leaf instead";
+	case 0xFF: return "  [NOTICE] For cache data, see Deterministic Cache Parameters leaf instead";
 	}
 
-	describe_cache(0, desc, buffer, sizeof(buffer), 2);
-	return strdup(buffer);
+	return describe_cache(0, &idx->desc, buffer, bufsize, 2);
 }
 
-static int entry_comparator(const void *a, const void *b)
+/* Notices go first and prefetch sizes last, with the caches and TLBs
+ * between them ordered by level and then type.
+ */
+static int entry_rank(const struct cache_desc_index_t *idx)
 {
-	const char *stra = *(const char **)a;
-	const char *strb = *(const char **)b;
-
-	/* Make notices appear first. */
-	if ((stra)[strspn(stra, " ")] == '[') return -1;
-	if ((strb)[strspn(strb, " ")] == '[') return 1;
-
-	/* Make 'prefetching' lines show last. */
-	if (strstr(*(const char **)a, "prefetch")) return 1;
-	if (strstr(*(const char **)b, "prefetch")) return -1;
-
-	/* Simple string compare. */
-	return strcmp(*(const char **)a, *(const char **)b);
+	switch(idx->descriptor) {
+	case 0xFE:
+	case 0xFF: return 0;
+	case 0xF0:
+	case 0xF1: return 2;
+	}
+	return 1;
 }
 
-#define MAX_ENTRIES 32
-void print_intel_caches(struct cpu_regs_t *regs, const struct cpu_signature_t *sig)
+static int entry_compare(const struct cache_desc_index_t *a, const struct cache_desc_index_t *b)
 {
-	uint8_t buf[16] ALIGNED(4);
-	uint8_t last_descriptor = 0;
-	uint32_t i;
+	int ra = entry_rank(a), rb = entry_rank(b);
+	if (ra != rb)
+		return ra - rb;
+	if (a->desc.level != b->desc.level)
+		return (int)a->desc.level - (int)b->desc.level;
+	if (a->desc.type != b->desc.type)
+		return (int)a->desc.type - (int)b->desc.type;
+	return (int)a->descriptor - (int)b->descriptor;
+}
 
-	/* It's only possible to have 16 entries on a single line, but some
-	 * descriptors have two descriptions tied to them, so support up to 32
-	 * strings for a single line.
-	 */
-	char *entries[MAX_ENTRIES + 1];
-	char **eptr = entries;
+/* Returns the entries for one descriptor byte, and how many there are. */
+static const struct cache_desc_index_t *lookup_descriptor(uint8_t descriptor, uint32_t *count)
+{
+	const struct cache_desc_span_t *span = &desc_index[descriptor];
 
-	entries[MAX_ENTRIES] = 0;
+	*count = span->count;
+	if (!span->count)
+		return NULL;
+	assert(span->first + span->count <= NELEM(descs));
+	assert(descs[span->first].descriptor == descriptor);
+	assert(descs[span->first + span->count - 1].descriptor == descriptor);
+	return &descs[span->first];
+}
 
-	memset(buf, 0, sizeof(buf));
+/* Unpacks the descriptor bytes of a leaf 2 register set. The low byte of
+ * EAX is the iteration count rather than a descriptor, and a register with
+ * bit 31 set holds no valid descriptors.
+ */
+static void descriptor_bytes(const struct cpu_regs_t *regs, uint8_t *buf)
+{
+	memset(buf, 0, 16);
 
 	*(uint32_t *)&buf[0x0] = regs->eax >> 8;
 	if ((regs->ebx & (1U << 31)) == 0)
@@ -474,10 +518,144 @@ void print_intel_caches(struct cpu_regs_t *regs, const struct cpu_signature_t *s
 		*(uint32_t *)&buf[0x8] = regs->ecx;
 	if ((regs->edx & (1U << 31)) == 0)
 		*(uint32_t *)&buf[0xC] = regs->edx;
+}
+
+uint32_t decode_intel_caches(const struct cpu_regs_t *regs, const struct cpu_signature_t *sig,
+                             struct cache_desc_t *out, uint32_t max, uint32_t *prefetch)
+{
+	uint8_t buf[16] ALIGNED(4);
+	uint32_t i, j, n, count = 0;
+
+	if (prefetch)
+		*prefetch = 0;
+
+	descriptor_bytes(regs, buf);
+
+	for (i = 0; i <= 0xF; i++) {
+		const struct cache_desc_index_t *d;
+
+		if (buf[i] == 0)
+			continue;
+
+		switch (buf[i]) {
+		case 0xF0:
+			if (prefetch)
+				*prefetch = 64;
+			continue;
+		case 0xF1:
+			if (prefetch)
+				*prefetch = 128;
+			continue;
+		case 0x49:
+			/* Same special case as in print_intel_caches(). */
+			if (count < max)
+				out[count++] = (sig->family == 0x0F && sig->model == 0x06) ?
+				               descriptor_49[1].desc : descriptor_49[0].desc;
+			continue;
+		}
+
+		d = lookup_descriptor(buf[i], &n);
+		for (j = 0; j < n; j++) {
+			if (d[j].desc.level == INVALID_LEVEL)
+				continue;
+			if (count < max)
+				out[count++] = d[j].desc;
+		}
+	}
+
+	return count;
+}
+
+int decode_intel_tlb(const struct cpu_regs_t *regs, struct cache_desc_t *desc)
+{
+	static const cache_type_t types[] = {
+		INVALID_TYPE, DATA_TLB, CODE_TLB, SHARED_TLB, LOADONLY_TLB, STOREONLY_TLB
+	};
+	struct ebx_tlb_t {
+		unsigned has_4k_pages:1;
+		unsigned has_2m_pages:1;
+		unsigned has_4m_pages:1;
+		unsigned has_1g_pages:1;
+		unsigned reserved:4;
+		unsigned partitioning:3; /* 0: soft partitioning between logical processors sharing this structure */
+		unsigned reserved_1:5;
+		unsigned ways:16;
+	};
+	struct edx_tlb_t {
+		unsigned type:5;
+		unsigned level:3;
+		unsigned fully_assoc:1;
+		unsigned reserved:5;
+		unsigned max_threads_sharing:12; /* +1 encoded */
+		unsigned reserved_1:6;
+	};
+	const struct ebx_tlb_t *ebx = (const struct ebx_tlb_t *)&regs->ebx;
+	const struct edx_tlb_t *edx = (const struct edx_tlb_t *)&regs->edx;
+
+	memset(desc, 0, sizeof(struct cache_desc_t));
+	if (edx->type == 0 || edx->type >= NELEM(types))
+		return 1;
+
+	desc->type = types[edx->type];
+	desc->level = (cache_level_t)edx->level;
+	if (ebx->has_4k_pages)
+		desc->attrs |= PAGES_4K;
+	if (ebx->has_2m_pages)
+		desc->attrs |= PAGES_2M;
+	if (ebx->has_4m_pages)
+		desc->attrs |= PAGES_4M;
+	if (ebx->has_1g_pages)
+		desc->attrs |= PAGES_1G;
+
+	/* ECX is the number of sets; a fully associative TLB has one. */
+	desc->size = ebx->ways * regs->ecx;
+	desc->assoc = (edx->fully_assoc || ebx->ways > 0xFE) ? 0xFF : ebx->ways;
+	desc->partitions = ebx->partitioning;
+	desc->max_threads_sharing = edx->max_threads_sharing + 1;
+	return 0;
+}
+
+static const uint8_t amd_assoc_map[] = {
+	/* 0x00 */ 0,
+	/* 0x01 */ 1,
+	/* 0x02 */ 2,
+	/* 0x03 */ 0,
+	/* 0x04 */ 4,
+	/* 0x05 */ 0,
+	/* 0x06 */ 8,
+	/* 0x07 */ 0,
+	/* 0x08 */ 16,
+	/* 0x09 */ 0,
+	/* 0x0A */ 32,
+	/* 0x0B */ 48,
+	/* 0x0C */ 64,
+	/* 0x0D */ 96,
+	/* 0x0E */ 128,
+	/* 0x0F */ 0xff
+};
+
+uint8_t amd_assoc_ways(uint32_t code)
+{
+	return code < NELEM(amd_assoc_map) ? amd_assoc_map[code] : 0;
+}
+
+#define MAX_ENTRIES 32
+void print_intel_caches(struct cpu_regs_t *regs, const struct cpu_signature_t *sig)
+{
+	uint8_t buf[16] ALIGNED(4);
+	uint8_t last_descriptor = 0;
+	uint32_t i, j, n, count = 0;
+	char buffer[256];
+
+	/* It's only possible to have 16 descriptors on a single line, but some
+	 * descriptors have two entries tied to them, so support up to 32
+	 * entries for a single line.
+	 */
+	const struct cache_desc_index_t *entries[MAX_ENTRIES];
+
+	descriptor_bytes(regs, buf);
 
 	for (i = 0; i <= 0xF; i++) {
-		BOOL found_match = FALSE;
-		char *desc = NULL;
 		const struct cache_desc_index_t *d;
 
 		if (buf[i] == 0)
@@ -494,51 +672,33 @@ void print_intel_caches(struct cpu_regs_t *regs, const struct cpu_signature_t *s
 			 * Family 0Fh, Model 06h, while it's a L2 cache
 			 * on everything else.
 			 */
-			*eptr++ = (sig->family == 0x0F && sig->model == 0x06) ?
-					  create_description(&descriptor_49[1]) :
-					  create_description(&descriptor_49[0]);
+			entries[count++] = (sig->family == 0x0F && sig->model == 0x06) ?
+					   &descriptor_49[1] : &descriptor_49[0];
 			continue;
 		}
 
-		for(d = descs; d->descriptor; d++) {
-			/* Descriptor table is ordered, and may have multiple entries for
-			 * a specific identifier.
-			 */
-			if (d->descriptor > buf[i])
-				break;
-			if (d->descriptor < buf[i])
-				continue;
-
-			found_match = TRUE;
-
-			desc = create_description(d);
-
-			*eptr++ = desc;
-		}
-
-		if (!found_match) {
-			/* This one we can just print right away. Its exact string
-			   will vary, and we wouldn't know how to sort it anyway. */
+		d = lookup_descriptor(buf[i], &n);
+		if (!n) {
+			/* This one we can just print right away. We wouldn't know
+			   how to sort it anyway. */
 			printf("  Unknown cache descriptor (0x%02x)\n", buf[i]);
+			continue;
 		}
-	}
-
-	i = (uint32_t)(eptr - entries);
 
-	for(; eptr < &entries[MAX_ENTRIES]; eptr++) {
-		*eptr = 0;
+		for (j = 0; j < n && count < MAX_ENTRIES; j++)
+			entries[count++] = &d[j];
 	}
 
-	/* Sort alphabetically. Makes it a heck of a lot easier to read. */
-	qsort(entries, i, sizeof(const char *), entry_comparator);
-
-	/* Print the entries. */
-	eptr = entries;
-	while (*eptr) {
-		printf("%s\n", *eptr);
-		free(*eptr);
-		eptr++;
+	/* Insertion sort; there are never more than a few dozen entries. */
+	for (i = 1; i < count; i++) {
+		const struct cache_desc_index_t *e = entries[i];
+		for (j = i; j > 0 && entry_compare(entries[j - 1], e) > 0; j--)
+			entries[j] = entries[j - 1];
+		entries[j] = e;
 	}
+
+	for (i = 0; i < count; i++)
+		printf("%s\n", describe_descriptor(entries[i], buffer, sizeof(buffer)));
 	printf("\n");
 }
 
@@ -80,6 +80,25 @@ struct cache_desc_t {
 
 char *describe_cache(uint32_t ncpus, const struct cache_desc_t *desc, char *buffer, size_t bufsize, int indent);
 
+/* Stores the caches and TLBs named by the descriptor bytes of a leaf 2
+ * register set in 'out', up to 'max' entries, and returns how many were
+ * stored. If 'prefetch' is non-NULL it receives the prefetch size in bytes
+ * given by descriptor 0xF0 or 0xF1, or 0 if neither is present.
+ */
+uint32_t decode_intel_caches(const struct cpu_regs_t *regs, const struct cpu_signature_t *sig,
+                             struct cache_desc_t *out, uint32_t max, uint32_t *prefetch);
+
+/* Decodes one leaf 0x18 subleaf into 'desc', with 'size' in entries.
+ * Returns nonzero if the subleaf describes no TLB, or one of a type not
+ * listed in cache_type_t.
+ */
+int decode_intel_tlb(const struct cpu_regs_t *regs, struct cache_desc_t *desc);
+
+/* Ways for the 4-bit associativity field of AMD leaves 0x80000006 and
+ * 0x80000019, 0xFF meaning fully associative.
+ */
+uint8_t amd_assoc_ways(uint32_t code);
+
 #endif
 
 /* vim: set ts=4 sts=4 sw=4 noet: */
@@ -21,15 +21,27 @@
 
 #include "prefix.h"
 #include "clock.h"
+#include "cpuid.h"
+#include "state.h"
 
 #include <math.h>
+#include <string.h>
 #include <time.h>
 
 #ifdef TARGET_OS_MACOSX
 #include <mach/mach_time.h>
 #endif
 
-static uint32_t cycles_per_usec;
+#include <stdio.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static uint64_t tsc_khz;
+static const char *tsc_khz_source;
 
 static uint64_t wallclock_ns(void)
 {
@@ -79,7 +91,7 @@ static uint32_t get_cycles_per_usec(void)
 
 #define NR_TIME_ITERS 10
 
-static void calibrate_cpu_clock(void)
+static uint64_t calibrate_cpu_clock(void)
 {
 	double delta, mean, S;
 	uint32_t avg, cycles[NR_TIME_ITERS];
@@ -114,19 +126,325 @@ static void calibrate_cpu_clock(void)
 	avg /= samples;
 	avg = (avg + 9) / 10;
 
-	cycles_per_usec = avg;
+	return (uint64_t)avg * 1000ULL;
+}
+
+static BOOL is_intel(struct cpuid_state_t *state, uint32_t *maxleaf)
+{
+	struct cpu_regs_t regs;
+
+	ZERO_REGS(&regs);
+	if (!state->cpuid_call(&regs, state))
+		return FALSE;
+	*maxleaf = regs.eax;
+
+	/* "GenuineIntel" */
+	return (regs.ebx == 0x756e6547 && regs.edx == 0x49656e69 && regs.ecx == 0x6c65746e);
+}
+
+/* Leaf 0x15 gives the TSC as a ratio of the core crystal clock. Skylake and
+ * Kaby Lake leave the crystal frequency out, but there the TSC runs at the
+ * base frequency from leaf 0x16.
+ */
+static uint64_t tsc_khz_from_cpuid(struct cpuid_state_t *state)
+{
+	struct cpu_regs_t regs;
+	uint32_t maxleaf = 0;
+	BOOL intel = is_intel(state, &maxleaf);
+
+	if (maxleaf >= 0x15) {
+		ZERO_REGS(&regs);
+		regs.eax = 0x15;
+		state->cpuid_call(&regs, state);
+		if (regs.eax && regs.ebx && regs.ecx)
+			return ((uint64_t)regs.ecx * regs.ebx / regs.eax) / 1000ULL;
+		if (regs.eax && regs.ebx && intel && maxleaf >= 0x16) {
+			ZERO_REGS(&regs);
+			regs.eax = 0x16;
+			state->cpuid_call(&regs, state);
+			if (regs.eax & 0xffff)
+				return (uint64_t)(regs.eax & 0xffff) * 1000ULL;
+		}
+	}
+
+	return 0;
+}
+
+static uint64_t tsc_khz_from_sysfs(void)
+{
+#ifdef __linux__
+	FILE *fp = fopen("/sys/devices/system/cpu/cpu0/tsc_freq_khz", "r");
+	uint64_t khz = 0;
+
+	if (!fp)
+		return 0;
+	if (fscanf(fp, "%" SCNu64, &khz) != 1)
+		khz = 0;
+	fclose(fp);
+	return khz;
+#else
+	return 0;
+#endif
+}
+
+/* VMware, and other hypervisors following its convention, report the TSC
+ * frequency in kHz in leaf 0x40000010.
+ */
+static uint64_t tsc_khz_from_hypervisor(struct cpuid_state_t *state)
+{
+	struct cpu_regs_t regs;
+
+	ZERO_REGS(&regs);
+	regs.eax = 1;
+	state->cpuid_call(&regs, state);
+	if (!(regs.ecx & (1U << 31)))
+		return 0;
+
+	ZERO_REGS(&regs);
+	regs.eax = 0x40000000;
+	state->cpuid_call(&regs, state);
+	if (regs.eax < 0x40000010 || regs.eax > 0x400000ff)
+		return 0;
+
+	ZERO_REGS(&regs);
+	regs.eax = 0x40000010;
+	state->cpuid_call(&regs, state);
+	return regs.eax;
 }
 
 uint64_t cpu_clock_to_wall(uint64_t clock)
 {
-	if (!cycles_per_usec)
-		init_cpu_clock();
-	return (clock * 1000ULL) / cycles_per_usec;
+	if (!tsc_khz)
+		init_cpu_clock(NULL);
+	return (clock * 1000000ULL) / tsc_khz;
+}
+
+void init_cpu_clock(struct cpuid_state_t *state)
+{
+	if (tsc_khz)
+		return;
+
+	if (state) {
+		tsc_khz = tsc_khz_from_cpuid(state);
+		tsc_khz_source = "CPUID leaf 0x15/0x16";
+	}
+	if (!tsc_khz) {
+		tsc_khz = tsc_khz_from_sysfs();
+		tsc_khz_source = "sysfs tsc_freq_khz";
+	}
+	if (!tsc_khz && state) {
+		tsc_khz = tsc_khz_from_hypervisor(state);
+		tsc_khz_source = "hypervisor leaf 0x40000010";
+	}
+	if (!tsc_khz) {
+		tsc_khz = calibrate_cpu_clock();
+		tsc_khz_source = "calibration";
+	}
+}
+
+uint64_t cpu_clock_khz(void)
+{
+	return tsc_khz;
+}
+
+const char *cpu_clock_source(void)
+{
+	return tsc_khz ? tsc_khz_source : "unknown";
+}
+
+static BOOL timer_has_rdtscp(struct cpuid_state_t *state)
+{
+	struct cpu_regs_t regs;
+
+	ZERO_REGS(&regs);
+	regs.eax = 0x80000000;
+	if (!state->cpuid_call(&regs, state) || regs.eax < 0x80000001)
+		return FALSE;
+
+	ZERO_REGS(&regs);
+	regs.eax = 0x80000001;
+	if (!state->cpuid_call(&regs, state))
+		return FALSE;
+
+	return (regs.edx & (1 << 27)) ? TRUE : FALSE;
+}
+
+#ifdef __linux__
+static int perf_open_cycles(void)
+{
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.size = sizeof(attr);
+	attr.config = PERF_COUNT_HW_CPU_CYCLES;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+
+	/* Count the calling thread on whichever CPU it runs. */
+	return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
 }
 
-void init_cpu_clock(void)
+static uint64_t perf_read(int fd)
 {
-	calibrate_cpu_clock();
+	uint64_t count = 0;
+	if (read(fd, &count, sizeof(count)) != sizeof(count))
+		return 0;
+	return count;
+}
+#endif
+
+#define NR_OVERHEAD_ITERS 256
+
+static void timer_calibrate(struct cpu_timer_t *timer)
+{
+	uint64_t s, e, best = UINT64_MAX;
+	int i;
+
+	timer->overhead = 0;
+	for (i = 0; i < NR_OVERHEAD_ITERS; i++) {
+		s = timer_start(timer);
+		e = timer_stop(timer);
+		if (e - s < best)
+			best = e - s;
+	}
+	timer->overhead = best;
+}
+
+int timer_open(struct cpu_timer_t *timer, timer_backend_t backend, struct cpuid_state_t *state)
+{
+	memset(timer, 0, sizeof(struct cpu_timer_t));
+	timer->fd = -1;
+
+	if (backend == TIMER_DEFAULT) {
+#if defined(TARGET_CPU_X86) || defined(TARGET_CPU_X86_64)
+		backend = timer_has_rdtscp(state) ? TIMER_RDTSCP : TIMER_RDTSC;
+#else
+		backend = TIMER_CLOCK;
+#endif
+	}
+
+	switch (backend) {
+	case TIMER_RDTSC:
+	case TIMER_RDTSCP:
+#if defined(TARGET_CPU_X86) || defined(TARGET_CPU_X86_64)
+		if (backend == TIMER_RDTSCP && !timer_has_rdtscp(state))
+			return 1;
+		break;
+#else
+		return 1;
+#endif
+	case TIMER_CLOCK:
+		break;
+	case TIMER_PERF:
+#ifdef __linux__
+		timer->fd = perf_open_cycles();
+		if (timer->fd < 0)
+			return 1;
+		break;
+#else
+		return 1;
+#endif
+	default:
+		return 1;
+	}
+
+	timer->backend = backend;
+	timer_calibrate(timer);
+	return 0;
+}
+
+void timer_close(struct cpu_timer_t *timer)
+{
+#ifdef __linux__
+	if (timer->fd >= 0)
+		close(timer->fd);
+#endif
+	timer->fd = -1;
+}
+
+uint64_t timer_start(const struct cpu_timer_t *timer)
+{
+	switch (timer->backend) {
+	case TIMER_RDTSC:
+		return get_cpu_clock();
+	case TIMER_RDTSCP:
+		return get_cpu_clock_start();
+	case TIMER_CLOCK:
+		return wallclock_ns();
+#ifdef __linux__
+	case TIMER_PERF:
+		return perf_read(timer->fd);
+#endif
+	default:
+		return 0;
+	}
+}
+
+uint64_t timer_stop(const struct cpu_timer_t *timer)
+{
+	switch (timer->backend) {
+	case TIMER_RDTSC:
+		return get_cpu_clock();
+	case TIMER_RDTSCP:
+		return get_cpu_clock_end();
+	case TIMER_CLOCK:
+		return wallclock_ns();
+#ifdef __linux__
+	case TIMER_PERF:
+		return perf_read(timer->fd);
+#endif
+	default:
+		return 0;
+	}
+}
+
+uint64_t timer_elapsed(const struct cpu_timer_t *timer, uint64_t start, uint64_t stop)
+{
+	uint64_t d = stop - start;
+	return (d > timer->overhead) ? d - timer->overhead : 0;
+}
+
+uint64_t timer_to_ns(const struct cpu_timer_t *timer, uint64_t ticks)
+{
+	/* Core cycles from perf only match TSC cycles at the nominal frequency,
+	 * so that conversion is approximate.
+	 */
+	if (timer->backend == TIMER_CLOCK)
+		return ticks;
+	return cpu_clock_to_wall(ticks);
+}
+
+static const char *timer_names[] = {
+	"default",
+	"rdtsc",
+	"rdtscp",
+	"clock",
+	"perf"
+};
+
+const char *timer_name(timer_backend_t backend)
+{
+	if ((uint32_t)backend >= sizeof(timer_names) / sizeof(timer_names[0]))
+		return "unknown";
+	return timer_names[backend];
+}
+
+const char *timer_unit(const struct cpu_timer_t *timer)
+{
+	return (timer->backend == TIMER_CLOCK) ? "ns" : "cycles";
+}
+
+int timer_parse(const char *name, timer_backend_t *backend)
+{
+	uint32_t i;
+	for (i = 0; i < sizeof(timer_names) / sizeof(timer_names[0]); i++) {
+		if (0 == strcmp(name, timer_names[i])) {
+			*backend = (timer_backend_t)i;
+			return 0;
+		}
+	}
+	return 1;
 }
 
 /* vim: set ts=4 sts=4 sw=4 noet: */
@@ -26,7 +26,9 @@
 #include <intrin.h>
 #endif
 
-static inline uint64_t get_cpu_clock(void)
+struct cpuid_state_t;
+
+static inline __unused_variable uint64_t get_cpu_clock(void)
 {
 #if defined(TARGET_CPU_X86) || defined(TARGET_CPU_X86_64)
 #ifdef _MSC_VER
@@ -44,8 +46,104 @@ static inline uint64_t get_cpu_clock(void)
 #endif
 }
 
+/* Reads the TSC at the start of a timed region. The leading LFENCE keeps
+ * earlier instructions from drifting into the region, the trailing one keeps
+ * the region from starting before the TSC is read.
+ */
+static inline __unused_variable uint64_t get_cpu_clock_start(void)
+{
+#if defined(TARGET_CPU_X86) || defined(TARGET_CPU_X86_64)
+#ifdef _MSC_VER
+	uint64_t t;
+	_mm_lfence();
+	t = __rdtsc();
+	_mm_lfence();
+	return t;
+#else
+	uint32_t lo, hi;
+
+	__asm__ __volatile__("lfence\n\trdtsc\n\tlfence" : "=a" (lo), "=d" (hi) : : "memory");
+	return ((uint64_t) hi << 32ULL) | lo;
+#endif
+#else
+	assert(0);
+	return 0;
+#endif
+}
+
+/* Reads the TSC at the end of a timed region. RDTSCP waits for all earlier
+ * instructions to retire, and the LFENCE keeps later ones from starting
+ * before the TSC is read. Requires RDTSCP (CPUID 0x80000001 EDX[27]).
+ */
+static inline __unused_variable uint64_t get_cpu_clock_end(void)
+{
+#if defined(TARGET_CPU_X86) || defined(TARGET_CPU_X86_64)
+#ifdef _MSC_VER
+	unsigned int aux;
+	uint64_t t = __rdtscp(&aux);
+	_mm_lfence();
+	return t;
+#else
+	uint32_t lo, hi, aux;
+
+	__asm__ __volatile__("rdtscp\n\tlfence" : "=a" (lo), "=d" (hi), "=c" (aux) : : "memory");
+	return ((uint64_t) hi << 32ULL) | lo;
+#endif
+#else
+	assert(0);
+	return 0;
+#endif
+}
+
 uint64_t cpu_clock_to_wall(uint64_t clock);
-void init_cpu_clock(void);
+
+/* Determines the TSC frequency. CPUID leaf 0x15 (or 0x16) is preferred,
+ * then the Linux tsc_freq_khz sysfs file, then the hypervisor TSC leaf.
+ * A busy-wait calibration is only used if none of those are available.
+ * The state may be NULL, in which case the CPUID sources are skipped.
+ */
+void init_cpu_clock(struct cpuid_state_t *state);
+uint64_t cpu_clock_khz(void);
+const char *cpu_clock_source(void);
+
+typedef enum {
+	TIMER_DEFAULT = 0,
+	TIMER_RDTSC,        /* bare RDTSC on both ends */
+	TIMER_RDTSCP,       /* LFENCE;RDTSC;LFENCE ... RDTSCP;LFENCE */
+	TIMER_CLOCK,        /* clock_gettime(CLOCK_MONOTONIC) or equivalent */
+	TIMER_PERF          /* perf_event hardware cycle counter (Linux) */
+} timer_backend_t;
+
+/* A per-thread timer. The perf backend counts cycles of the thread that
+ * opened it, so each thread doing measurements needs its own.
+ */
+struct cpu_timer_t {
+	timer_backend_t backend;
+	int fd;
+	uint64_t overhead;
+};
+
+/* Opens a timer using the requested backend. TIMER_DEFAULT picks the
+ * serialized TSC timer when the CPU has RDTSCP, and otherwise falls back
+ * to the bare one. The cost of an empty start/stop pair is calibrated and
+ * later subtracted by timer_elapsed(). Returns nonzero if the backend is
+ * unavailable.
+ */
+int timer_open(struct cpu_timer_t *timer, timer_backend_t backend, struct cpuid_state_t *state);
+void timer_close(struct cpu_timer_t *timer);
+
+uint64_t timer_start(const struct cpu_timer_t *timer);
+uint64_t timer_stop(const struct cpu_timer_t *timer);
+
+/* Returns stop - start with the calibrated overhead removed. */
+uint64_t timer_elapsed(const struct cpu_timer_t *timer, uint64_t start, uint64_t stop);
+
+/* Converts timer ticks to nanoseconds. */
+uint64_t timer_to_ns(const struct cpu_timer_t *timer, uint64_t ticks);
+
+const char *timer_name(timer_backend_t backend);
+const char *timer_unit(const struct cpu_timer_t *timer);
+int timer_parse(const char *name, timer_backend_t *backend);
 
 #endif
 
@@ -67,43 +67,39 @@ static inline BOOL cpuid(uint32_t *_eax, uint32_t *_ebx, uint32_t *_ecx, uint32_
 
 #else
 
-/* MSVC, x86-only. Stupid compiler doesn't allow __asm on x86_64. */
-static inline BOOL cpuid(uint32_t *_eax, uint32_t *_ebx, uint32_t *_ecx, uint32_t *_edx)
-{
 #ifdef TARGET_CPU_X86
-	static BOOL cpuid_support = FALSE;
-
-	if (!cpuid_support) {
-		uint32_t pre_change, post_change;
-		const uint32_t id_flag = 0x200000;
-
-		/* This is pretty much the standard way to detect whether the CPUID
-		 *     instruction is supported: try to change the ID bit in the EFLAGS
-		 *     register.  If we can change it, then the CPUID instruction is
-		 *     implemented.  */
-		__asm {
-			mov edx, id_flag;
-			pushfd;                         /* Save %eflags to restore later.  */
-			pushfd;                         /* Push second copy, for manipulation.  */
-			pop ebx;                        /* Pop it into post_change.  */
-			mov eax, ebx;                   /* Save copy in pre_change.   */
-			xor ebx, edx;                   /* Tweak bit in post_change.  */
-			push ebx;                       /* Push tweaked copy... */
-			popfd;                          /* ... and pop it into eflags.  */
-			pushfd;                         /* Did it change?  Push new %eflags... */
-			pop ebx;                        /* ... and pop it into post_change.  */
-			popfd;                          /* Restore original value.  */
-			mov pre_change, eax;
-			mov post_change, ebx;
-		}
+static BOOL cpuid_probe(void)
+{
+	uint32_t pre_change, post_change;
+	const uint32_t id_flag = 0x200000;
 
-		if (((pre_change ^ post_change) & id_flag) == 0)
-			return FALSE;
-		else
-			cpuid_support = TRUE;
+	/* This is pretty much the standard way to detect whether the CPUID
+	 *     instruction is supported: try to change the ID bit in the EFLAGS
+	 *     register.  If we can change it, then the CPUID instruction is
+	 *     implemented.  */
+	__asm {
+		mov edx, id_flag;
+		pushfd;                         /* Save %eflags to restore later.  */
+		pushfd;                         /* Push second copy, for manipulation.  */
+		pop ebx;                        /* Pop it into post_change.  */
+		mov eax, ebx;                   /* Save copy in pre_change.   */
+		xor ebx, edx;                   /* Tweak bit in post_change.  */
+		push ebx;                       /* Push tweaked copy... */
+		popfd;                          /* ... and pop it into eflags.  */
+		pushfd;                         /* Did it change?  Push new %eflags... */
+		pop ebx;                        /* ... and pop it into post_change.  */
+		popfd;                          /* Restore original value.  */
+		mov pre_change, eax;
+		mov post_change, ebx;
 	}
+
+	return ((pre_change ^ post_change) & id_flag) != 0;
+}
 #endif
 
+/* MSVC, x86-only. Stupid compiler doesn't allow __asm on x86_64. */
+static inline BOOL cpuid(uint32_t *_eax, uint32_t *_ebx, uint32_t *_ecx, uint32_t *_edx)
+{
 	__asm {
 		mov esi, _eax;
 		mov edi, _ecx;
@@ -125,31 +121,29 @@ static inline BOOL cpuid(uint32_t *_eax, uint32_t *_ebx, uint32_t *_ecx, uint32_
 #endif
 
 #ifdef TARGET_COMPILER_GCC
-static inline BOOL cpuid(uint32_t *_eax, uint32_t *_ebx, uint32_t *_ecx, uint32_t *_edx)
-{
 #ifdef TARGET_CPU_X86
-	static BOOL cpuid_support = FALSE;
-	if (!cpuid_support) {
-		uint32_t pre_change, post_change;
-		const uint32_t id_flag = 0x200000;
-		asm ("pushfl\n\t"          /* Save %eflags to restore later.  */
-		     "pushfl\n\t"          /* Push second copy, for manipulation.  */
-		     "popl %1\n\t"         /* Pop it into post_change.  */
-		     "movl %1,%0\n\t"      /* Save copy in pre_change.   */
-		     "xorl %2,%1\n\t"      /* Tweak bit in post_change.  */
-		     "pushl %1\n\t"        /* Push tweaked copy... */
-		     "popfl\n\t"           /* ... and pop it into %eflags.  */
-		     "pushfl\n\t"          /* Did it change?  Push new %eflags... */
-		     "popl %1\n\t"         /* ... and pop it into post_change.  */
-		     "popfl"               /* Restore original value.  */
-		     : "=&r" (pre_change), "=&r" (post_change)
-		     : "ir" (id_flag));
-		if (((pre_change ^ post_change) & id_flag) == 0)
-			return FALSE;
-		else
-			cpuid_support = TRUE;
-	}
+static BOOL cpuid_probe(void)
+{
+	uint32_t pre_change, post_change;
+	const uint32_t id_flag = 0x200000;
+	asm ("pushfl\n\t"          /* Save %eflags to restore later.  */
+	     "pushfl\n\t"          /* Push second copy, for manipulation.  */
+	     "popl %1\n\t"         /* Pop it into post_change.  */
+	     "movl %1,%0\n\t"      /* Save copy in pre_change.   */
+	     "xorl %2,%1\n\t"      /* Tweak bit in post_change.  */
+	     "pushl %1\n\t"        /* Push tweaked copy... */
+	     "popfl\n\t"           /* ... and pop it into %eflags.  */
+	     "pushfl\n\t"          /* Did it change?  Push new %eflags... */
+	     "popl %1\n\t"         /* ... and pop it into post_change.  */
+	     "popfl"               /* Restore original value.  */
+	     : "=&r" (pre_change), "=&r" (post_change)
+	     : "ir" (id_flag));
+	return ((pre_change ^ post_change) & id_flag) != 0;
+}
 #endif
+
+static inline BOOL cpuid(uint32_t *_eax, uint32_t *_ebx, uint32_t *_ecx, uint32_t *_edx)
+{
 	asm volatile(
 	    "cpuid"
 	    : "=a" (*_eax),
@@ -165,44 +159,35 @@ static inline BOOL cpuid(uint32_t *_eax, uint32_t *_ebx, uint32_t *_ecx, uint32_
 #ifdef __linux__
 BOOL cpuid_kernel(struct cpu_regs_t *regs, struct cpuid_state_t *state)
 {
+	struct cpuid_kernel_ctx_t *ctx = &state->kernel;
 	off_t offset = ((off_t)regs->ecx << 32) + regs->eax;
-	char path[32];
-	BOOL ret = FALSE;
-	static int fd = -1;
-	static unsigned int i;
-	int r;
 
-	if (fd == -1 || i != state->cpu_bound_index) {
-		i = state->cpu_bound_index;
+	/* Keep the device node for the bound CPU open between calls, and only
+	 * reopen it when the caller rebinds to another CPU.
+	 */
+	if (ctx->fd == -1 || ctx->cpu != state->cpu_bound_index) {
+		char path[32];
 
-		if (fd != -1)
-			close(fd);
+		if (ctx->fd != -1)
+			close(ctx->fd);
 
-		sprintf(path, "/dev/cpu/%u/cpuid", i);
+		ctx->cpu = state->cpu_bound_index;
+		sprintf(path, "/dev/cpu/%u/cpuid", ctx->cpu);
 
-		fd = open(path, O_LARGEFILE, O_RDONLY);
+		ctx->fd = open(path, O_RDONLY | O_LARGEFILE);
+		if (ctx->fd == -1)
+			return FALSE;
 	}
 
-	if (fd == -1)
-		goto out;
-
-	memset(path, 0, sizeof(path));
 	memcpy(&state->last_leaf, regs, sizeof(struct cpu_regs_t));
 
-	if (offset != lseek(fd, offset, SEEK_SET))
-		goto cleanup;
-
-	r = read(fd, regs, 16);
-	if (r == -1)
-		goto cleanup;
+	if (pread(ctx->fd, regs, 16, offset) != 16) {
+		close(ctx->fd);
+		ctx->fd = -1;
+		return FALSE;
+	}
 
-	ret = TRUE;
-cleanup:
-	close(fd);
-	i = -1;
-	fd = -1;
-out:
-	return ret;
+	return TRUE;
 }
 #endif
 
@@ -210,11 +195,49 @@ BOOL cpuid_native(struct cpu_regs_t *regs, struct cpuid_state_t *state)
 {
 #if defined(TARGET_CPU_X86) || defined(TARGET_CPU_X86_64)
 	memcpy(&state->last_leaf, regs, sizeof(struct cpu_regs_t));
+#ifdef TARGET_CPU_X86
+	if (!state->native.probed) {
+		state->native.supported = cpuid_probe() ? 1 : 0;
+		state->native.probed = 1;
+	}
+	if (!state->native.supported)
+		return FALSE;
+#endif
 	return cpuid(&regs->eax, &regs->ebx, &regs->ecx, &regs->edx);
 #endif
 	return FALSE;
 }
 
+BOOL xgetbv_native(uint32_t index, uint64_t *value)
+{
+#if defined(CPUID_AVAILABLE) && defined(TARGET_COMPILER_MSVC) && defined(TARGET_CPU_X86_64)
+	*value = _xgetbv(index);
+	return TRUE;
+#elif defined(CPUID_AVAILABLE) && defined(TARGET_COMPILER_GCC)
+	uint32_t eax, edx;
+	/* The XGETBV opcode, for assemblers that predate it. */
+	asm volatile(".byte 0x0f, 0x01, 0xd0" : "=a" (eax), "=d" (edx) : "c" (index));
+	*value = ((uint64_t)edx << 32) | eax;
+	return TRUE;
+#else
+	(void)index;
+	*value = 0;
+	return FALSE;
+#endif
+}
+
+void cpuid_release(struct cpuid_state_t *state)
+{
+#ifdef __linux__
+	if (state->kernel.fd != -1) {
+		close(state->kernel.fd);
+		state->kernel.fd = -1;
+	}
+#else
+	(void)state;
+#endif
+}
+
 BOOL cpuid_load_from_file(const char *filename, struct cpuid_state_t *state)
 {
 	struct cpuid_leaf_t *leaf;
@@ -585,4 +608,48 @@ void cpuid_dump_vmware(struct cpu_regs_t *regs, struct cpuid_state_t *state, __u
 	printf("cpuid.%x.edx = \"%s\"\n", state->last_leaf.eax, uint32_to_binary(buffer, regs->edx));
 }
 
+void cpuid_dump_capture(struct cpu_regs_t *regs, struct cpuid_state_t *state, __unused_variable BOOL indexed)
+{
+	struct cpuid_leaf_t *leaf;
+	uint32_t cpu = state->cpu_bound_index;
+	uint32_t i, count = 0;
+
+	/* Grow the per-CPU table so that it uses the same layout as a table
+	 * produced by cpuid_load_from_file().
+	 */
+	if (!state->cpuid_leaves || cpu >= state->cpu_logical_count) {
+		struct cpuid_leaf_t **table;
+		table = (struct cpuid_leaf_t **)realloc(state->cpuid_leaves, sizeof(struct cpuid_leaf_t *) * (cpu + 2));
+		assert(table);
+		for (i = state->cpuid_leaves ? state->cpu_logical_count : 0; i <= cpu + 1; i++)
+			table[i] = NULL;
+		state->cpuid_leaves = table;
+		state->cpu_logical_count = cpu + 1;
+	}
+
+	leaf = state->cpuid_leaves[cpu];
+	while (leaf && leaf[count].input.eax != 0xFFFFFFFF) {
+		/* Some dump handlers revisit a leaf; keep the latest result. */
+		if (leaf[count].input.eax == state->last_leaf.eax &&
+		    leaf[count].input.ecx == state->last_leaf.ecx) {
+			memcpy(&leaf[count].output, regs, sizeof(struct cpu_regs_t));
+			return;
+		}
+		count++;
+	}
+
+	leaf = (struct cpuid_leaf_t *)realloc(leaf, sizeof(struct cpuid_leaf_t) * (count + 2));
+	assert(leaf);
+
+	ZERO_REGS(&leaf[count].input);
+	leaf[count].input.eax = state->last_leaf.eax;
+	leaf[count].input.ecx = state->last_leaf.ecx;
+	memcpy(&leaf[count].output, regs, sizeof(struct cpu_regs_t));
+
+	/* Sentinel */
+	memset(&leaf[count + 1], 0xFF, sizeof(struct cpuid_leaf_t));
+
+	state->cpuid_leaves[cpu] = leaf;
+}
+
 /* vim: set ts=4 sts=4 sw=4 noet: */
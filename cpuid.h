@@ -54,6 +54,14 @@ BOOL cpuid_kernel(struct cpu_regs_t *regs, struct cpuid_state_t *state);
 #endif
 BOOL cpuid_stub(struct cpu_regs_t *regs, struct cpuid_state_t *state);
 
+/* Reads extended control register 'index' of the current CPU. The caller
+ * must check CPUID.1:ECX.OSXSAVE first, since XGETBV faults without it.
+ */
+BOOL xgetbv_native(uint32_t index, uint64_t *value);
+
+/* Releases any resources held by the cpuid_call backend of this state. */
+void cpuid_release(struct cpuid_state_t *state);
+
 /* Allows printing dumps in different formats. */
 void cpuid_dump_normal(struct cpu_regs_t *regs, struct cpuid_state_t *state, BOOL indexed);
 void cpuid_dump_xen(struct cpu_regs_t *regs, struct cpuid_state_t *state, BOOL indexed);
@@ -61,6 +69,9 @@ void cpuid_dump_xen_sxp(struct cpu_regs_t *regs, struct cpuid_state_t *state, BO
 void cpuid_dump_etallen(struct cpu_regs_t *regs, struct cpuid_state_t *state, BOOL indexed);
 void cpuid_dump_vmware(struct cpu_regs_t *regs, struct cpuid_state_t *state, BOOL indexed);
 
+/* Records leaves into state->cpuid_leaves instead of printing them. */
+void cpuid_dump_capture(struct cpu_regs_t *regs, struct cpuid_state_t *state, BOOL indexed);
+
 /* For cpuid_pseudo */
 BOOL cpuid_load_from_file(const char *filename, struct cpuid_state_t *state);
 
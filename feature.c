@@ -366,6 +366,16 @@ static const struct cpu_feature_t features [] = {
 /*	{ 0x00000007, 1, REG_EBX, 0x40000000, VENDOR_INTEL             , ""}, */   /* Reserved */
 /*	{ 0x00000007, 1, REG_EBX, 0x80000000, VENDOR_INTEL             , ""}, */   /* Reserved */
 
+	{ 0x00000007, 1, REG_EDX, 0x00000010, VENDOR_INTEL             , "AVX-VNNI-INT8 instructions"},
+	{ 0x00000007, 1, REG_EDX, 0x00000020, VENDOR_INTEL             , "AVX-NE-CONVERT instructions"},
+	{ 0x00000007, 1, REG_EDX, 0x00000100, VENDOR_INTEL             , "AMX-COMPLEX instructions"},
+	{ 0x00000007, 1, REG_EDX, 0x00000400, VENDOR_INTEL             , "AVX-VNNI-INT16 instructions"},
+	{ 0x00000007, 1, REG_EDX, 0x00004000, VENDOR_INTEL             , "PREFETCHIT0/PREFETCHIT1 instructions"},
+	{ 0x00000007, 1, REG_EDX, 0x00020000, VENDOR_INTEL             , "UIRET sets UIF to RFLAGS.IF"},
+	{ 0x00000007, 1, REG_EDX, 0x00040000, VENDOR_INTEL             , "CET supervisor shadow stack (CET_SSS)"},
+	{ 0x00000007, 1, REG_EDX, 0x00080000, VENDOR_INTEL             , "AVX10 converged vector ISA"},
+	{ 0x00000007, 1, REG_EDX, 0x00200000, VENDOR_INTEL             , "Advanced Performance Extensions (APX_F)"},
+
 	{ 0x00000007, 2, REG_EDX, 0x00000001, VENDOR_INTEL             , "Fast store forwarding disable without spec store bypass (PSFD)"},
 	{ 0x00000007, 2, REG_EDX, 0x00000002, VENDOR_INTEL             , "IPRED control"},
 	{ 0x00000007, 2, REG_EDX, 0x00000004, VENDOR_INTEL             , "RRSBA control"},
@@ -407,8 +417,8 @@ static const struct cpu_feature_t features [] = {
 	{ 0x00000014, 0, REG_EBX, 0x00000010, VENDOR_INTEL             , "PTWRITE"},
 	{ 0x00000014, 0, REG_EBX, 0x00000020, VENDOR_INTEL             , "Power Event Trace"},
 	{ 0x00000014, 0, REG_EBX, 0x00000040, VENDOR_INTEL             , "PSB and PMI preservation MSRs"},
-/*	{ 0x00000014, 0, REG_EBX, 0x00000080, VENDOR_INTEL             , ""}, */   /* Reserved */
-/*	{ 0x00000014, 0, REG_EBX, 0x00000100, VENDOR_INTEL             , ""}, */   /* Reserved */
+	{ 0x00000014, 0, REG_EBX, 0x00000080, VENDOR_INTEL             , "Event Trace"},
+	{ 0x00000014, 0, REG_EBX, 0x00000100, VENDOR_INTEL             , "TNT packet disable"},
 /*	{ 0x00000014, 0, REG_EBX, 0x00000200, VENDOR_INTEL             , ""}, */   /* Reserved */
 /*	{ 0x00000014, 0, REG_EBX, 0x00000400, VENDOR_INTEL             , ""}, */   /* Reserved */
 /*	{ 0x00000014, 0, REG_EBX, 0x00000800, VENDOR_INTEL             , ""}, */   /* Reserved */
@@ -1209,6 +1219,105 @@ static const struct cpu_feature_t features [] = {
 	{ 0, 0, REG_NULL, 0, 0, NULL}
 };
 
+/* Feature bits that GCC and Clang can target, named by the -m<flag> option
+ * that enables them. Grouped by leaf and subleaf like features[].
+ */
+static const struct cpu_feature_t compiler_flags [] = {
+	{ 0x00000001, 0, REG_ECX, 0x00000001, VENDOR_ANY, "sse3"},
+	{ 0x00000001, 0, REG_ECX, 0x00000002, VENDOR_ANY, "pclmul"},
+	{ 0x00000001, 0, REG_ECX, 0x00000200, VENDOR_ANY, "ssse3"},
+	{ 0x00000001, 0, REG_ECX, 0x00001000, VENDOR_ANY, "fma"},
+	{ 0x00000001, 0, REG_ECX, 0x00002000, VENDOR_ANY, "cx16"},
+	{ 0x00000001, 0, REG_ECX, 0x00080000, VENDOR_ANY, "sse4.1"},
+	{ 0x00000001, 0, REG_ECX, 0x00100000, VENDOR_ANY, "sse4.2"},
+	{ 0x00000001, 0, REG_ECX, 0x00400000, VENDOR_ANY, "movbe"},
+	{ 0x00000001, 0, REG_ECX, 0x00800000, VENDOR_ANY, "popcnt"},
+	{ 0x00000001, 0, REG_ECX, 0x02000000, VENDOR_ANY, "aes"},
+	{ 0x00000001, 0, REG_ECX, 0x04000000, VENDOR_ANY, "xsave"},
+	{ 0x00000001, 0, REG_ECX, 0x10000000, VENDOR_ANY, "avx"},
+	{ 0x00000001, 0, REG_ECX, 0x20000000, VENDOR_ANY, "f16c"},
+	{ 0x00000001, 0, REG_ECX, 0x40000000, VENDOR_ANY, "rdrnd"},
+	{ 0x00000001, 0, REG_EDX, 0x00800000, VENDOR_ANY, "mmx"},
+	{ 0x00000001, 0, REG_EDX, 0x01000000, VENDOR_ANY, "fxsr"},
+	{ 0x00000001, 0, REG_EDX, 0x02000000, VENDOR_ANY, "sse"},
+	{ 0x00000001, 0, REG_EDX, 0x04000000, VENDOR_ANY, "sse2"},
+
+	{ 0x00000007, 0, REG_EBX, 0x00000001, VENDOR_ANY, "fsgsbase"},
+	{ 0x00000007, 0, REG_EBX, 0x00000008, VENDOR_ANY, "bmi"},
+	{ 0x00000007, 0, REG_EBX, 0x00000020, VENDOR_ANY, "avx2"},
+	{ 0x00000007, 0, REG_EBX, 0x00000100, VENDOR_ANY, "bmi2"},
+	{ 0x00000007, 0, REG_EBX, 0x00000800, VENDOR_ANY, "rtm"},
+	{ 0x00000007, 0, REG_EBX, 0x00010000, VENDOR_ANY, "avx512f"},
+	{ 0x00000007, 0, REG_EBX, 0x00020000, VENDOR_ANY, "avx512dq"},
+	{ 0x00000007, 0, REG_EBX, 0x00040000, VENDOR_ANY, "rdseed"},
+	{ 0x00000007, 0, REG_EBX, 0x00080000, VENDOR_ANY, "adx"},
+	{ 0x00000007, 0, REG_EBX, 0x00200000, VENDOR_ANY, "avx512ifma"},
+	{ 0x00000007, 0, REG_EBX, 0x00800000, VENDOR_ANY, "clflushopt"},
+	{ 0x00000007, 0, REG_EBX, 0x01000000, VENDOR_ANY, "clwb"},
+	{ 0x00000007, 0, REG_EBX, 0x10000000, VENDOR_ANY, "avx512cd"},
+	{ 0x00000007, 0, REG_EBX, 0x20000000, VENDOR_ANY, "sha"},
+	{ 0x00000007, 0, REG_EBX, 0x40000000, VENDOR_ANY, "avx512bw"},
+	{ 0x00000007, 0, REG_EBX, 0x80000000, VENDOR_ANY, "avx512vl"},
+	{ 0x00000007, 0, REG_ECX, 0x00000002, VENDOR_ANY, "avx512vbmi"},
+	{ 0x00000007, 0, REG_ECX, 0x00000008, VENDOR_ANY, "pku"},
+	{ 0x00000007, 0, REG_ECX, 0x00000020, VENDOR_ANY, "waitpkg"},
+	{ 0x00000007, 0, REG_ECX, 0x00000040, VENDOR_ANY, "avx512vbmi2"},
+	{ 0x00000007, 0, REG_ECX, 0x00000080, VENDOR_ANY, "shstk"},
+	{ 0x00000007, 0, REG_ECX, 0x00000100, VENDOR_ANY, "gfni"},
+	{ 0x00000007, 0, REG_ECX, 0x00000200, VENDOR_ANY, "vaes"},
+	{ 0x00000007, 0, REG_ECX, 0x00000400, VENDOR_ANY, "vpclmulqdq"},
+	{ 0x00000007, 0, REG_ECX, 0x00000800, VENDOR_ANY, "avx512vnni"},
+	{ 0x00000007, 0, REG_ECX, 0x00001000, VENDOR_ANY, "avx512bitalg"},
+	{ 0x00000007, 0, REG_ECX, 0x00004000, VENDOR_ANY, "avx512vpopcntdq"},
+	{ 0x00000007, 0, REG_ECX, 0x00400000, VENDOR_ANY, "rdpid"},
+	{ 0x00000007, 0, REG_ECX, 0x02000000, VENDOR_ANY, "cldemote"},
+	{ 0x00000007, 0, REG_ECX, 0x08000000, VENDOR_ANY, "movdiri"},
+	{ 0x00000007, 0, REG_ECX, 0x10000000, VENDOR_ANY, "movdir64b"},
+	{ 0x00000007, 0, REG_ECX, 0x20000000, VENDOR_ANY, "enqcmd"},
+	{ 0x00000007, 0, REG_EDX, 0x00000020, VENDOR_ANY, "uintr"},
+	{ 0x00000007, 0, REG_EDX, 0x00000100, VENDOR_ANY, "avx512vp2intersect"},
+	{ 0x00000007, 0, REG_EDX, 0x00004000, VENDOR_ANY, "serialize"},
+	{ 0x00000007, 0, REG_EDX, 0x00010000, VENDOR_ANY, "tsxldtrk"},
+	{ 0x00000007, 0, REG_EDX, 0x00040000, VENDOR_ANY, "pconfig"},
+	{ 0x00000007, 0, REG_EDX, 0x00400000, VENDOR_ANY, "amx-bf16"},
+	{ 0x00000007, 0, REG_EDX, 0x00800000, VENDOR_ANY, "avx512fp16"},
+	{ 0x00000007, 0, REG_EDX, 0x01000000, VENDOR_ANY, "amx-tile"},
+	{ 0x00000007, 0, REG_EDX, 0x02000000, VENDOR_ANY, "amx-int8"},
+
+	{ 0x00000007, 1, REG_EAX, 0x00000001, VENDOR_ANY, "sha512"},
+	{ 0x00000007, 1, REG_EAX, 0x00000002, VENDOR_ANY, "sm3"},
+	{ 0x00000007, 1, REG_EAX, 0x00000004, VENDOR_ANY, "sm4"},
+	{ 0x00000007, 1, REG_EAX, 0x00000010, VENDOR_ANY, "avxvnni"},
+	{ 0x00000007, 1, REG_EAX, 0x00000020, VENDOR_ANY, "avx512bf16"},
+	{ 0x00000007, 1, REG_EAX, 0x00000080, VENDOR_ANY, "cmpccxadd"},
+	{ 0x00000007, 1, REG_EAX, 0x00200000, VENDOR_ANY, "amx-fp16"},
+	{ 0x00000007, 1, REG_EAX, 0x00400000, VENDOR_ANY, "hreset"},
+	{ 0x00000007, 1, REG_EAX, 0x00800000, VENDOR_ANY, "avxifma"},
+	{ 0x00000007, 1, REG_EDX, 0x00000010, VENDOR_ANY, "avxvnniint8"},
+	{ 0x00000007, 1, REG_EDX, 0x00000020, VENDOR_ANY, "avxneconvert"},
+	{ 0x00000007, 1, REG_EDX, 0x00000100, VENDOR_ANY, "amx-complex"},
+	{ 0x00000007, 1, REG_EDX, 0x00000400, VENDOR_ANY, "avxvnniint16"},
+	{ 0x00000007, 1, REG_EDX, 0x00004000, VENDOR_ANY, "prefetchi"},
+
+	{ 0x0000000d, 1, REG_EAX, 0x00000001, VENDOR_ANY, "xsaveopt"},
+	{ 0x0000000d, 1, REG_EAX, 0x00000002, VENDOR_ANY, "xsavec"},
+	{ 0x0000000d, 1, REG_EAX, 0x00000008, VENDOR_ANY, "xsaves"},
+
+	{ 0x80000001, 0, REG_ECX, 0x00000001, VENDOR_ANY, "sahf"},
+	{ 0x80000001, 0, REG_ECX, 0x00000020, VENDOR_ANY, "lzcnt"},
+	{ 0x80000001, 0, REG_ECX, 0x00000040, VENDOR_ANY, "sse4a"},
+	{ 0x80000001, 0, REG_ECX, 0x00000100, VENDOR_ANY, "prfchw"},
+	{ 0x80000001, 0, REG_ECX, 0x00000800, VENDOR_ANY, "xop"},
+	{ 0x80000001, 0, REG_ECX, 0x00010000, VENDOR_ANY, "fma4"},
+	{ 0x80000001, 0, REG_ECX, 0x00200000, VENDOR_ANY, "tbm"},
+	{ 0x80000001, 0, REG_ECX, 0x20000000, VENDOR_ANY, "mwaitx"},
+
+	{ 0x80000008, 0, REG_EBX, 0x00000001, VENDOR_ANY, "clzero"},
+	{ 0x80000008, 0, REG_EBX, 0x00000200, VENDOR_ANY, "wbnoinvd"},
+
+	{ 0, 0, REG_NULL, 0, 0, NULL}
+};
+
 static const char *vendors(char *buffer, uint32_t mask)
 {
 	char multi = 0;
@@ -1443,4 +1552,43 @@ int print_features(const struct cpu_regs_t *regs, struct cpuid_state_t *state)
 	return flags_found;
 }
 
+uint32_t feature_flags(struct cpuid_state_t *state, struct feature_flag_t *flags, uint32_t max)
+{
+	const struct cpu_feature_t *p;
+	struct cpu_regs_t regs;
+	uint32_t maxleaf, maxext, count = 0;
+	uint32_t level = 0xffffffff, index = 0xffffffff;
+
+	ZERO_REGS(&regs);
+	state->cpuid_call(&regs, state);
+	maxleaf = regs.eax;
+
+	ZERO_REGS(&regs);
+	regs.eax = 0x80000000;
+	state->cpuid_call(&regs, state);
+	maxext = (regs.eax & 0xffff0000) == 0x80000000 ? regs.eax : 0;
+
+	for (p = compiler_flags; p->m_reg != REG_NULL; p++) {
+		if (p->m_level != level || p->m_index != index) {
+			level = p->m_level;
+			index = p->m_index;
+			ZERO_REGS(&regs);
+			if ((level < 0x80000000 && level <= maxleaf) ||
+			    (level >= 0x80000000 && level <= maxext)) {
+				regs.eax = level;
+				regs.ecx = index;
+				state->cpuid_call(&regs, state);
+			}
+		}
+
+		if (count < max) {
+			flags[count].flag = p->m_name;
+			flags[count].present = (regs.regs[p->m_reg] & p->m_bitmask) != 0;
+		}
+		count++;
+	}
+
+	return count;
+}
+
 /* vim: set ts=4 sts=4 sw=4 noet: */
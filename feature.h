@@ -27,6 +27,17 @@ struct cpuid_state_t;
 
 int print_features(const struct cpu_regs_t *regs, struct cpuid_state_t *state);
 
+struct feature_flag_t {
+	const char *flag;   /* as in GCC/Clang -m<flag> */
+	int present;
+};
+
+/* Fills 'flags' with every ISA extension that has a compiler flag, in
+ * feature table order, noting whether the processor reports it. Returns the
+ * number of such extensions, which may exceed 'max'.
+ */
+uint32_t feature_flags(struct cpuid_state_t *state, struct feature_flag_t *flags, uint32_t max);
+
 #endif
 
 /* vim: set ts=4 sts=4 sw=4 noet: */
@@ -21,9 +21,14 @@
 
 #include "prefix.h"
 
+#include "amx.h"
 #include "cache.h"
 #include "feature.h"
 #include "handlers.h"
+#include "isa.h"
+#include "pmu.h"
+#include "pt.h"
+#include "rdt.h"
 #include "state.h"
 #include "util.h"
 
@@ -68,7 +73,7 @@ DECLARE_HANDLER(std_x2apic);
 DECLARE_HANDLER(std_perfmon);
 DECLARE_HANDLER(std_ext_state);
 DECLARE_HANDLER(std_qos_monitor);
-//DECLARE_HANDLER(std_qos_enforce);
+DECLARE_HANDLER(std_qos_enforce);
 //DECLARE_HANDLER(std_sgx);
 DECLARE_HANDLER(std_trace);
 DECLARE_HANDLER(std_tsc);
@@ -76,11 +81,12 @@ DECLARE_HANDLER(std_cpufreq);
 //DECLARE_HANDLER(std_soc);
 DECLARE_HANDLER(std_tlb);
 //DECLARE_HANDLER(std_keylocker);
-//DECLARE_HANDLER(std_hybrid);
+DECLARE_HANDLER(std_hybrid);
 //DECLARE_HANDLER(std_pconfig);
-//DECLARE_HANDLER(std_tile);
-//DECLARE_HANDLER(std_tmul);
-//DECLARE_HANDLER(std_x2apic_v2);
+DECLARE_HANDLER(std_tile);
+DECLARE_HANDLER(std_tmul);
+DECLARE_HANDLER(std_x2apic_v2);
+DECLARE_HANDLER(std_perfmon_ext);
 //DECLARE_HANDLER(std_hreset);
 
 DECLARE_HANDLER(ext_base);
@@ -95,7 +101,8 @@ DECLARE_HANDLER(ext_ibs_feat);
 DECLARE_HANDLER(ext_cacheprop);
 DECLARE_HANDLER(ext_extapic);
 //DECLARE_HANDLER(ext_amd_encryption);
-//DECLARE_HANDLER(ext_amd_mem_qos);
+DECLARE_HANDLER(ext_amd_mem_qos);
+DECLARE_HANDLER(ext_perfmon_v2);
 
 DECLARE_HANDLER(vmm_base);
 DECLARE_HANDLER(vmm_leaf01);
@@ -125,6 +132,7 @@ DECLARE_HANDLER(dump_std_0F);
 DECLARE_HANDLER(dump_std_10);
 DECLARE_HANDLER(dump_std_12);
 DECLARE_HANDLER(dump_std_1B);
+DECLARE_HANDLER(dump_std_23);
 DECLARE_HANDLER(dump_ext_1D);
 DECLARE_HANDLER(dump_ext_20);
 
@@ -146,7 +154,7 @@ const struct cpuid_leaf_handler_index_t dump_handlers[] =
 	{0x0000001D, handle_dump_until_eax},
 	{0x0000001F, handle_dump_x2apic},
 	{0x00000020, handle_dump_until_eax},
-	{0x00000023, handle_dump_until_eax},
+	{0x00000023, handle_dump_std_23},
 
 	/* Hypervisor levels */
 	{0x40000000, handle_dump_base},
@@ -181,21 +189,22 @@ const struct cpuid_leaf_handler_index_t decode_handlers[] =
 	{0x0000000B, handle_std_x2apic},
 	{0x0000000D, handle_std_ext_state},
 	{0x0000000F, handle_std_qos_monitor},
-	//{0x00000010, handle_std_qos_enforce},
+	{0x00000010, handle_std_qos_enforce},
 	//{0x00000012, handle_std_sgx},
 	{0x00000014, handle_std_trace},
 	{0x00000015, handle_std_tsc},
 	{0x00000016, handle_std_cpufreq},
 	{0x00000018, handle_std_tlb},
+	{0x0000001a, handle_std_hybrid},
+	{0x0000001d, handle_std_tile},
+	{0x0000001e, handle_std_tmul},
+	{0x0000001f, handle_std_x2apic_v2},
+	{0x00000023, handle_std_perfmon_ext},
 
 	/* TODO, when I have hardware that I can develop/test these on. */
 	//{0x00000017, handle_std_soc},
 	//{0x00000019, handle_std_keylocker},
-	//{0x0000001a, handle_std_hybrid},
 	//{0x0000001b, handle_std_pconfig},
-	//{0x0000001d, handle_std_tile},
-	//{0x0000001e, handle_std_tmul},
-	//{0x0000001f, handle_std_x2apic_v2},
 	//{0x00000020, handle_std_hreset},
 
 	/* Hypervisor levels */
@@ -229,7 +238,8 @@ const struct cpuid_leaf_handler_index_t decode_handlers[] =
 	{0x8000001D, handle_ext_cacheprop},
 	{0x8000001E, handle_ext_extapic},
 	//{0x8000001F, handle_ext_amd_encryption},
-	//{0x80000020, handle_ext_amd_mem_qos},
+	{0x80000020, handle_ext_amd_mem_qos},
+	{0x80000022, handle_ext_perfmon_v2},
 
 	/* Transmeta levels */
 	{0x80860000, handle_tmta_base},
@@ -293,6 +303,18 @@ const char *vendor_name(int vendor_id)
 	return pvendor->name;
 }
 
+const char *hybrid_core_type_name(uint32_t core_type)
+{
+	switch (core_type) {
+	case 0x20:
+		return "Intel Atom (efficient)";
+	case 0x40:
+		return "Intel Core (performance)";
+	default:
+		return "unknown";
+	}
+}
+
 /* EAX = 0000 0000 */
 static void handle_std_base(struct cpu_regs_t *regs, struct cpuid_state_t *state)
 {
@@ -402,6 +424,22 @@ static const struct amd_package_match_t
 	{ 0, 0, 0, NULL },
 };
 
+static void print_x86_64_level(struct cpuid_state_t *state)
+{
+	struct x86_64_level_info_t info;
+	uint32_t i;
+
+	x86_64_level_detail(state, &info);
+	printf("x86-64 microarchitecture level: %s\n", x86_64_level_name(info.level));
+	if (info.missing_count) {
+		printf("  Missing for %s:", x86_64_level_name((x86_64_level_t)(info.level + 1)));
+		for (i = 0; i < info.missing_count; i++)
+			printf(" %s", info.missing[i]);
+		printf("\n");
+	}
+	printf("\n");
+}
+
 /* EAX = 8000 0001 | EAX = 0000 0001 */
 static void handle_features(struct cpu_regs_t *regs, struct cpuid_state_t *state)
 {
@@ -474,6 +512,10 @@ static void handle_features(struct cpu_regs_t *regs, struct cpuid_state_t *state
 	}
 	if (print_features(regs, state))
 		printf("\n");
+
+	/* By the extended leaf, everything the psABI levels depend on is known. */
+	if (state->last_leaf.eax == 0x80000001)
+		print_x86_64_level(state);
 }
 
 /* EAX = 0000 0002 */
@@ -806,12 +848,21 @@ static void handle_std_perfmon(struct cpu_regs_t *regs, struct cpuid_state_t *st
 /* EAX = 0000 000B */
 static int probe_std_x2apic(struct cpu_regs_t *regs, struct cpuid_state_t *state, struct x2apic_state_t *x2apic)
 {
-	uint32_t i;
+	uint32_t i, leaf = 0xb;
 	uint32_t total_logical = state->thread_count(state);
 
+	/* Prefer leaf 0x1F, which also covers the levels 0xB merges away. */
+	if (state->curmax >= 0x1f) {
+		ZERO_REGS(regs);
+		regs->eax = 0x1f;
+		state->cpuid_call(regs, state);
+		if (regs->ebx)
+			leaf = 0x1f;
+	}
+
 	/* Check if x2APIC is supported. Early exit if not. */
 	ZERO_REGS(regs);
-	regs->eax = 0xb;
+	regs->eax = leaf;
 	state->cpuid_call(regs, state);
 	if (!regs->eax && !regs->ebx)
 		return 1;
@@ -824,7 +875,7 @@ static int probe_std_x2apic(struct cpu_regs_t *regs, struct cpuid_state_t *state
 	for (i = 0;; i++) {
 		uint32_t level, shift;
 		ZERO_REGS(regs);
-		regs->eax = 0xb;
+		regs->eax = leaf;
 		regs->ecx = i;
 		state->cpuid_call(regs, state);
 		if (!(regs->eax || regs->ebx || regs->ecx || regs->edx))
@@ -842,7 +893,7 @@ static int probe_std_x2apic(struct cpu_regs_t *regs, struct cpuid_state_t *state
 			x2apic->thread.mask = ~((unsigned)(-1) << shift);
 			x2apic->thread.reported = 1;
 			break;
-		case 2: /* Core level */
+		default: /* Core level, or module/tile/die above it from leaf 0x1F */
 			x2apic->core.total = regs->ebx & 0xffff;
 			x2apic->core.shift = shift;
 			x2apic->core.mask = ~((unsigned)(-1) << shift);
@@ -865,13 +916,12 @@ static int probe_std_x2apic(struct cpu_regs_t *regs, struct cpuid_state_t *state
 		return 1;
 	}
 
-	/* XXX: This is a totally non-standard way to determine the shift width,
-	 *      but the official method doesn't seem to work. Will troubleshoot
-	 *      more later on.
+	/* Each level reports how many APIC ID bits to shift out to reach the
+	 * next level's ID, so a field starts at the width of the level below it.
 	 */
-	x2apic->socket.shift = count_trailing_zero_bits(x2apic->socket.mask);
-	x2apic->core.shift = count_trailing_zero_bits(x2apic->core.mask);
-	x2apic->thread.shift = count_trailing_zero_bits(x2apic->thread.mask);
+	x2apic->socket.shift = x2apic->core.reported ? x2apic->core.shift : x2apic->thread.shift;
+	x2apic->core.shift = x2apic->thread.shift;
+	x2apic->thread.shift = 0;
 
 	/*
 	printf("  Socket mask: 0x%08x, shift: %d\n", x2apic->socket.mask, x2apic->socket.shift);
@@ -954,17 +1004,18 @@ static const char *xsave_leaf_name(uint32_t bit)
 		"512-bit AVX OpMask",
 		"512-bit AVX ZMM_Hi256",
 		"512-bit AVX ZMM_Hi16",
-		"IA32_XSS",
+		"Processor trace (IA32_XSS)",
 		"Protected keys",
-		NULL,
-		NULL,
-		NULL, /* IA32_XSS */
-		NULL, /* IA32_XSS */
-		NULL,
-		NULL, /* IA32_XSS */
-		"XTILECFG",
-		"XTILEDATA",
-
+		"PASID (IA32_XSS)",
+		"CET user state (IA32_XSS)",
+		"CET supervisor state (IA32_XSS)",
+		"HDC (IA32_XSS)",
+		"User interrupts (IA32_XSS)",
+		"Architectural LBRs (IA32_XSS)",
+		"HWP (IA32_XSS)",
+		"AMX XTILECFG",
+		"AMX XTILEDATA",
+		"APX extended GPRs",
 	};
 	if (bit < NELEM(bits))
 		return bits[bit];
@@ -985,10 +1036,53 @@ static const char *xsave_feature_name(uint32_t bit)
 	return NULL;
 }
 
+static void print_xsave_usage(struct cpuid_state_t *state)
+{
+	struct xsave_state_t xs;
+	struct isa_usable_t usable[16];
+	uint32_t i, count;
+
+	xsave_probe(state, &xs);
+
+	if (xs.xcr0_source == XCR0_UNAVAILABLE) {
+		printf("  XCR0: not enabled by the OS (OSXSAVE clear), no extended state usable\n\n");
+		return;
+	}
+
+	printf("  XCR0:   0x%016" PRIx64 " (%s)\n", xs.xcr0,
+	       xs.xcr0_source == XCR0_XGETBV ? "read with XGETBV" : "inferred from enabled size");
+	if (xs.has_xinuse)
+		printf("  XINUSE: 0x%016" PRIx64 "\n", xs.xinuse);
+	printf("  Per-thread save area: %u bytes (standard)", xs.enabled_size);
+	if (xs.compacted_size)
+		printf(", %u bytes (compacted, XCR0 | IA32_XSS)", xs.compacted_size);
+	printf("\n");
+
+	if (xs.xcr0 & ~xs.supported)
+		printf("  [WARNING] XCR0 enables components leaf 0xD doesn't list: 0x%" PRIx64 "\n",
+		       xs.xcr0 & ~xs.supported);
+	if (xs.xcr0_source == XCR0_XGETBV && xs.computed_size != xs.enabled_size)
+		printf("  [WARNING] Enabled size is %u bytes, but the components add up to %u\n",
+		       xs.enabled_size, xs.computed_size);
+
+	count = isa_usable(state, &xs, usable, NELEM(usable));
+	if (count) {
+		printf("  Usable ISA extensions:\n");
+		for (i = 0; i < count; i++) {
+			printf("    %-12s %s", usable[i].name, isa_status_name(usable[i].status));
+			if (usable[i].save_bytes)
+				printf(", %u bytes of state", usable[i].save_bytes);
+			printf("\n");
+		}
+	}
+	printf("\n");
+}
+
 /* EAX = 0000 000D */
 static void handle_std_ext_state(struct cpu_regs_t *regs, struct cpuid_state_t *state)
 {
-	int i, j, max = 0;
+	uint64_t components = 0;
+	int i, j;
 
 	if ((state->vendor & (VENDOR_INTEL | VENDOR_AMD)) == 0)
 		return;
@@ -997,7 +1091,11 @@ static void handle_std_ext_state(struct cpu_regs_t *regs, struct cpuid_state_t *
 
 	printf("Extended State Enumeration\n");
 
-	for (i = 0; i <= max; i++) {
+	for (i = 0; i < 64; i++) {
+
+		/* Past subleaf 1, there's one subleaf per supported component. */
+		if (i > 1 && !(components & (1ULL << i)))
+			continue;
 
 		ZERO_REGS(regs);
 		regs->eax = 0xd;
@@ -1011,6 +1109,7 @@ static void handle_std_ext_state(struct cpu_regs_t *regs, struct cpuid_state_t *
 			printf("  Extended state for %s requires %d bytes, offset %d\n",
 				name, regs->eax, regs->ebx);
 		} else if (i == 1) {
+			components |= ((uint64_t)regs->edx << 32) | regs->ecx;
 			if (!regs->eax)
 				continue;
 
@@ -1054,29 +1153,48 @@ static void handle_std_ext_state(struct cpu_regs_t *regs, struct cpuid_state_t *
 			printf("  Maximum size required for all supported features: %3d bytes\n",
 				regs->ecx);
 
-			max = popcnt(regs->eax) + popcnt(regs->edx) - 1;
+			components = ((uint64_t)regs->edx << 32) | regs->eax;
 			printf("\n");
 		}
 	}
-	if (max > 1)
-		printf("\n");
+	printf("\n");
+
+	print_xsave_usage(state);
 }
 
 /* EAX = 0000 000D */
 static void handle_dump_std_0D(struct cpu_regs_t *regs, struct cpuid_state_t *state)
 {
-	uint32_t i = 0;
-	while (1) {
+	uint64_t components;
+	uint32_t i;
+
+	ZERO_REGS(regs);
+	regs->eax = 0xd;
+	state->cpuid_call(regs, state);
+	if (!regs->eax)
+		return;
+	components = ((uint64_t)regs->edx << 32) | regs->eax;
+	state->cpuid_print(regs, state, TRUE);
+
+	ZERO_REGS(regs);
+	regs->eax = 0xd;
+	regs->ecx = 1;
+	state->cpuid_call(regs, state);
+	components |= ((uint64_t)regs->edx << 32) | regs->ecx;
+	state->cpuid_print(regs, state, TRUE);
+
+	/* One subleaf per state component, XCR0 (subleaf 0) and IA32_XSS
+	 * (subleaf 1) alike. Components the processor lacks read as zero, so
+	 * don't stop at the first empty one: AVX-512 and AMX sit above MPX.
+	 */
+	for (i = 2; i < 64; i++) {
+		if (!(components & (1ULL << i)))
+			continue;
 		ZERO_REGS(regs);
 		regs->eax = 0xd;
 		regs->ecx = i;
 		state->cpuid_call(regs, state);
-		if (i > 1 && !(regs->eax || regs->ebx || regs->ecx || regs->edx))
-			break;
-		else if (i == 0 && !regs->eax)
-			break;
 		state->cpuid_print(regs, state, TRUE);
-		i++;
 	}
 }
 
@@ -1144,6 +1262,13 @@ static void handle_std_qos_monitor(struct cpu_regs_t *regs, struct cpuid_state_t
 			{0x00000004, "L3 local external bandwidth"},
 			{0x00000000, NULL}
 		};
+		struct eax_l3qos {
+			unsigned counter_width_offset:8;
+			unsigned overflow_bit:1;
+			unsigned non_cpu_occupancy:1;
+			unsigned non_cpu_mbm:1;
+			unsigned reserved:21;
+		} *eax = (struct eax_l3qos *)&regs->eax;
 		struct edx_l3qos_feature *l3qos_feat;
 		ZERO_REGS(regs);
 		regs->eax = 0x0F;
@@ -1166,6 +1291,15 @@ static void handle_std_qos_monitor(struct cpu_regs_t *regs, struct cpuid_state_t
 		}
 		printf("    Conversion factor from QM_CTR to occupancy metric (bytes): %u\n", regs->ebx);
 		printf("    Maximum range of RMID within this resource type: %u\n", regs->ecx + 1);
+		printf("    Counter width: %u bits\n", eax->counter_width_offset + 24);
+		printf("    Counter wraps after: %" PRIu64 " MB\n",
+		       rdt_mbm_wrap_bytes(eax->counter_width_offset + 24, regs->ebx) >> 20);
+		if (eax->overflow_bit)
+			printf("    QM_CTR bit 61 flags counter overflow\n");
+		if (eax->non_cpu_occupancy)
+			printf("    Non-CPU agent cache occupancy monitoring\n");
+		if (eax->non_cpu_mbm)
+			printf("    Non-CPU agent memory bandwidth monitoring\n");
 
 	}
 
@@ -1173,12 +1307,64 @@ static void handle_std_qos_monitor(struct cpu_regs_t *regs, struct cpuid_state_t
 }
 
 /* EAX = 0000 0010 */
+static void print_cat(const char *name, const struct rdt_cat_t *cat)
+{
+	printf("  %s Cache Allocation Technology\n", name);
+	printf("    Capacity bitmask length: %u bits\n", cat->cbm_len);
+	printf("    Shareable bitmask: 0x%08x\n", cat->shareable);
+	printf("    Classes of service: %u\n", cat->clos_count);
+	if (cat->cdp)
+		printf("    Code and Data Prioritization (halves the usable classes of service)\n");
+	if (cat->non_cpu)
+		printf("    Allocation for non-CPU agents\n");
+	printf("    Non-contiguous capacity bitmasks %ssupported\n", cat->noncontiguous ? "" : "not ");
+	printf("\n");
+}
+
+static void handle_std_qos_enforce(struct cpu_regs_t *regs, struct cpuid_state_t *state)
+{
+	struct rdt_alloc_t alloc;
+	uint32_t unaccounted;
+
+	if ((state->vendor & (VENDOR_INTEL | VENDOR_AMD)) == 0)
+		return;
+
+	if (!regs->ebx)
+		return;
+
+	if (rdt_alloc_probe(state, &alloc) != 0)
+		return;
+
+	printf("Platform Quality-of-Service Enforcement\n");
+
+	unaccounted = regs->ebx & ~(RDT_RES_L3_CAT | RDT_RES_L2_CAT | RDT_RES_MBA);
+	if (unaccounted)
+		printf("  Unaccounted resource bits: 0x%08x\n", unaccounted);
+
+	if (alloc.resources & RDT_RES_L3_CAT)
+		print_cat("L3", &alloc.l3);
+	if (alloc.resources & RDT_RES_L2_CAT)
+		print_cat("L2", &alloc.l2);
+	if (alloc.resources & RDT_RES_MBA) {
+		printf("  Memory Bandwidth Allocation\n");
+		printf("    Maximum throttling value: %u\n", alloc.mba.max_delay);
+		printf("    Throttling granularity: %u%%\n", alloc.mba.granularity);
+		printf("    Response of the delay values is %slinear\n", alloc.mba.linear ? "" : "non-");
+		printf("    Classes of service: %u\n", alloc.mba.clos_count);
+		printf("\n");
+	}
+}
+
 static void handle_dump_std_10(struct cpu_regs_t *regs, struct cpuid_state_t *state)
 {
-	uint32_t i = 0, max;
+	uint32_t i, resources;
 	/* note subtle difference in register used here vs leaf 0x0f */
-	max = ((regs->ebx & 0x2) != 0) ? 1 : 0;
-	for (i = 0; i <= max; i++) {
+	resources = regs->ebx;
+	state->cpuid_print(regs, state, TRUE);
+	/* Each resource ID bit names the subleaf describing it. */
+	for (i = 1; i < 32; i++) {
+		if (!(resources & (1u << i)))
+			continue;
 		ZERO_REGS(regs);
 		regs->eax = 0x10;
 		regs->ecx = i;
@@ -1216,12 +1402,32 @@ static void handle_dump_std_12(struct cpu_regs_t *regs, struct cpuid_state_t *st
 }
 
 /* EAX = 0000 0014 */
+static void print_pt_encodings(const char *label, uint32_t bitmap, const char *unit,
+                               uint32_t (*value)(uint32_t))
+{
+	uint32_t n, count = 0;
+
+	if (!bitmap)
+		return;
+
+	printf("  %s:", label);
+	for (n = 0; n < 16; n++) {
+		if (!(bitmap & (1u << n)))
+			continue;
+		printf("%s %u (%u %s)", count++ ? "," : "", n, value(n), unit);
+	}
+	printf("\n");
+}
+
 static void handle_std_trace(struct cpu_regs_t *regs, struct cpuid_state_t *state)
 {
+	struct pt_caps_t caps;
+	struct pt_recommendation_t rec;
+
 	if ((state->vendor & (VENDOR_INTEL)) == 0)
 		return;
 
-	if (!regs->eax)
+	if (!regs->eax && !regs->ebx && !regs->ecx)
 		return;
 
 	printf("Processor Trace Enumeration\n");
@@ -1229,18 +1435,23 @@ static void handle_std_trace(struct cpu_regs_t *regs, struct cpuid_state_t *stat
 	print_features(regs, state);
 	printf("\n");
 
-	ZERO_REGS(regs);
-	regs->eax = 0x14;
-	regs->ecx = 1;
-	state->cpuid_call(regs, state);
-
-	printf("  Number of configurable address ranges for filtering: %u\n", regs->eax & 0x7);
-	printf("  Supported MTC period encodings: 0x%04x\n", (regs->eax >> 16) & 0xffff);
-
-	printf("  Supported cycle threshold value encodings: 0x%04x\n", regs->ebx & 0xffff);
-	printf("  Supported configurable PSB frequency encodings: 0x%04x\n", (regs->ebx >> 16) & 0xffff);
+	if (pt_probe(state, &caps) != 0)
+		return;
 
-	printf("\n");
+	printf("  Configurable address ranges for filtering: %u\n", caps.address_ranges);
+	print_pt_encodings("MTC period encodings", caps.mtc_periods, "crystal ticks", pt_mtc_period);
+	print_pt_encodings("Cycle threshold encodings", caps.cyc_thresholds, "cycles", pt_cyc_threshold);
+	print_pt_encodings("PSB frequency encodings", caps.psb_freqs, "bytes", pt_psb_bytes);
+
+	pt_recommend(&caps, &rec);
+	printf("  Lowest overhead setup: %s output", pt_output_name(rec.output));
+	if (rec.mtc_encoding >= 0)
+		printf(", MTCFreq %d", rec.mtc_encoding);
+	if (rec.psb_encoding >= 0)
+		printf(", PSBFreq %d", rec.psb_encoding);
+	if (rec.tnt_disable)
+		printf(", TNT disabled");
+	printf("\n\n");
 }
 
 /* EAX = 0000 0015 */
@@ -1300,92 +1511,166 @@ static void handle_std_cpufreq(struct cpu_regs_t *regs, struct cpuid_state_t *st
 	printf("\n");
 }
 
-/* Not fully implemented. Need to see some hardware that actually has this leaf
- * before I finish this.
- */
-
 /* EAX = 0000 0018 */
 static void handle_std_tlb(struct cpu_regs_t *regs, struct cpuid_state_t *state)
 {
-	uint32_t max_ecx = regs->eax;
-
-	struct eax_tlb_t {
-		unsigned reserved:32;
-	};
-	struct ebx_tlb_t {
-		unsigned has_4k_pages:1;
-		unsigned has_2m_pages:1;
-		unsigned has_4m_pages:1;
-		unsigned has_1g_pages:1;
-		unsigned reserved:4;
-		unsigned partitioning:3; /* 0: soft partitioning between logical processors sharing this structure */
-		unsigned reserved_1:5;
-		unsigned assoc:16;
-	};
-	struct ecx_tlb_t {
-		unsigned sets:32;
-	};
-	struct edx_tlb_t {
-		unsigned type:5;
-		unsigned level:3;
-		unsigned fully_assoc:1;
-		unsigned reserved:5;
-		unsigned max_threads_sharing:12; /* +1 encoded */
-		unsigned reserved_1:6;
-	};
-	uint32_t i = 0;
+	uint32_t i, max_ecx = regs->eax;
 	char buffer[256];
 
 	if ((state->vendor & VENDOR_INTEL) == 0)
 		return;
 
-	if ((regs->edx & 0xf) == 0)
+	/* Subleaf 0 may itself be invalid, with valid TLBs in later ones. */
+	if (!max_ecx && (regs->edx & 0x1f) == 0)
 		return;
 
 	printf("Deterministic Address Translation Parameters:\n");
 
 	for (i = 0; i <= max_ecx; i++) {
 		struct cache_desc_t tlb;
-		//struct eax_tlb_t *eax = (struct eax_tlb_t *)&regs->eax;
-		struct ebx_tlb_t *ebx = (struct ebx_tlb_t *)&regs->ebx;
-		struct ecx_tlb_t *ecx = (struct ecx_tlb_t *)&regs->ecx;
-		struct edx_tlb_t *edx = (struct edx_tlb_t *)&regs->edx;
 
 		ZERO_REGS(regs);
 		regs->eax = 0x18;
 		regs->ecx = i;
 		state->cpuid_call(regs, state);
 
-		memset(&tlb, 0, sizeof(struct cache_desc_t));
-		switch(edx->type) {
-		case 0: continue; /* Invalid */
-		case 1: tlb.type = DATA_TLB; break;
-		case 2: tlb.type = CODE_TLB; break;
-		case 3: tlb.type = SHARED_TLB; break;
-		case 4: tlb.type = LOADONLY_TLB; break;
-		case 5: tlb.type = STOREONLY_TLB; break;
-		default: printf("  Unknown TLB type: %x (%d)\n\n", edx->type, edx->type); continue;
+		if (decode_intel_tlb(regs, &tlb) != 0) {
+			if (regs->edx & 0x1f)
+				printf("  Unknown TLB type: %x (%d)\n\n", regs->edx & 0x1f, regs->edx & 0x1f);
+			continue;
 		}
 
-		tlb.level = edx->level;
-		if (ebx->has_4k_pages)
-			tlb.attrs |=  PAGES_4K;
-		if (ebx->has_2m_pages)
-			tlb.attrs |=  PAGES_2M;
-		if (ebx->has_4m_pages)
-			tlb.attrs |=  PAGES_4M;
-		if (ebx->has_1g_pages)
-			tlb.attrs |=  PAGES_1G;
-		tlb.assoc = edx->fully_assoc ? 0xFF : ebx->assoc;
-		tlb.partitions = ebx->partitioning;
-		tlb.size = ecx->sets;
-		tlb.max_threads_sharing = edx->max_threads_sharing + 1;
-
 		describe_cache(state->logical_in_socket, &tlb, buffer, sizeof(buffer), 2);
 		printf("%s\n", buffer);
 	}
 }
 
+/* EAX = 0000 001A */
+static void handle_std_hybrid(struct cpu_regs_t *regs, struct cpuid_state_t *state)
+{
+	struct eax_hybrid_t {
+		unsigned native_model:24;
+		unsigned core_type:8;
+	};
+	struct eax_hybrid_t *eax = (struct eax_hybrid_t *)&regs->eax;
+
+	if ((state->vendor & VENDOR_INTEL) == 0)
+		return;
+
+	if (!regs->eax)
+		return;
+
+	printf("Hybrid Information:\n");
+	printf("  Core type: %s (0x%02x)\n", hybrid_core_type_name(eax->core_type), eax->core_type);
+	printf("  Native model ID: 0x%06x\n\n", eax->native_model);
+}
+
+/* EAX = 0000 001D */
+static void handle_std_tile(struct cpu_regs_t *regs, struct cpuid_state_t *state)
+{
+	struct amx_info_t amx;
+	uint32_t i;
+
+	if (!(state->vendor & VENDOR_INTEL))
+		return;
+
+	if (!regs->eax || amx_probe(state, &amx) != 0)
+		return;
+
+	printf("Tile Information (AMX):\n");
+	printf("  Highest palette: %u\n", amx.palette_count);
+	for (i = 1; i <= amx.palette_count; i++) {
+		const struct amx_palette_t *p = &amx.palettes[i];
+		printf("  Palette %u:\n", i);
+		printf("    Tile registers: %u\n", p->max_names);
+		printf("    Rows per tile: %u\n", p->max_rows);
+		printf("    Bytes per row: %u\n", p->bytes_per_row);
+		printf("    Bytes per tile: %u\n", p->bytes_per_tile);
+		printf("    Bytes for all tiles: %u\n", p->total_bytes);
+	}
+	printf("\n");
+}
+
+/* EAX = 0000 001E */
+static void handle_std_tmul(struct cpu_regs_t *regs, struct cpuid_state_t *state)
+{
+	struct amx_info_t amx;
+	uint32_t i;
+
+	if (!(state->vendor & VENDOR_INTEL))
+		return;
+
+	if (!regs->ebx || amx_probe(state, &amx) != 0)
+		return;
+
+	printf("TMUL Information (AMX):\n");
+	printf("  Maximum rows or columns (K): %u\n", amx.tmul_maxk);
+	printf("  Maximum column bytes (N): %u\n", amx.tmul_maxn);
+	printf("  Data types:\n");
+	for (i = 0; i < 32; i++) {
+		const char *name = amx_feature_name(i);
+		if ((amx.features & (1u << i)) && name)
+			printf("    %s\n", name);
+	}
+	printf("\n");
+}
+
+/* EAX = 0000 001F */
+static void handle_std_x2apic_v2(struct cpu_regs_t *regs, struct cpuid_state_t *state)
+{
+	static const char *level_names[] = {
+		"invalid",
+		"SMT",
+		"core",
+		"module",
+		"tile",
+		"die",
+		"die group"
+	};
+	struct level_t {
+		uint32_t type;
+		uint32_t shift;
+	} levels[16];
+	uint32_t i, count = 0, id = 0;
+
+	if (!regs->ebx)
+		return;
+
+	printf("V2 Extended Topology:\n");
+	for (i = 0; i < NELEM(levels); i++) {
+		uint32_t type;
+		ZERO_REGS(regs);
+		regs->eax = 0x1f;
+		regs->ecx = i;
+		state->cpuid_call(regs, state);
+		type = (regs->ecx >> 8) & 0xff;
+		if (!type)
+			break;
+		id = regs->edx;
+		levels[count].type = type;
+		levels[count].shift = regs->eax & 0x1f;
+		printf("  Level %u: %-10s %5u logical processors, next level ID at bit %u\n", i,
+		       type < NELEM(level_names) ? level_names[type] : "unknown",
+		       regs->ebx & 0xffff, levels[count].shift);
+		count++;
+	}
+	if (!count) {
+		printf("\n");
+		return;
+	}
+
+	/* Each field sits between the shift of the level below and its own. */
+	printf("\n  x2APIC ID %u (package %u", id, id >> levels[count - 1].shift);
+	for (i = count; i-- > 0; ) {
+		uint32_t below = i ? levels[i - 1].shift : 0;
+		uint32_t mask = (levels[i].shift >= 32) ? ~0U : (1U << levels[i].shift) - 1;
+		printf(", %s %u",
+		       levels[i].type < NELEM(level_names) ? level_names[levels[i].type] : "unknown",
+		       (id & mask) >> below);
+	}
+	printf(")\n\n");
+}
+
 /* EAX = 0000 001B */
 static void handle_dump_std_1B(struct cpu_regs_t *regs, struct cpuid_state_t *state)
 {
@@ -1417,6 +1702,81 @@ static void handle_dump_std_1B(struct cpu_regs_t *regs, struct cpuid_state_t *st
 	}
 }
 
+/* EAX = 0000 0023 */
+static void handle_std_perfmon_ext(struct cpu_regs_t *regs, struct cpuid_state_t *state)
+{
+	struct perfmon_ext_ebx_t {
+		unsigned umask2:1;
+		unsigned eq:1;
+		unsigned rdpmc_user_disable:1;
+		unsigned reserved:29;
+	} *ebx = (struct perfmon_ext_ebx_t *)&regs->ebx;
+	const char *events[] = {
+		"Core cycles", "Instructions retired", "Reference cycles",
+		"Last-level cache reference", "Last-level cache miss",
+		"Branches retired", "Branches mispredicted", "Top-down slots",
+		"Top-down backend bound", "Top-down bad speculation",
+		"Top-down frontend bound", "Top-down retiring", "LBR inserts",
+	};
+	struct pmu_budget_t budget;
+	uint32_t i;
+
+	if ((state->vendor & VENDOR_INTEL) == 0)
+		return;
+
+	if (!(regs->eax & 0x1))
+		return;
+
+	if (pmu_probe(state, &budget) != 0)
+		return;
+
+	printf("Architectural Performance Monitoring Extended\n");
+	if (ebx->umask2)
+		printf("  UnitMask2 field in PERFEVTSEL\n");
+	if (ebx->eq)
+		printf("  EQ bit in PERFEVTSEL\n");
+	if (ebx->rdpmc_user_disable)
+		printf("  RDPMC user disable\n");
+	if (budget.topdown_slots)
+		printf("  Top-down slots per cycle: %u\n", budget.topdown_slots);
+	printf("  General-purpose counters: %u (mask 0x%08x)\n", budget.gp_counters, budget.gp_mask);
+	printf("  Fixed-function counters: %u (mask 0x%08x)\n", budget.fixed_counters, budget.fixed_mask);
+	if (regs->eax & 0x4)
+		printf("  Auto counter reload: general-purpose mask 0x%08x, fixed mask 0x%08x\n",
+		       budget.acr_gp_mask, budget.acr_fixed_mask);
+	if (regs->eax & 0x8) {
+		printf("  Architectural events:\n");
+		for (i = 0; i < 32; i++) {
+			if (!(budget.arch_events & (1u << i)))
+				continue;
+			if (i < NELEM(events))
+				printf("    %s\n", events[i]);
+			else
+				printf("    Unknown event (bit %u)\n", i);
+		}
+	}
+	printf("\n");
+}
+
+/* EAX = 0000 0023 */
+static void handle_dump_std_23(struct cpu_regs_t *regs, struct cpuid_state_t *state)
+{
+	uint32_t i, valid = regs->eax;
+
+	state->cpuid_print(regs, state, TRUE);
+
+	/* Subleaf 0 EAX is a bitmap of the valid subleaves. */
+	for (i = 1; i < 32; i++) {
+		if (!(valid & (1u << i)))
+			continue;
+		ZERO_REGS(regs);
+		regs->eax = 0x23;
+		regs->ecx = i;
+		state->cpuid_call(regs, state);
+		state->cpuid_print(regs, state, TRUE);
+	}
+}
+
 /* EAX = 8000 0000 */
 static void handle_ext_base(struct cpu_regs_t *regs, struct cpuid_state_t *state)
 {
@@ -1554,25 +1914,6 @@ static void handle_ext_amdl1cachefeat(struct cpu_regs_t *regs, __unused_variable
 	printf("\n");
 }
 
-static const uint8_t amd_assoc_map[] = {
-	/* 0x00 */ 0,
-	/* 0x01 */ 1,
-	/* 0x02 */ 2,
-	/* 0x03 */ 0,
-	/* 0x04 */ 4,
-	/* 0x05 */ 0,
-	/* 0x06 */ 8,
-	/* 0x07 */ 0,
-	/* 0x08 */ 16,
-	/* 0x09 */ 0,
-	/* 0x0A */ 32,
-	/* 0x0B */ 48,
-	/* 0x0C */ 64,
-	/* 0x0D */ 96,
-	/* 0x0E */ 128,
-	/* 0x0F */ 0xff
-};
-
 /* EAX = 8000 0006 */
 static void handle_ext_l2cachefeat(struct cpu_regs_t *regs, __unused_variable struct cpuid_state_t *state)
 {
@@ -1663,7 +2004,7 @@ static void handle_ext_l2cachefeat(struct cpu_regs_t *regs, __unused_variable st
 			memset(&desc, 0, sizeof(struct cache_desc_t));
 			desc.level = 2;
 			desc.type = DATA_TLB;
-			desc.assoc = tlb->dtlb_assoc == 0x6 ? 8 : 0;
+			desc.assoc = amd_assoc_ways(tlb->dtlb_assoc);
 			desc.size = tlb->dtlb_size;
 			desc.attrs = PAGES_4K;
 			printf("%s\n", describe_cache(state->logical_in_socket, &desc, desc_str, sizeof(desc_str), 2));
@@ -1672,7 +2013,7 @@ static void handle_ext_l2cachefeat(struct cpu_regs_t *regs, __unused_variable st
 			memset(&desc, 0, sizeof(struct cache_desc_t));
 			desc.level = 2;
 			desc.type = CODE_TLB;
-			desc.assoc = tlb->itlb_assoc == 0x6 ? 8 : 0;
+			desc.assoc = amd_assoc_ways(tlb->itlb_assoc);
 			desc.size = tlb->itlb_size;
 			desc.attrs = PAGES_4K;
 			printf("%s\n", describe_cache(state->logical_in_socket, &desc, desc_str, sizeof(desc_str), 2));
@@ -1683,7 +2024,7 @@ static void handle_ext_l2cachefeat(struct cpu_regs_t *regs, __unused_variable st
 			memset(&desc, 0, sizeof(struct cache_desc_t));
 			desc.level = 2;
 			desc.type = DATA_TLB;
-			desc.assoc = tlb->dtlb_assoc == 0x4 ? 4 : 0;
+			desc.assoc = amd_assoc_ways(tlb->dtlb_assoc);
 			desc.size = tlb->dtlb_size;
 			desc.attrs = PAGES_2M | PAGES_4M;
 			printf("%s\n", describe_cache(state->logical_in_socket, &desc, desc_str, sizeof(desc_str), 2));
@@ -1692,7 +2033,7 @@ static void handle_ext_l2cachefeat(struct cpu_regs_t *regs, __unused_variable st
 			memset(&desc, 0, sizeof(struct cache_desc_t));
 			desc.level = 2;
 			desc.type = CODE_TLB;
-			desc.assoc = tlb->itlb_assoc == 0x6 ? 8 : 0;
+			desc.assoc = amd_assoc_ways(tlb->itlb_assoc);
 			desc.size = tlb->itlb_size;
 			desc.attrs = PAGES_2M | PAGES_4M;
 			printf("%s\n", describe_cache(state->logical_in_socket, &desc, desc_str, sizeof(desc_str), 2));
@@ -1714,7 +2055,7 @@ static void handle_ext_l2cachefeat(struct cpu_regs_t *regs, __unused_variable st
 			desc.level = 2;
 			desc.type = UNIFIED;
 			desc.size = l2_cache->size;
-			desc.assoc = l2_cache->assoc < NELEM(amd_assoc_map) ? amd_assoc_map[l2_cache->assoc] : 0;
+			desc.assoc = amd_assoc_ways(l2_cache->assoc);
 			desc.linesize = l2_cache->linesize;
 			printf("%s\n", describe_cache(state->logical_in_socket, &desc, desc_str, sizeof(desc_str), 2));
 		}
@@ -1733,7 +2074,7 @@ static void handle_ext_l2cachefeat(struct cpu_regs_t *regs, __unused_variable st
 			desc.level = 3;
 			desc.type = UNIFIED;
 			desc.size = size;
-			desc.assoc = l3_cache->assoc < NELEM(amd_assoc_map) ? amd_assoc_map[l3_cache->assoc] : 0;
+			desc.assoc = amd_assoc_ways(l3_cache->assoc);
 			desc.linesize = l3_cache->linesize;
 			printf("%s\n", describe_cache(state->logical_in_socket, &desc, desc_str, sizeof(desc_str), 2));
 		}
@@ -1861,14 +2202,14 @@ static void handle_ext_amd_1g_tlb(struct cpu_regs_t *regs, __unused_variable str
 		if (tlb->dtlb_ent) {
 			desc.level = i + 1;
 			desc.type = DATA_TLB;
-			desc.assoc = tlb->dtlb_assoc < NELEM(amd_assoc_map) ? amd_assoc_map[tlb->dtlb_assoc] : 0;
+			desc.assoc = amd_assoc_ways(tlb->dtlb_assoc);
 			desc.size = tlb->dtlb_ent;
 			printf("%s\n", describe_cache(state->logical_in_socket, &desc, desc_str, sizeof(desc_str), 2));
 		}
 		if (tlb->itlb_ent) {
 			desc.level = i + 1;
 			desc.type = CODE_TLB;
-			desc.assoc = tlb->itlb_assoc < NELEM(amd_assoc_map) ? amd_assoc_map[tlb->itlb_assoc] : 0;
+			desc.assoc = amd_assoc_ways(tlb->itlb_assoc);
 			desc.size = tlb->itlb_ent;
 			printf("%s\n", describe_cache(state->logical_in_socket, &desc, desc_str, sizeof(desc_str), 2));
 		}
@@ -1888,12 +2229,35 @@ static void handle_ext_perf_opt_feat(struct cpu_regs_t *regs, struct cpuid_state
 /* EAX = 8000 001B */
 static void handle_ext_ibs_feat(struct cpu_regs_t *regs, struct cpuid_state_t *state)
 {
+	struct ibs_caps_t caps;
+	struct ibs_recommendation_t rec;
+
 	if (!(state->vendor & VENDOR_AMD))
 		return;
 	if (!regs->eax)
 		return;
 	printf("Instruction Based Sampling identifiers:\n");
 	print_features(regs, state);
+
+	if (ibs_probe(state, &caps) != 0) {
+		printf("\n");
+		return;
+	}
+	ibs_recommend(&caps, &rec);
+	if (caps.op_sampling)
+		printf("  Maximum op sampling period: %" PRIu64 " %s\n", caps.max_op_period,
+		       caps.op_count_mode ? "ops or cycles" : "cycles");
+	if (caps.fetch_sampling)
+		printf("  Maximum fetch sampling period: %" PRIu64 " cycles\n", caps.max_fetch_period);
+	if (rec.sample != IBS_SAMPLE_NONE) {
+		printf("  Lowest overhead always-on setup: %s sampling every %" PRIu64 " %s",
+		       ibs_sample_name(rec.sample), rec.period, rec.count_ops ? "ops" : "cycles");
+		if (rec.discard_invalid_rip)
+			printf(", discarding invalid RIPs");
+		if (rec.l3_miss_only)
+			printf(", L3 misses only for memory profiles");
+		printf("\n");
+	}
 	printf("\n");
 }
 
@@ -2042,15 +2406,126 @@ static void handle_ext_extapic(struct cpu_regs_t *regs, struct cpuid_state_t *st
 }
 
 /* EAX = 8000 0020 */
+static void print_amd_bw_limit(const char *name, const struct rdt_amd_bw_t *bw)
+{
+	printf("  %s\n", name);
+	printf("    Bandwidth limit field: %u bits (1/8 GB/s units, up to %" PRIu64 " MB/s)\n",
+	       bw->bw_len, rdt_amd_bw_max_mbps(bw));
+	printf("    Classes of service: %u\n", bw->clos_count);
+	printf("\n");
+}
+
+static void handle_ext_amd_mem_qos(struct cpu_regs_t *regs, struct cpuid_state_t *state)
+{
+	struct rdt_amd_qos_t qos;
+	uint32_t i, unaccounted;
+
+	if ((state->vendor & (VENDOR_AMD | VENDOR_HYGON)) == 0)
+		return;
+
+	if (!regs->ebx)
+		return;
+
+	if (rdt_amd_probe(state, &qos) != 0)
+		return;
+
+	printf("AMD Platform Quality-of-Service Extensions\n");
+
+	unaccounted = regs->ebx & ~(RDT_AMD_L3BE | RDT_AMD_SMBA | RDT_AMD_BMEC |
+	                            RDT_AMD_ABMC | RDT_AMD_SDCIAE);
+	if (unaccounted)
+		printf("  Unaccounted feature bits: 0x%08x\n", unaccounted);
+	if (qos.features & RDT_AMD_SDCIAE)
+		printf("  L3 smart data cache injection allocation enforcement\n");
+	if (unaccounted || (qos.features & RDT_AMD_SDCIAE))
+		printf("\n");
+
+	if (qos.features & RDT_AMD_L3BE)
+		print_amd_bw_limit("L3 external bandwidth enforcement", &qos.l3be);
+	if (qos.features & RDT_AMD_SMBA)
+		print_amd_bw_limit("Slow memory bandwidth enforcement", &qos.smba);
+
+	if (qos.features & RDT_AMD_BMEC) {
+		printf("  Bandwidth monitoring event configuration\n");
+		printf("    Configurable events: %u\n", qos.bmec_events);
+		printf("    Countable traffic:\n");
+		for (i = 0; i < 32; i++) {
+			const char *name = rdt_bmec_source_name(i);
+			if (!(qos.bmec_sources & (1u << i)))
+				continue;
+			if (name)
+				printf("      %s\n", name);
+			else
+				printf("      unknown (bit %u)\n", i);
+		}
+		printf("\n");
+	}
+
+	if (qos.features & RDT_AMD_ABMC) {
+		printf("  Assignable bandwidth monitoring counters\n");
+		printf("    Counters: %u\n", qos.abmc_counters);
+		printf("    Counter width: %u bits%s\n", qos.abmc_width,
+		       qos.abmc_overflow ? ", with overflow bit" : "");
+		if (qos.abmc_select_cos)
+			printf("    Counters can track a class of service instead of an RMID\n");
+		printf("\n");
+	}
+}
+
 static void handle_dump_ext_20(struct cpu_regs_t *regs, struct cpuid_state_t *state)
 {
-	state->cpuid_print(regs, state, TRUE);
+	uint32_t i, features = regs->ebx;
 
-	ZERO_REGS(regs);
-	regs->eax = 0x80000020;
-	regs->ecx = 1;
-	state->cpuid_call(regs, state);
 	state->cpuid_print(regs, state, TRUE);
+
+	/* Subleaf N describes feature bit N, where that feature has one. */
+	for (i = 1; i < 32; i++) {
+		if (!(features & (1u << i)))
+			continue;
+		ZERO_REGS(regs);
+		regs->eax = 0x80000020;
+		regs->ecx = i;
+		state->cpuid_call(regs, state);
+		state->cpuid_print(regs, state, TRUE);
+	}
+}
+
+/* EAX = 8000 0022 */
+static void handle_ext_perfmon_v2(struct cpu_regs_t *regs, struct cpuid_state_t *state)
+{
+	struct perfmon_v2_eax_t {
+		unsigned perfmon_v2:1;
+		unsigned lbr_stack:1;
+		unsigned lbr_pmc_freeze:1;
+		unsigned reserved:29;
+	} *eax = (struct perfmon_v2_eax_t *)&regs->eax;
+	struct perfmon_v2_ebx_t {
+		unsigned core_counters:4;
+		unsigned lbr_stack_size:6;
+		unsigned nb_counters:6;
+		unsigned umc_counters:6;
+		unsigned reserved:10;
+	} *ebx = (struct perfmon_v2_ebx_t *)&regs->ebx;
+
+	if ((state->vendor & (VENDOR_AMD | VENDOR_HYGON)) == 0)
+		return;
+
+	if (!regs->eax && !regs->ebx)
+		return;
+
+	printf("Extended Performance Monitoring and Debug\n");
+	if (eax->perfmon_v2)
+		printf("  Performance monitoring version 2 (global control and status)\n");
+	if (eax->lbr_stack)
+		printf("  Last branch record stack: %u entries\n", ebx->lbr_stack_size);
+	if (eax->lbr_pmc_freeze)
+		printf("  Freezing LBR and counters on counter overflow\n");
+	printf("  Core performance counters: %u\n", ebx->core_counters);
+	printf("  Data fabric performance counters: %u\n", ebx->nb_counters);
+	printf("  Memory controller performance counters: %u\n", ebx->umc_counters);
+	if (regs->ecx)
+		printf("  Active memory controllers: 0x%08x\n", regs->ecx);
+	printf("\n");
 }
 
 /* EAX = 8086 0000 */
@@ -35,6 +35,9 @@ extern const struct cpuid_leaf_handler_index_t decode_handlers[];
 int vendor_id(const char *vendor);
 const char *vendor_name(int vendor_id);
 
+/* Name of a leaf 0x1A core type (EAX[31:24]). */
+const char *hybrid_core_type_name(uint32_t core_type);
+
 #endif
 
 /* vim: set ts=4 sts=4 sw=4 noet: */
@@ -0,0 +1,274 @@
+/*
+ * CPUID
+ *
+ * A simple and small tool to dump/decode CPUID information.
+ *
+ * Copyright (c) 2010-2025, Steven Noonan <steven@uplinklabs.net>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "prefix.h"
+
+#include "hints.h"
+#include "state.h"
+#include "topology.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* The legacy AMD leaves describe the L1/L2/L3 caches in ECX/EDX, for
+ * processors without leaf 0x8000001D.
+ */
+static void probe_amd_legacy(struct cpuid_state_t *state, struct tuning_hints_t *hints,
+                             uint32_t maxext)
+{
+	struct cpu_regs_t regs;
+
+	if (maxext >= 0x80000005) {
+		ZERO_REGS(&regs);
+		regs.eax = 0x80000005;
+		state->cpuid_call(&regs, state);
+		hints->l1d_size = (regs.ecx >> 24) * 1024;
+		hints->l1d_assoc = (regs.ecx >> 16) & 0xff;
+		hints->line_size = regs.ecx & 0xff;
+	}
+
+	if (maxext >= 0x80000006) {
+		ZERO_REGS(&regs);
+		regs.eax = 0x80000006;
+		state->cpuid_call(&regs, state);
+		hints->l2_size = (regs.ecx >> 16) * 1024;
+		hints->l2_assoc = amd_assoc_ways((regs.ecx >> 12) & 0xf);
+		hints->l2_cores = 1;
+		if (regs.edx >> 18) {
+			hints->llc_level = 3;
+			hints->llc_size = (regs.edx >> 18) * 512 * 1024;
+		} else if (hints->l2_size) {
+			hints->llc_level = 2;
+			hints->llc_size = hints->l2_size;
+		}
+	}
+}
+
+/* Fills in cache sizes from the leaf 2 descriptors, for processors without
+ * leaf 4. These give no sharing information, so the LLC counts as private.
+ */
+static void caches_from_descriptors(struct tuning_hints_t *hints,
+                                    const struct cache_desc_t *descs, uint32_t count)
+{
+	uint32_t i;
+	for (i = 0; i < count; i++) {
+		const struct cache_desc_t *desc = &descs[i];
+		if (desc->type != DATA && desc->type != UNIFIED)
+			continue;
+		if (desc->level == L1 && !hints->l1d_size) {
+			hints->l1d_size = desc->size * 1024;
+			hints->l1d_assoc = desc->assoc;
+			hints->line_size = desc->linesize;
+		} else if (desc->level == L2 && !hints->l2_size) {
+			hints->l2_size = desc->size * 1024;
+			hints->l2_assoc = desc->assoc;
+			hints->l2_cores = 1;
+		}
+		if (desc->level != NO && (uint32_t)desc->level >= hints->llc_level) {
+			hints->llc_level = desc->level;
+			hints->llc_size = desc->size * 1024;
+		}
+	}
+}
+
+/* Counts the CPUs sharing cpus[0]'s cache at 'level', and separately the
+ * distinct cores among them.
+ */
+static uint32_t count_sharing(const struct topology_t *topo, cache_level_t level, uint32_t *cores)
+{
+	uint32_t i, j, threads = 0;
+
+	*cores = 0;
+	for (i = 0; i < topo->count; i++) {
+		if (!topology_shares_cache(topo, 0, i, level))
+			continue;
+		threads++;
+		for (j = 0; j < i; j++) {
+			if (topology_shares_cache(topo, 0, j, level) &&
+			    topo->cpus[j].package == topo->cpus[i].package &&
+			    topo->cpus[j].core == topo->cpus[i].core)
+				break;
+		}
+		if (j == i)
+			(*cores)++;
+	}
+	return threads;
+}
+
+static void caches_from_topology(const struct topology_t *topo, struct tuning_hints_t *hints)
+{
+	const struct topology_cpu_t *cpu = &topo->cpus[0];
+	const struct topology_cache_t *cache;
+	uint32_t i, cores;
+
+	cache = topology_cache(cpu, L1);
+	if (cache) {
+		hints->l1d_size = cache->desc.size * 1024;
+		hints->l1d_assoc = cache->desc.assoc;
+		hints->line_size = cache->desc.linesize;
+	}
+
+	cache = topology_cache(cpu, L2);
+	if (cache) {
+		count_sharing(topo, L2, &cores);
+		hints->l2_cores = cores ? cores : 1;
+		hints->l2_size = cache->desc.size * 1024 / hints->l2_cores;
+		hints->l2_assoc = cache->desc.assoc;
+	}
+
+	for (i = 0; i < cpu->cache_count; i++) {
+		cache = &cpu->caches[i];
+		if (cache->desc.type == CODE)
+			continue;
+		if ((uint32_t)cache->desc.level < hints->llc_level)
+			continue;
+		hints->llc_level = cache->desc.level;
+		hints->llc_size = cache->desc.size * 1024;
+		hints->llc_threads = count_sharing(topo, cache->desc.level, &cores);
+	}
+}
+
+int tuning_hints_probe(struct cpuid_state_t *state, const struct topology_t *topo,
+                       struct tuning_hints_t *hints)
+{
+	struct cache_desc_t descs[32];
+	struct tlb_info_t tlbs;
+	struct cpu_signature_t sig;
+	struct cpu_regs_t regs;
+	uint32_t maxleaf, maxext, ndescs = 0;
+
+	memset(hints, 0, sizeof(struct tuning_hints_t));
+	if (!topo->count)
+		return 1;
+
+	hints->cpu = topo->cpus[0].cpu;
+	if (state->thread_bind(state, hints->cpu) != 0)
+		return 1;
+
+	ZERO_REGS(&regs);
+	state->cpuid_call(&regs, state);
+	maxleaf = regs.eax;
+
+	ZERO_REGS(&regs);
+	regs.eax = 0x80000000;
+	state->cpuid_call(&regs, state);
+	maxext = (regs.eax & 0xffff0000) == 0x80000000 ? regs.eax : 0;
+
+	memset(&sig, 0, sizeof(sig));
+	if (maxleaf >= 1) {
+		ZERO_REGS(&regs);
+		regs.eax = 1;
+		state->cpuid_call(&regs, state);
+		memcpy(&sig, &regs.eax, sizeof(sig));
+		hints->clflush_size = ((regs.ebx >> 8) & 0xff) * 8;
+	}
+
+	if (maxleaf >= 2 && (topo->vendor & VENDOR_INTEL)) {
+		ZERO_REGS(&regs);
+		regs.eax = 2;
+		state->cpuid_call(&regs, state);
+		ndescs = decode_intel_caches(&regs, &sig, descs, NELEM(descs), &hints->prefetch_size);
+	}
+
+	caches_from_topology(topo, hints);
+	if (!hints->llc_level)
+		caches_from_descriptors(hints, descs, ndescs);
+
+	if (!hints->llc_level && (topo->vendor & (VENDOR_AMD | VENDOR_HYGON)))
+		probe_amd_legacy(state, hints, maxext);
+
+	if (!hints->line_size)
+		hints->line_size = hints->clflush_size;
+	if (!hints->llc_threads && hints->llc_level)
+		hints->llc_threads = 1;
+	if (hints->llc_threads)
+		hints->llc_per_thread = hints->llc_size / hints->llc_threads;
+	if (hints->prefetch_size && hints->line_size)
+		hints->prefetch_lines = hints->prefetch_size / hints->line_size;
+
+	tlb_probe(state, topo->vendor, &tlbs);
+	tlb_reach(&tlbs, hints->tlb);
+
+	return 0;
+}
+
+static void print_json(const struct tuning_hints_t *hints)
+{
+	tlb_page_size_t i;
+
+	printf("{\n  \"cpu\": %u,\n  \"line_size\": %u,\n  \"clflush_size\": %u,\n",
+	       hints->cpu, hints->line_size, hints->clflush_size);
+	printf("  \"prefetch\": { \"bytes\": %u, \"lines\": %u },\n",
+	       hints->prefetch_size, hints->prefetch_lines);
+	printf("  \"l1d\": { \"bytes_per_core\": %u, \"ways\": %u },\n",
+	       hints->l1d_size, hints->l1d_assoc);
+	printf("  \"l2\": { \"bytes_per_core\": %u, \"ways\": %u, \"cores_sharing\": %u },\n",
+	       hints->l2_size, hints->l2_assoc, hints->l2_cores);
+	printf("  \"llc\": { \"level\": %u, \"bytes\": %u, \"threads_sharing\": %u, \"bytes_per_thread\": %u },\n",
+	       hints->llc_level, hints->llc_size, hints->llc_threads, hints->llc_per_thread);
+	printf("  \"tlb\": [");
+	for (i = 0; i < TLB_PAGE_SIZES; i++) {
+		const struct tlb_reach_t *tlb = &hints->tlb[i];
+		printf("%s\n    { \"page_size\": \"%s\", \"l1_entries\": %u, \"l2_entries\": %u, \"reach\": %" PRIu64 " }",
+		       i ? "," : "", tlb_page_size_name(i), tlb->l1_entries, tlb->l2_entries, tlb->reach);
+	}
+	printf("\n  ]\n}\n");
+}
+
+static void print_header(const struct tuning_hints_t *hints)
+{
+	tlb_page_size_t i;
+
+	printf("/* Generated by cpuid --tuning-hints=header for CPU %u.\n"
+	       " * Sizes are in bytes; zero means the processor doesn't report it.\n"
+	       " */\n\n", hints->cpu);
+	printf("#ifndef CPUID_TUNING_HINTS_H\n#define CPUID_TUNING_HINTS_H\n\n");
+	printf("#define CPUID_HINT_LINE_SIZE %u\n", hints->line_size);
+	printf("#define CPUID_HINT_CLFLUSH_SIZE %u\n", hints->clflush_size);
+	printf("#define CPUID_HINT_PREFETCH_BYTES %u\n", hints->prefetch_size);
+	printf("#define CPUID_HINT_PREFETCH_LINES %u\n\n", hints->prefetch_lines);
+	printf("#define CPUID_HINT_L1D_BYTES_PER_CORE %u\n", hints->l1d_size);
+	printf("#define CPUID_HINT_L1D_WAYS %u\n", hints->l1d_assoc);
+	printf("#define CPUID_HINT_L2_BYTES_PER_CORE %u\n", hints->l2_size);
+	printf("#define CPUID_HINT_L2_WAYS %u\n", hints->l2_assoc);
+	printf("#define CPUID_HINT_LLC_LEVEL %u\n", hints->llc_level);
+	printf("#define CPUID_HINT_LLC_BYTES %u\n", hints->llc_size);
+	printf("#define CPUID_HINT_LLC_THREADS %u\n", hints->llc_threads);
+	printf("#define CPUID_HINT_LLC_BYTES_PER_THREAD %u\n\n", hints->llc_per_thread);
+	for (i = 0; i < TLB_PAGE_SIZES; i++) {
+		const struct tlb_reach_t *tlb = &hints->tlb[i];
+		printf("#define CPUID_HINT_TLB_%s_L1_ENTRIES %u\n", tlb_page_size_name(i), tlb->l1_entries);
+		printf("#define CPUID_HINT_TLB_%s_L2_ENTRIES %u\n", tlb_page_size_name(i), tlb->l2_entries);
+		printf("#define CPUID_HINT_TLB_%s_REACH %" PRIu64 "ULL\n", tlb_page_size_name(i), tlb->reach);
+	}
+	printf("\n#endif\n");
+}
+
+void tuning_hints_print(const struct tuning_hints_t *hints, hints_output_t output)
+{
+	if (output == HINTS_OUTPUT_HEADER)
+		print_header(hints);
+	else
+		print_json(hints);
+}
+
+/* vim: set ts=4 sts=4 sw=4 noet: */
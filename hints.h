@@ -0,0 +1,72 @@
+/*
+ * CPUID
+ *
+ * A simple and small tool to dump/decode CPUID information.
+ *
+ * Copyright (c) 2010-2025, Steven Noonan <steven@uplinklabs.net>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef __hints_h
+#define __hints_h
+
+#include "cache.h"
+#include "tlb.h"
+
+struct cpuid_state_t;
+struct topology_t;
+
+typedef enum {
+	HINTS_OUTPUT_JSON = 0,
+	HINTS_OUTPUT_HEADER
+} hints_output_t;
+
+/* Sizing figures for one CPU, all in bytes. Anything the processor doesn't
+ * report is left at zero.
+ */
+struct tuning_hints_t {
+	uint32_t cpu;
+	uint32_t clflush_size;     /* leaf 1 EBX[15:8] * 8 */
+	uint32_t line_size;        /* L1 data cache line size */
+	uint32_t prefetch_size;    /* leaf 2 descriptor 0xF0/0xF1 */
+	uint32_t prefetch_lines;
+
+	uint32_t l1d_size;
+	uint32_t l1d_assoc;
+	uint32_t l2_size;          /* per core, when a cluster of cores shares it */
+	uint32_t l2_assoc;
+	uint32_t l2_cores;         /* cores sharing one L2 */
+
+	uint32_t llc_level;
+	uint32_t llc_size;         /* whole instance */
+	uint32_t llc_threads;      /* logical CPUs sharing it */
+	uint32_t llc_per_thread;
+
+	struct tlb_reach_t tlb[TLB_PAGE_SIZES];
+};
+
+/* Gathers the hints for the first CPU of a probed topology. Caches come
+ * from the topology's leaf 4/0x8000001D data, falling back to the leaf 2
+ * descriptors and AMD's legacy 0x80000005/6 leaves on older parts.
+ */
+int tuning_hints_probe(struct cpuid_state_t *state, const struct topology_t *topo,
+                       struct tuning_hints_t *hints);
+
+/* Prints the hints as a JSON object, or as a C header of #defines. */
+void tuning_hints_print(const struct tuning_hints_t *hints, hints_output_t output);
+
+#endif
+
+/* vim: set ts=4 sts=4 sw=4 noet: */
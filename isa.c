@@ -0,0 +1,427 @@
+/*
+ * CPUID
+ *
+ * A simple and small tool to dump/decode CPUID information.
+ *
+ * Copyright (c) 2010-2025, Steven Noonan <steven@uplinklabs.net>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "prefix.h"
+
+#include "isa.h"
+#include "state.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* The registers the psABI levels are defined over, plus the low half of
+ * XCR0 for the OS-enabled state components.
+ */
+enum {
+	WORD_1_EDX = 0,
+	WORD_1_ECX,
+	WORD_7_EBX,
+	WORD_80000001_ECX,
+	WORD_80000001_EDX,
+	WORD_XCR0,
+	WORD_COUNT
+};
+
+struct level_req_t {
+	x86_64_level_t level;
+	uint8_t word;
+	uint32_t mask;
+	const char *name;
+};
+
+static const struct level_req_t requirements[] = {
+	{ X86_64_V1, WORD_1_EDX,        0x00000001, "FPU" },
+	{ X86_64_V1, WORD_1_EDX,        0x00000100, "CX8" },
+	{ X86_64_V1, WORD_1_EDX,        0x00008000, "CMOV" },
+	{ X86_64_V1, WORD_1_EDX,        0x00800000, "MMX" },
+	{ X86_64_V1, WORD_1_EDX,        0x01000000, "FXSR" },
+	{ X86_64_V1, WORD_1_EDX,        0x02000000, "SSE" },
+	{ X86_64_V1, WORD_1_EDX,        0x04000000, "SSE2" },
+	{ X86_64_V1, WORD_80000001_EDX, 0x00000800, "SYSCALL" },
+	{ X86_64_V1, WORD_80000001_EDX, 0x20000000, "LM" },
+
+	{ X86_64_V2, WORD_1_ECX,        0x00000001, "SSE3" },
+	{ X86_64_V2, WORD_1_ECX,        0x00000200, "SSSE3" },
+	{ X86_64_V2, WORD_1_ECX,        0x00002000, "CMPXCHG16B" },
+	{ X86_64_V2, WORD_1_ECX,        0x00080000, "SSE4_1" },
+	{ X86_64_V2, WORD_1_ECX,        0x00100000, "SSE4_2" },
+	{ X86_64_V2, WORD_1_ECX,        0x00800000, "POPCNT" },
+	{ X86_64_V2, WORD_80000001_ECX, 0x00000001, "LAHF-SAHF" },
+
+	{ X86_64_V3, WORD_1_ECX,        0x00001000, "FMA" },
+	{ X86_64_V3, WORD_1_ECX,        0x00400000, "MOVBE" },
+	{ X86_64_V3, WORD_1_ECX,        0x08000000, "OSXSAVE" },
+	{ X86_64_V3, WORD_1_ECX,        0x10000000, "AVX" },
+	{ X86_64_V3, WORD_1_ECX,        0x20000000, "F16C" },
+	{ X86_64_V3, WORD_7_EBX,        0x00000008, "BMI1" },
+	{ X86_64_V3, WORD_7_EBX,        0x00000020, "AVX2" },
+	{ X86_64_V3, WORD_7_EBX,        0x00000100, "BMI2" },
+	{ X86_64_V3, WORD_80000001_ECX, 0x00000020, "LZCNT" },
+	{ X86_64_V3, WORD_XCR0,         0x00000002, "XCR0.SSE" },
+	{ X86_64_V3, WORD_XCR0,         0x00000004, "XCR0.AVX" },
+
+	{ X86_64_V4, WORD_7_EBX,        0x00010000, "AVX512F" },
+	{ X86_64_V4, WORD_7_EBX,        0x00020000, "AVX512DQ" },
+	{ X86_64_V4, WORD_7_EBX,        0x10000000, "AVX512CD" },
+	{ X86_64_V4, WORD_7_EBX,        0x40000000, "AVX512BW" },
+	{ X86_64_V4, WORD_7_EBX,        0x80000000, "AVX512VL" },
+	{ X86_64_V4, WORD_XCR0,         0x00000020, "XCR0.OPMASK" },
+	{ X86_64_V4, WORD_XCR0,         0x00000040, "XCR0.ZMM_Hi256" },
+	{ X86_64_V4, WORD_XCR0,         0x00000080, "XCR0.Hi16_ZMM" },
+
+	{ X86_64_NONE, 0, 0, NULL }
+};
+
+const char *x86_64_level_name(x86_64_level_t level)
+{
+	static const char *names[] = {
+		"none",
+		"x86-64",
+		"x86-64-v2",
+		"x86-64-v3",
+		"x86-64-v4"
+	};
+	return (uint32_t)level < NELEM(names) ? names[level] : "unknown";
+}
+
+/* Standard format offsets and sizes of the user state components, for dumps
+ * taken before the dump handler recorded every leaf 0xD subleaf.
+ */
+static const struct {
+	uint8_t component;
+	uint16_t offset;
+	uint16_t size;
+} standard_layout[] = {
+	{  2,  576,  256 },
+	{  3,  960,   64 },
+	{  4, 1024,   64 },
+	{  5, 1088,   64 },
+	{  6, 1152,  512 },
+	{  7, 1664, 1024 },
+	{  9, 2688,    8 },
+	{ 17, 2752,   64 },
+	{ 18, 2816, 8192 },
+};
+
+/* Reads the size and offset of a state component, falling back to the
+ * standard layout when the subleaf reads as zero.
+ */
+static void component_layout(struct cpuid_state_t *state, uint32_t i, struct cpu_regs_t *regs)
+{
+	uint32_t j;
+
+	ZERO_REGS(regs);
+	regs->eax = 0xd;
+	regs->ecx = i;
+	state->cpuid_call(regs, state);
+	if (regs->eax || regs->ebx || regs->ecx || regs->edx)
+		return;
+
+	for (j = 0; j < NELEM(standard_layout); j++) {
+		if (standard_layout[j].component == i) {
+			regs->eax = standard_layout[j].size;
+			regs->ebx = standard_layout[j].offset;
+			break;
+		}
+	}
+}
+
+xcr0_source_t isa_read_xcr0(struct cpuid_state_t *state, uint64_t *xcr0)
+{
+	struct cpu_regs_t regs;
+	uint64_t supported;
+	uint32_t maxleaf, enabled_size, i;
+
+	*xcr0 = 0;
+
+	ZERO_REGS(&regs);
+	state->cpuid_call(&regs, state);
+	maxleaf = regs.eax;
+	if (maxleaf < 1)
+		return XCR0_UNAVAILABLE;
+
+	ZERO_REGS(&regs);
+	regs.eax = 1;
+	state->cpuid_call(&regs, state);
+	if (!(regs.ecx & (1U << 27)))
+		return XCR0_UNAVAILABLE;
+
+	if (state->cpuid_call == cpuid_native
+#ifdef __linux__
+	    || state->cpuid_call == cpuid_kernel
+#endif
+	    ) {
+		if (xgetbv_native(0, xcr0))
+			return XCR0_XGETBV;
+	}
+
+	if (maxleaf < 0xd)
+		return XCR0_UNAVAILABLE;
+
+	ZERO_REGS(&regs);
+	regs.eax = 0xd;
+	state->cpuid_call(&regs, state);
+	supported = ((uint64_t)regs.edx << 32) | regs.eax;
+	enabled_size = regs.ebx;
+
+	/* x87 and SSE state live in the legacy area, which is always there. A
+	 * user component counts as enabled if it fits in the size reported for
+	 * the current XCR0. The size only pins down the highest enabled
+	 * component; the standard format keeps every offset fixed, so a
+	 * disabled component below it leaves a hole the size can't show, and
+	 * those are assumed enabled. MPX is the exception: Linux 5.6 and later
+	 * leave its two components off while enabling AVX-512 above them, so
+	 * it's never inferred.
+	 */
+	*xcr0 = supported & 0x3;
+	for (i = 2; i < 63; i++) {
+		if (!(supported & (1ULL << i)) || i == 3 || i == 4)
+			continue;
+		component_layout(state, i, &regs);
+		if (regs.eax && regs.ebx + regs.eax <= enabled_size)
+			*xcr0 |= 1ULL << i;
+	}
+	return XCR0_INFERRED;
+}
+
+static void read_words(struct cpuid_state_t *state, uint32_t *words, uint64_t *xcr0,
+                       xcr0_source_t *source)
+{
+	struct cpu_regs_t regs;
+	uint32_t maxleaf, maxext;
+
+	memset(words, 0, WORD_COUNT * sizeof(uint32_t));
+
+	ZERO_REGS(&regs);
+	state->cpuid_call(&regs, state);
+	maxleaf = regs.eax;
+
+	if (maxleaf >= 1) {
+		ZERO_REGS(&regs);
+		regs.eax = 1;
+		state->cpuid_call(&regs, state);
+		words[WORD_1_EDX] = regs.edx;
+		words[WORD_1_ECX] = regs.ecx;
+	}
+	if (maxleaf >= 7) {
+		ZERO_REGS(&regs);
+		regs.eax = 7;
+		state->cpuid_call(&regs, state);
+		words[WORD_7_EBX] = regs.ebx;
+	}
+
+	ZERO_REGS(&regs);
+	regs.eax = 0x80000000;
+	state->cpuid_call(&regs, state);
+	maxext = (regs.eax & 0xffff0000) == 0x80000000 ? regs.eax : 0;
+	if (maxext >= 0x80000001) {
+		ZERO_REGS(&regs);
+		regs.eax = 0x80000001;
+		state->cpuid_call(&regs, state);
+		words[WORD_80000001_ECX] = regs.ecx;
+		words[WORD_80000001_EDX] = regs.edx;
+	}
+
+	*source = isa_read_xcr0(state, xcr0);
+	words[WORD_XCR0] = (uint32_t)*xcr0;
+}
+
+static x86_64_level_t compute_level(const uint32_t *words)
+{
+	const struct level_req_t *r;
+	x86_64_level_t level = X86_64_V4;
+
+	for (r = requirements; r->name; r++) {
+		if ((words[r->word] & r->mask) != r->mask && r->level <= level)
+			level = (x86_64_level_t)(r->level - 1);
+	}
+	return level;
+}
+
+x86_64_level_t x86_64_level(struct cpuid_state_t *state)
+{
+	uint32_t words[WORD_COUNT];
+	xcr0_source_t source;
+	uint64_t xcr0;
+
+	read_words(state, words, &xcr0, &source);
+	return compute_level(words);
+}
+
+void x86_64_level_detail(struct cpuid_state_t *state, struct x86_64_level_info_t *info)
+{
+	const struct level_req_t *r;
+	uint32_t words[WORD_COUNT];
+
+	memset(info, 0, sizeof(struct x86_64_level_info_t));
+	read_words(state, words, &info->xcr0, &info->xcr0_source);
+	info->level = compute_level(words);
+
+	for (r = requirements; r->name; r++) {
+		if (r->level != info->level + 1)
+			continue;
+		if ((words[r->word] & r->mask) == r->mask)
+			continue;
+		if (info->missing_count < ISA_MAX_MISSING)
+			info->missing[info->missing_count++] = r->name;
+	}
+}
+
+void xsave_probe(struct cpuid_state_t *state, struct xsave_state_t *xs)
+{
+	struct cpu_regs_t regs;
+	uint64_t components;
+	uint32_t i, features;
+
+	memset(xs, 0, sizeof(struct xsave_state_t));
+	xs->xcr0_source = isa_read_xcr0(state, &xs->xcr0);
+
+	ZERO_REGS(&regs);
+	state->cpuid_call(&regs, state);
+	if (regs.eax < 0xd)
+		return;
+
+	ZERO_REGS(&regs);
+	regs.eax = 0xd;
+	state->cpuid_call(&regs, state);
+	xs->supported = ((uint64_t)regs.edx << 32) | regs.eax;
+	xs->enabled_size = regs.ebx;
+	if (!xs->supported)
+		return;
+
+	ZERO_REGS(&regs);
+	regs.eax = 0xd;
+	regs.ecx = 1;
+	state->cpuid_call(&regs, state);
+	features = regs.eax;
+	xs->has_xfd = (features & 0x10) ? 1 : 0;
+	xs->compacted_size = regs.ebx;
+	xs->xss_supported = ((uint64_t)regs.edx << 32) | regs.ecx;
+
+	/* The legacy region and the XSAVE header are always there. */
+	xs->computed_size = 576;
+
+	components = xs->supported | xs->xss_supported;
+	for (i = 2; i < 64; i++) {
+		if (!(components & (1ULL << i)))
+			continue;
+		component_layout(state, i, &regs);
+		xs->sizes[i] = regs.eax;
+		if (regs.ecx & 0x4)
+			xs->xfd_capable |= 1ULL << i;
+
+		/* Supervisor components (ECX bit 0) have no fixed offset. */
+		if ((xs->xcr0 & (1ULL << i)) && !(regs.ecx & 0x1) &&
+		    regs.ebx + regs.eax > xs->computed_size)
+			xs->computed_size = regs.ebx + regs.eax;
+	}
+
+	/* XINUSE is per logical CPU and per moment, so it only means anything
+	 * when read live.
+	 */
+	if ((features & 0x4) && xs->xcr0_source == XCR0_XGETBV)
+		xs->has_xinuse = xgetbv_native(1, &xs->xinuse) ? 1 : 0;
+}
+
+enum {
+	R_EAX = 0,
+	R_EBX,
+	R_ECX,
+	R_EDX
+};
+
+struct isa_group_t {
+	const char *name;
+	uint32_t leaf;
+	uint32_t subleaf;
+	uint8_t reg;
+	uint32_t mask;
+	uint64_t xcr0;
+};
+
+static const struct isa_group_t isa_groups[] = {
+	{ "AVX",          0x1, 0, R_ECX, 0x10000000, 0x6 },
+	{ "FMA",          0x1, 0, R_ECX, 0x00001000, 0x6 },
+	{ "AVX2",         0x7, 0, R_EBX, 0x00000020, 0x6 },
+	{ "AVX-VNNI",     0x7, 1, R_EAX, 0x00000010, 0x6 },
+	{ "AVX-512",      0x7, 0, R_EBX, 0x00010000, 0xe6 },
+	{ "AVX512-FP16",  0x7, 0, R_EDX, 0x00800000, 0xe6 },
+	{ "AVX10",        0x7, 1, R_EDX, 0x00080000, 0xe6 },
+	{ "AMX",          0x7, 0, R_EDX, 0x01000000, 0x60000 },
+	{ "MPX",          0x7, 0, R_EBX, 0x00004000, 0x18 },
+	{ "PKU",          0x7, 0, R_ECX, 0x00000008, 0x200 },
+	{ "APX",          0x7, 1, R_EDX, 0x00200000, 0x80000 },
+	{ NULL, 0, 0, 0, 0, 0 }
+};
+
+const char *isa_status_name(isa_status_t status)
+{
+	switch (status) {
+	case ISA_USABLE:           return "usable";
+	case ISA_OS_DISABLED:      return "disabled by the OS";
+	case ISA_NEEDS_PERMISSION: return "usable once requested (XFD)";
+	default:                   return "not supported";
+	}
+}
+
+uint32_t isa_usable(struct cpuid_state_t *state, const struct xsave_state_t *xs,
+                    struct isa_usable_t *out, uint32_t max)
+{
+	const struct isa_group_t *g;
+	struct cpu_regs_t regs;
+	uint32_t i, maxleaf, count = 0;
+
+	ZERO_REGS(&regs);
+	state->cpuid_call(&regs, state);
+	maxleaf = regs.eax;
+
+	for (g = isa_groups; g->name && count < max; g++) {
+		struct isa_usable_t *u = &out[count];
+
+		if (g->leaf > maxleaf)
+			continue;
+		ZERO_REGS(&regs);
+		regs.eax = g->leaf;
+		regs.ecx = g->subleaf;
+		state->cpuid_call(&regs, state);
+		if (!(regs.regs[g->reg] & g->mask))
+			continue;
+
+		u->name = g->name;
+		u->save_bytes = 0;
+		for (i = 2; i < 64; i++) {
+			if (g->xcr0 & (1ULL << i))
+				u->save_bytes += xs->sizes[i];
+		}
+
+		if ((xs->xcr0 & g->xcr0) != g->xcr0)
+			u->status = ISA_OS_DISABLED;
+		else if (xs->has_xfd && (xs->xfd_capable & g->xcr0))
+			u->status = ISA_NEEDS_PERMISSION;
+		else
+			u->status = ISA_USABLE;
+		count++;
+	}
+	return count;
+}
+
+/* vim: set ts=4 sts=4 sw=4 noet: */
@@ -0,0 +1,112 @@
+/*
+ * CPUID
+ *
+ * A simple and small tool to dump/decode CPUID information.
+ *
+ * Copyright (c) 2010-2025, Steven Noonan <steven@uplinklabs.net>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef __isa_h
+#define __isa_h
+
+struct cpuid_state_t;
+
+/* x86-64 psABI microarchitecture levels. */
+typedef enum {
+	X86_64_NONE = 0,   /* not a 64-bit processor, or missing baseline bits */
+	X86_64_V1,
+	X86_64_V2,
+	X86_64_V3,
+	X86_64_V4
+} x86_64_level_t;
+
+typedef enum {
+	XCR0_UNAVAILABLE = 0,  /* OSXSAVE clear: the OS manages no XSAVE state */
+	XCR0_XGETBV,           /* read from the running CPU */
+	XCR0_INFERRED          /* reconstructed from leaf 0xD sizes in a dump */
+} xcr0_source_t;
+
+#define ISA_MAX_MISSING 16
+
+struct x86_64_level_info_t {
+	x86_64_level_t level;
+	uint64_t xcr0;
+	xcr0_source_t xcr0_source;
+
+	/* Requirements of the next level up that the processor or OS lacks. */
+	uint32_t missing_count;
+	const char *missing[ISA_MAX_MISSING];
+};
+
+/* Returns the XCR0 value in effect. XGETBV only works with the native
+ * cpuid_call backend; otherwise the value is inferred from leaf 0xD, whose
+ * subleaf 0 EBX gives the save area size for the enabled components.
+ */
+xcr0_source_t isa_read_xcr0(struct cpuid_state_t *state, uint64_t *xcr0);
+
+/* The highest psABI level the processor and OS support together. This is
+ * the fast path: four CPUID leaves and XCR0, then a handful of mask tests.
+ */
+x86_64_level_t x86_64_level(struct cpuid_state_t *state);
+
+/* As x86_64_level(), also naming what stands in the way of the next level. */
+void x86_64_level_detail(struct cpuid_state_t *state, struct x86_64_level_info_t *info);
+
+const char *x86_64_level_name(x86_64_level_t level);
+
+/* Leaf 0xD as seen against the OS's XCR0. */
+struct xsave_state_t {
+	uint64_t supported;       /* XCR0 bits the processor supports (subleaf 0) */
+	uint64_t xss_supported;   /* IA32_XSS bits it supports (subleaf 1) */
+	uint64_t xcr0;
+	xcr0_source_t xcr0_source;
+	uint64_t xinuse;          /* XGETBV(1): components not in their init state */
+	uint64_t xfd_capable;     /* components extended feature disable can arm */
+	unsigned has_xinuse:1;    /* set if xinuse was read */
+	unsigned has_xfd:1;
+	uint32_t enabled_size;    /* standard format size for XCR0 (subleaf 0 EBX) */
+	uint32_t compacted_size;  /* compacted size for XCR0 | IA32_XSS (subleaf 1 EBX) */
+	uint32_t computed_size;   /* enabled_size recomputed from the component subleaves */
+	uint32_t sizes[64];       /* per component, from subleaves 2..63 */
+};
+
+/* Reads leaf 0xD, XCR0 and (if supported and running natively) XINUSE. */
+void xsave_probe(struct cpuid_state_t *state, struct xsave_state_t *xs);
+
+typedef enum {
+	ISA_UNSUPPORTED = 0,
+	ISA_USABLE,
+	ISA_OS_DISABLED,      /* the CPU has it but XCR0 leaves its state off */
+	ISA_NEEDS_PERMISSION  /* state enabled, but armed with XFD until requested */
+} isa_status_t;
+
+struct isa_usable_t {
+	const char *name;
+	isa_status_t status;
+	uint32_t save_bytes;  /* extra XSAVE state this extension brings */
+};
+
+/* Classifies the register-state-bearing ISA extensions (AVX, AVX-512, AMX,
+ * APX, ...) by whether the OS lets them run. Returns the number written.
+ */
+uint32_t isa_usable(struct cpuid_state_t *state, const struct xsave_state_t *xs,
+                    struct isa_usable_t *out, uint32_t max);
+
+const char *isa_status_name(isa_status_t status);
+
+#endif
+
+/* vim: set ts=4 sts=4 sw=4 noet: */
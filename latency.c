@@ -0,0 +1,657 @@
+/*
+ * CPUID
+ *
+ * A simple and small tool to dump/decode CPUID information.
+ *
+ * Copyright (c) 2010-2025, Steven Noonan <steven@uplinklabs.net>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "prefix.h"
+
+#include "clock.h"
+#include "cpuid.h"
+#include "latency.h"
+#include "state.h"
+#include "threads.h"
+#include "topology.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(TARGET_CPU_X86) || defined(TARGET_CPU_X86_64)
+#ifdef _MSC_VER
+#define cpu_relax() _mm_pause()
+#else
+#define cpu_relax() __asm__ __volatile__("pause" : : : "memory")
+#endif
+#else
+#define cpu_relax() do { } while (0)
+#endif
+
+#ifdef _MSC_VER
+#define atomic_inc(p) InterlockedIncrement((volatile LONG *)(p))
+#else
+#define atomic_inc(p) __sync_fetch_and_add((p), 1)
+#endif
+
+#define CACHE_LINE 64
+
+/* The line bounced between the two CPUs of a pair. Kept alone in its own
+ * cache line so nothing else adds coherence traffic.
+ */
+struct pingpong_line_t {
+	volatile uint32_t seq;
+	volatile uint32_t ready;
+	volatile uint32_t abort;
+	volatile uint32_t pad;
+	volatile uint64_t tsc;
+};
+
+struct pingpong_t {
+	struct cpuid_state_t state;
+	struct pingpong_line_t *line;
+	uint32_t cpu;
+	uint32_t rounds;
+	int failed;
+
+	/* Filled in by the initiating side. */
+	uint64_t *samples;
+	uint64_t rtt;
+	int64_t offset;
+};
+
+/* Result of ping-ponging between one pair of CPUs, in TSC cycles. */
+struct pair_result_t {
+	uint64_t min_rtt;
+	uint64_t median_rtt;
+	int64_t offset;       /* second CPU's TSC minus the first's */
+};
+
+static int pingpong_bind(struct pingpong_t *p)
+{
+	if (p->state.thread_bind(&p->state, p->cpu) != 0) {
+		p->failed = 1;
+		p->line->abort = 1;
+		return 1;
+	}
+
+	/* Wait for the other side, so neither starts timing while the
+	 * other is still migrating.
+	 */
+	atomic_inc(&p->line->ready);
+	while (p->line->ready < 2) {
+		if (p->line->abort)
+			return 1;
+		cpu_relax();
+	}
+	return 0;
+}
+
+/* Sends a request and times the reply. The responder's TSC is read
+ * somewhere inside the round trip; assuming the two legs take equally long,
+ * it was read at the midpoint, which gives the offset between the clocks.
+ * The round with the shortest trip bounds that error most tightly.
+ */
+static void *pingpong_initiator(void *ptr)
+{
+	struct pingpong_t *p = (struct pingpong_t *)ptr;
+	struct pingpong_line_t *line = p->line;
+	uint32_t k;
+
+	p->rtt = UINT64_MAX;
+	if (pingpong_bind(p) != 0)
+		return NULL;
+
+	for (k = 0; k < p->rounds; k++) {
+		uint64_t t0, t1, tb;
+		t0 = get_cpu_clock_start();
+		line->seq = 2 * k + 1;
+		while (line->seq != 2 * k + 2)
+			cpu_relax();
+		t1 = get_cpu_clock_start();
+		tb = line->tsc;
+		p->samples[k] = t1 - t0;
+		if (t1 - t0 < p->rtt) {
+			p->rtt = t1 - t0;
+			p->offset = (int64_t)(tb - (t0 + (t1 - t0) / 2));
+		}
+	}
+
+	return NULL;
+}
+
+static void *pingpong_responder(void *ptr)
+{
+	struct pingpong_t *p = (struct pingpong_t *)ptr;
+	struct pingpong_line_t *line = p->line;
+	uint32_t k;
+
+	if (pingpong_bind(p) != 0)
+		return NULL;
+
+	for (k = 0; k < p->rounds; k++) {
+		while (line->seq != 2 * k + 1)
+			cpu_relax();
+		line->tsc = get_cpu_clock_start();
+		line->seq = 2 * k + 2;
+	}
+
+	return NULL;
+}
+
+static int u64_compare(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+	return (x > y) - (x < y);
+}
+
+/* Runs one ping-pong between CPUs a (initiator) and b (responder). */
+static int pingpong_pair(struct cpuid_state_t *state, struct pingpong_line_t *line,
+                         uint64_t *samples, uint32_t a, uint32_t b, uint32_t rounds,
+                         struct pair_result_t *result)
+{
+	struct pingpong_t side[2];
+	struct thread_t *threads[2];
+	uint32_t i;
+
+	memset(line, 0, sizeof(struct pingpong_line_t));
+	memset(side, 0, sizeof(side));
+	for (i = 0; i < 2; i++) {
+		INIT_CPUID_STATE(&side[i].state);
+		side[i].state.cpuid_call = state->cpuid_call;
+		side[i].state.thread_bind = state->thread_bind;
+		side[i].line = line;
+		side[i].cpu = i ? b : a;
+		side[i].rounds = rounds;
+	}
+	side[0].samples = samples;
+
+	threads[1] = thread_spawn(pingpong_responder, &side[1]);
+	if (!threads[1])
+		line->abort = 1;
+	threads[0] = thread_spawn(pingpong_initiator, &side[0]);
+	if (!threads[0])
+		line->abort = 1;
+	thread_join(threads[0]);
+	thread_join(threads[1]);
+
+	qsort(samples, rounds, sizeof(uint64_t), u64_compare);
+	result->min_rtt = side[0].rtt;
+	result->median_rtt = samples[rounds / 2];
+	result->offset = side[0].offset;
+
+	for (i = 0; i < 2; i++)
+		FREE_CPUID_STATE(&side[i].state);
+
+	return (line->abort || side[0].failed || side[1].failed) ? 1 : 0;
+}
+
+static BOOL has_invariant_tsc(struct cpuid_state_t *state)
+{
+	struct cpu_regs_t regs;
+
+	ZERO_REGS(&regs);
+	regs.eax = 0x80000000;
+	state->cpuid_call(&regs, state);
+	if (regs.eax < 0x80000007)
+		return FALSE;
+
+	ZERO_REGS(&regs);
+	regs.eax = 0x80000007;
+	state->cpuid_call(&regs, state);
+	return (regs.edx & (1 << 8)) ? TRUE : FALSE;
+}
+
+/* Ping-pongs every pair of CPUs in turn, filling the n x n matrix. Entry
+ * [a * n + b] is the result as seen from a; the mirror entry has the offset
+ * negated.
+ */
+static int measure_pairs(struct cpuid_state_t *state, uint32_t n, uint32_t rounds,
+                         struct pair_result_t *results)
+{
+	struct pingpong_line_t *line;
+	void *line_mem;
+	uint64_t *samples;
+	uint32_t a, b;
+	int ret = 0;
+
+	line_mem = malloc(sizeof(struct pingpong_line_t) + CACHE_LINE);
+	samples = (uint64_t *)malloc(rounds * sizeof(uint64_t));
+	assert(line_mem && samples);
+	line = (struct pingpong_line_t *)(((uintptr_t)line_mem + CACHE_LINE - 1) & ~(uintptr_t)(CACHE_LINE - 1));
+
+	memset(results, 0, n * n * sizeof(struct pair_result_t));
+	for (a = 0; a < n && !ret; a++) {
+		for (b = a + 1; b < n; b++) {
+			struct pair_result_t *r = &results[a * n + b];
+			if (pingpong_pair(state, line, samples, a, b, rounds, r) != 0) {
+				printf("Unable to run CPUs %u and %u concurrently.\n", a, b);
+				ret = 1;
+				break;
+			}
+			results[b * n + a] = *r;
+			results[b * n + a].offset = -r->offset;
+		}
+	}
+
+	free(samples);
+	free(line_mem);
+	return ret;
+}
+
+typedef enum {
+	PAIR_SMT = 0,
+	PAIR_PACKAGE,
+	PAIR_CROSS_PACKAGE,
+	PAIR_KINDS
+} pair_kind_t;
+
+static const char *pair_kind_names[PAIR_KINDS] = {
+	"SMT siblings",
+	"same package",
+	"cross package"
+};
+
+static const char *pair_kind_keys[PAIR_KINDS] = {
+	"smt",
+	"package",
+	"cross_package"
+};
+
+struct pair_group_t {
+	uint32_t pairs;
+	uint64_t max_offset;
+	uint64_t median_rtt;
+	uint64_t *rtts;
+};
+
+static pair_kind_t classify_pair(const struct topology_t *topo, uint32_t a, uint32_t b)
+{
+	const struct topology_cpu_t *x = &topo->cpus[a], *y = &topo->cpus[b];
+	if (x->package != y->package)
+		return PAIR_CROSS_PACKAGE;
+	if (x->core == y->core)
+		return PAIR_SMT;
+	return PAIR_PACKAGE;
+}
+
+static uint64_t abs64(int64_t v)
+{
+	return (uint64_t)(v < 0 ? -v : v);
+}
+
+static void print_text_cpus(const struct topology_t *topo)
+{
+	uint32_t i, j;
+	for (i = 0; i < topo->count; i++) {
+		const struct topology_cpu_t *cpu = &topo->cpus[i];
+		printf("  CPU %3u: x2APIC ID %u (package %u, core %u, thread %u)",
+		       i, cpu->apic_id, cpu->package, cpu->core, cpu->thread);
+		for (j = 0; j < cpu->cache_count; j++) {
+			const struct topology_cache_t *cache = &cpu->caches[j];
+			if (cache->desc.level < L2 || cache->desc.type == CODE)
+				continue;
+			printf(" L%d#%u", cache->desc.level, cache->id);
+		}
+		printf("\n");
+	}
+}
+
+static void print_json_cpus(const struct topology_t *topo)
+{
+	uint32_t i, j, k;
+	printf("  \"cpus\": [");
+	for (i = 0; i < topo->count; i++) {
+		const struct topology_cpu_t *cpu = &topo->cpus[i];
+		printf("%s\n    { \"cpu\": %u, \"apic_id\": %u, \"package\": %u, \"core\": %u, \"thread\": %u, \"caches\": {",
+		       i ? "," : "", i, cpu->apic_id, cpu->package, cpu->core, cpu->thread);
+		for (j = 0, k = 0; j < cpu->cache_count; j++) {
+			const struct topology_cache_t *cache = &cpu->caches[j];
+			if (cache->desc.level < L2 || cache->desc.type == CODE)
+				continue;
+			printf("%s \"l%d\": %u", k++ ? "," : "", cache->desc.level, cache->id);
+		}
+		printf(" } }");
+	}
+	printf("\n  ]");
+}
+
+static void print_matrix_header(uint32_t n)
+{
+	uint32_t b;
+	printf("       ");
+	for (b = 0; b < n; b++)
+		printf(" %7u", b);
+	printf("\n");
+}
+
+int tsc_skew_run(struct cpuid_state_t *state, const struct latency_options_t *opts)
+{
+	struct topology_t topo;
+	struct pair_group_t groups[PAIR_KINDS];
+	struct pair_result_t *results, *worst;
+	uint32_t n, a, b, k, worst_a, worst_b;
+	BOOL invariant;
+	int ret = 0;
+
+	if (topology_probe(state, &topo) != 0) {
+		printf("Unable to determine processor topology.\n");
+		return 1;
+	}
+	n = topo.count;
+	if (n < 2) {
+		printf("TSC skew measurement needs at least two logical CPUs.\n");
+		topology_free(&topo);
+		return 1;
+	}
+	state->thread_bind(state, 0);
+	invariant = has_invariant_tsc(state);
+
+	results = (struct pair_result_t *)calloc(n * n, sizeof(struct pair_result_t));
+	memset(groups, 0, sizeof(groups));
+	for (k = 0; k < PAIR_KINDS; k++)
+		groups[k].rtts = (uint64_t *)calloc(n * n, sizeof(uint64_t));
+	assert(results);
+
+	if (measure_pairs(state, n, opts->rounds, results) != 0) {
+		ret = 1;
+		goto out;
+	}
+
+	worst = &results[1];
+	for (a = 0; a < n; a++) {
+		for (b = a + 1; b < n; b++) {
+			struct pair_result_t *r = &results[a * n + b];
+			pair_kind_t kind = classify_pair(&topo, a, b);
+
+			if (abs64(r->offset) > abs64(worst->offset))
+				worst = r;
+
+			groups[kind].rtts[groups[kind].pairs++] = r->min_rtt;
+			if (abs64(r->offset) > groups[kind].max_offset)
+				groups[kind].max_offset = abs64(r->offset);
+		}
+	}
+	worst_a = (uint32_t)(worst - results) / n;
+	worst_b = (uint32_t)(worst - results) % n;
+
+	for (k = 0; k < PAIR_KINDS; k++) {
+		if (!groups[k].pairs)
+			continue;
+		qsort(groups[k].rtts, groups[k].pairs, sizeof(uint64_t), u64_compare);
+		groups[k].median_rtt = groups[k].rtts[groups[k].pairs / 2];
+	}
+
+	if (opts->output == LATENCY_OUTPUT_JSON) {
+		uint32_t i, j;
+		printf("{\n  \"unit\": \"cycles\",\n  \"rounds\": %u,\n", opts->rounds);
+		printf("  \"invariant_tsc\": %s,\n", invariant ? "true" : "false");
+		print_json_cpus(&topo);
+		printf(",\n  \"offset\": [");
+		for (i = 0; i < n; i++) {
+			printf("%s\n    [", i ? "," : "");
+			for (j = 0; j < n; j++)
+				printf("%s%" PRId64, j ? ", " : "", results[i * n + j].offset);
+			printf("]");
+		}
+		printf("\n  ],\n  \"rtt\": [");
+		for (i = 0; i < n; i++) {
+			printf("%s\n    [", i ? "," : "");
+			for (j = 0; j < n; j++)
+				printf("%s%" PRIu64, j ? ", " : "", results[i * n + j].min_rtt);
+			printf("]");
+		}
+		printf("\n  ],\n  \"worst\": { \"a\": %u, \"b\": %u, \"offset\": %" PRId64 ", \"rtt\": %" PRIu64 " },\n",
+		       worst_a, worst_b, worst->offset, worst->min_rtt);
+		printf("  \"groups\": {");
+		for (k = 0; k < PAIR_KINDS; k++)
+			printf("%s\n    \"%s\": { \"pairs\": %u, \"max_offset\": %" PRIu64 ", \"median_rtt\": %" PRIu64 " }",
+			       k ? "," : "", pair_kind_keys[k], groups[k].pairs,
+			       groups[k].max_offset, groups[k].median_rtt);
+		printf("\n  }\n}\n");
+		goto out;
+	}
+
+	printf("TSC skew between logical CPUs (%u rounds per pair)\n", opts->rounds);
+	printf("  Invariant TSC: %s\n\n", invariant ? "yes" : "no (offsets may drift with power state changes)");
+	print_text_cpus(&topo);
+
+	printf("\n  TSC offset of column CPU relative to row CPU (cycles):\n");
+	print_matrix_header(n);
+	for (a = 0; a < n; a++) {
+		printf("  %4u ", a);
+		for (b = 0; b < n; b++)
+			printf(" %7" PRId64, results[a * n + b].offset);
+		printf("\n");
+	}
+
+	printf("\n  Round-trip time (cycles):\n");
+	print_matrix_header(n);
+	for (a = 0; a < n; a++) {
+		printf("  %4u ", a);
+		for (b = 0; b < n; b++)
+			printf(" %7" PRIu64, results[a * n + b].min_rtt);
+		printf("\n");
+	}
+
+	printf("\n  Worst pair: CPU %u and CPU %u, offset %" PRId64 " cycles (+/- %" PRIu64 ")\n\n",
+	       worst_a, worst_b, worst->offset, worst->min_rtt / 2);
+
+	printf("  By topology:\n");
+	for (k = 0; k < PAIR_KINDS; k++) {
+		if (!groups[k].pairs)
+			continue;
+		printf("    %-14s %5u pairs, max |offset| %7" PRIu64 ", median RTT %7" PRIu64 "\n",
+		       pair_kind_names[k], groups[k].pairs, groups[k].max_offset, groups[k].median_rtt);
+	}
+	printf("\n");
+
+out:
+	for (k = 0; k < PAIR_KINDS; k++)
+		free(groups[k].rtts);
+	free(results);
+	topology_free(&topo);
+	return ret;
+}
+
+/* Groups CPUs whose caches at 'level' are the same instance, in CPU order of
+ * first appearance. cluster[i] receives the group index of CPU i.
+ */
+static uint32_t cache_clusters(const struct topology_t *topo, cache_level_t level, uint32_t *cluster)
+{
+	uint32_t i, j, count = 0;
+	for (i = 0; i < topo->count; i++) {
+		cluster[i] = UINT32_MAX;
+		for (j = 0; j < i; j++) {
+			if (topology_shares_cache(topo, i, j, level)) {
+				cluster[i] = cluster[j];
+				break;
+			}
+		}
+		if (cluster[i] == UINT32_MAX)
+			cluster[i] = count++;
+	}
+	return count;
+}
+
+/* Single-linkage clustering: CPUs end up together when some chain of pairs
+ * between them is each faster than the threshold. With a threshold between
+ * the intra-CCX/tile and inter-CCX/tile latencies this recovers those
+ * boundaries from measurements alone.
+ */
+static uint32_t latency_clusters(const struct pair_result_t *results, uint32_t n,
+                                 uint64_t threshold, uint32_t *cluster)
+{
+	uint32_t i, j, k, count = 0;
+	for (i = 0; i < n; i++)
+		cluster[i] = UINT32_MAX;
+	for (i = 0; i < n; i++) {
+		if (cluster[i] != UINT32_MAX)
+			continue;
+		cluster[i] = count;
+		/* Flood out from CPU i; each pass adds CPUs near any member. */
+		for (k = 0; k < n; k++) {
+			BOOL grew = FALSE;
+			for (j = 0; j < n; j++) {
+				uint32_t m;
+				if (cluster[j] != UINT32_MAX)
+					continue;
+				for (m = 0; m < n; m++) {
+					if (cluster[m] == count && results[m * n + j].median_rtt / 2 <= threshold) {
+						cluster[j] = count;
+						grew = TRUE;
+						break;
+					}
+				}
+			}
+			if (!grew)
+				break;
+		}
+		count++;
+	}
+	return count;
+}
+
+static void print_clusters(const char *title, const uint32_t *cluster, uint32_t count, uint32_t n)
+{
+	uint32_t *members = (uint32_t *)malloc(n * sizeof(uint32_t));
+	char buffer[1024];
+	uint32_t c, i, m;
+
+	printf("  %s:", title);
+	for (c = 0; c < count; c++) {
+		for (i = 0, m = 0; i < n; i++)
+			if (cluster[i] == c)
+				members[m++] = i;
+		printf(" {%s}", topology_format_cpus(members, m, buffer, sizeof(buffer)));
+	}
+	printf("\n");
+	free(members);
+}
+
+static void print_json_clusters(const char *key, const uint32_t *cluster, uint32_t count, uint32_t n)
+{
+	uint32_t c, i, m;
+	printf("    \"%s\": [", key);
+	for (c = 0; c < count; c++) {
+		printf("%s[", c ? ", " : "");
+		for (i = 0, m = 0; i < n; i++)
+			if (cluster[i] == c)
+				printf("%s%u", m++ ? ", " : "", i);
+		printf("]");
+	}
+	printf("]");
+}
+
+int c2c_run(struct cpuid_state_t *state, const struct latency_options_t *opts)
+{
+	struct topology_t topo;
+	struct pair_result_t *results;
+	uint32_t *l2_cluster, *l3_cluster, *lat_cluster;
+	uint32_t n, a, b, l2_count, l3_count, lat_count;
+	uint64_t fastest = UINT64_MAX, threshold;
+	int ret = 0;
+
+	if (topology_probe(state, &topo) != 0) {
+		printf("Unable to determine processor topology.\n");
+		return 1;
+	}
+	n = topo.count;
+	if (n < 2) {
+		printf("Core-to-core latency measurement needs at least two logical CPUs.\n");
+		topology_free(&topo);
+		return 1;
+	}
+	init_cpu_clock(state);
+
+	results = (struct pair_result_t *)calloc(n * n, sizeof(struct pair_result_t));
+	l2_cluster = (uint32_t *)calloc(n, sizeof(uint32_t));
+	l3_cluster = (uint32_t *)calloc(n, sizeof(uint32_t));
+	lat_cluster = (uint32_t *)calloc(n, sizeof(uint32_t));
+	assert(results && l2_cluster && l3_cluster && lat_cluster);
+
+	if (measure_pairs(state, n, opts->rounds, results) != 0) {
+		ret = 1;
+		goto out;
+	}
+
+	/* Cut between the fastest non-SMT pair and anything far slower. */
+	for (a = 0; a < n; a++)
+		for (b = a + 1; b < n; b++)
+			if (classify_pair(&topo, a, b) != PAIR_SMT && results[a * n + b].median_rtt < fastest)
+				fastest = results[a * n + b].median_rtt;
+	if (fastest == UINT64_MAX)
+		fastest = results[1].median_rtt;
+	threshold = fastest / 2 + fastest / 4;
+
+	l2_count = cache_clusters(&topo, L2, l2_cluster);
+	l3_count = cache_clusters(&topo, L3, l3_cluster);
+	lat_count = latency_clusters(results, n, threshold, lat_cluster);
+
+	if (opts->output == LATENCY_OUTPUT_JSON) {
+		uint32_t i, j;
+		printf("{\n  \"unit\": \"ns\",\n  \"rounds\": %u,\n", opts->rounds);
+		print_json_cpus(&topo);
+		printf(",\n  \"latency\": [");
+		for (i = 0; i < n; i++) {
+			printf("%s\n    [", i ? "," : "");
+			for (j = 0; j < n; j++)
+				printf("%s%" PRIu64, j ? ", " : "", cpu_clock_to_wall(results[i * n + j].median_rtt / 2));
+			printf("]");
+		}
+		printf("\n  ],\n  \"clusters\": {\n");
+		print_json_clusters("l2", l2_cluster, l2_count, n);
+		printf(",\n");
+		print_json_clusters("l3", l3_cluster, l3_count, n);
+		printf(",\n");
+		print_json_clusters("latency", lat_cluster, lat_count, n);
+		printf("\n  }\n}\n");
+		goto out;
+	}
+
+	printf("Core-to-core cache line latency (%u rounds per pair)\n\n", opts->rounds);
+	print_text_cpus(&topo);
+
+	printf("\n  One-way latency, median (ns):\n");
+	print_matrix_header(n);
+	for (a = 0; a < n; a++) {
+		printf("  %4u ", a);
+		for (b = 0; b < n; b++) {
+			if (a == b)
+				printf(" %7s", "-");
+			else
+				printf(" %7" PRIu64, cpu_clock_to_wall(results[a * n + b].median_rtt / 2));
+		}
+		printf("\n");
+	}
+	printf("\n");
+
+	print_clusters("L2 sharing groups", l2_cluster, l2_count, n);
+	print_clusters("L3 sharing groups", l3_cluster, l3_count, n);
+	print_clusters("Latency clusters", lat_cluster, lat_count, n);
+	printf("\n");
+
+out:
+	free(lat_cluster);
+	free(l3_cluster);
+	free(l2_cluster);
+	free(results);
+	topology_free(&topo);
+	return ret;
+}
+
+/* vim: set ts=4 sts=4 sw=4 noet: */
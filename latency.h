@@ -0,0 +1,51 @@
+/*
+ * CPUID
+ *
+ * A simple and small tool to dump/decode CPUID information.
+ *
+ * Copyright (c) 2010-2025, Steven Noonan <steven@uplinklabs.net>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef __latency_h
+#define __latency_h
+
+struct cpuid_state_t;
+
+typedef enum {
+	LATENCY_OUTPUT_TEXT = 0,
+	LATENCY_OUTPUT_JSON
+} latency_output_t;
+
+struct latency_options_t {
+	latency_output_t output;
+	uint32_t rounds;
+};
+
+/* Measures the TSC offset and round-trip time between every pair of logical
+ * CPUs by bouncing a cache line between two pinned threads, and reports the
+ * worst pair along with a per-topology-level summary.
+ */
+int tsc_skew_run(struct cpuid_state_t *state, const struct latency_options_t *opts);
+
+/* Measures the one-way cache line transfer latency between every pair of
+ * logical CPUs, annotated with topology and cache sharing, and groups the
+ * CPUs into clusters (CCX, tile) both by shared cache and by latency.
+ */
+int c2c_run(struct cpuid_state_t *state, const struct latency_options_t *opts);
+
+#endif
+
+/* vim: set ts=4 sts=4 sw=4 noet: */
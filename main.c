@@ -21,10 +21,22 @@
 
 #include "prefix.h"
 
+#include "amx.h"
+#include "bench.h"
 #include "cpuid.h"
 #include "handlers.h"
+#include "hints.h"
+#include "isa.h"
+#include "latency.h"
+#include "pinplan.h"
+#include "pmu.h"
+#include "pt.h"
+#include "rdt.h"
 #include "sanity.h"
 #include "state.h"
+#include "target.h"
+#include "tlb.h"
+#include "topology.h"
 #include "version.h"
 
 #include <stdio.h>
@@ -148,10 +160,34 @@ static void usage(const char *argv0)
 	printf("  %-18s %s\n", "-c, --cpu", "Index (starting at 0) of CPU to get info from");
 	printf("  %-18s %s\n", "-d, --dump", "Dump a raw CPUID table");
 	printf("  %-18s %s\n", "--ignore-vendor", "Show feature flags from all vendors");
+	printf("  %-18s %s\n", "--topology[=fmt]", "Print the processor topology tree (fmt: text, json)");
+	printf("  %-18s %s\n", "--cache-map[=fmt]", "List the CPUs sharing each cache (fmt: text, json, cpuset)");
+	printf("  %-18s %s\n", "--core-types[=fmt]", "List the CPUs of each hybrid core type (fmt: text, json, cpuset)");
+	printf("  %-18s %s\n", "--pin-plan", "Print an ordered list of CPUs to pin N workers to");
+	printf("  %-18s %s\n", "--pin-policy", "Pinning policy (spread, pack, core, nosmt, pcore)");
+	printf("  %-18s %s\n", "--tuning-hints", "Print data structure sizing hints (=json or =header)");
+	printf("  %-18s %s\n", "--target-header", "Print a C/C++ header describing the CPU for compile-time use");
+	printf("  %-18s %s\n", "--target-flags", "Print the GCC/Clang flags targeting the CPU's features");
+	printf("  %-18s %s\n", "--isa-level", "Print the x86-64 psABI level (x86-64-v2, -v3, ...) usable here");
+	printf("  %-18s %s\n", "--rdt-plan", "Split the L3 cache between tenants by weight (e.g. 50,25,25)");
+	printf("  %-18s %s\n", "--qos-caps", "Print RDT/PQoS capabilities per L3 domain as JSON");
+	printf("  %-18s %s\n", "--mbm-wrap", "MBM counter wrap time at a peak bandwidth in GB/s, as JSON");
+	printf("  %-18s %s\n", "--amx-config", "Print AMX tile shapes and GEMM blocking as JSON");
+	printf("  %-18s %s\n", "--pmu-budget[=fmt]", "List the performance counters of each CPU (fmt: text, json)");
+	printf("  %-18s %s\n", "--ibs-caps", "Print AMD IBS capabilities and a sampling setup as JSON");
+	printf("  %-18s %s\n", "--pt-caps", "Print Intel PT capabilities and a tracing setup as JSON");
+	printf("  %-18s %s\n", "--tlb-reach", "Print each CPU's TLBs and their reach per page size as JSON");
 	printf("  %-18s %s\n", "--vendor", "Override the processor vendor string");
 	printf("  %-18s %s\n", "-f, --parse", "Read and decode a raw cpuid table from the file specified");
 #ifdef CPUID_AVAILABLE
 	printf("  %-18s %s\n", "--sanity", "Do a sanity check of the CPUID data");
+	printf("  %-18s %s\n", "--bench[=fmt]", "Measure CPUID latency per leaf (fmt: text, csv, json)");
+	printf("  %-18s %s\n", "--bench-parallel", "Run the benchmark on all selected CPUs at once");
+	printf("  %-18s %s\n", "--bench-samples", "Number of samples per leaf (default: 1000)");
+	printf("  %-18s %s\n", "--timer", "Benchmark timer (rdtsc, rdtscp, clock, perf)");
+	printf("  %-18s %s\n", "--tsc-skew[=fmt]", "Measure TSC offsets between CPUs (fmt: text, json)");
+	printf("  %-18s %s\n", "--c2c[=fmt]", "Measure core-to-core cache line latency (fmt: text, json)");
+	printf("  %-18s %s\n", "--latency-rounds", "Ping-pong rounds per CPU pair (default: 1000)");
 #endif
 	printf("\n");
 	exit(0);
@@ -186,6 +222,25 @@ struct {
 };
 
 static int do_sanity = 0;
+static int do_bench = 0;
+static int do_tsc_skew = 0;
+static int do_c2c = 0;
+static int do_topology = 0;
+static int do_cache_map = 0;
+static int do_core_types = 0;
+static uint32_t pin_workers = 0;
+static int do_tuning_hints = 0;
+static int do_target_header = 0;
+static int do_target_flags = 0;
+static int do_isa_level = 0;
+static const char *rdt_shares = NULL;
+static int do_qos_caps = 0;
+static double mbm_peak_gbps = 0.0;
+static int do_amx_config = 0;
+static int do_pmu_budget = 0;
+static int do_ibs_caps = 0;
+static int do_pt_caps = 0;
+static int do_tlb_reach = 0;
 static int do_dump = 0;
 static int do_kernel = 0;
 static int dump_format = DUMP_FORMAT_DEFAULT;
@@ -196,9 +251,23 @@ int main(int argc, char **argv)
 	struct cpuid_state_t state;
 	int c, ret = 0;
 	int cpu_start = -2, cpu_end = -2;
+	struct bench_options_t bench_opts;
+	struct latency_options_t latency_opts;
+	topology_output_t topology_output = TOPOLOGY_OUTPUT_TEXT;
+	pin_policy_t pin_policy = PIN_SPREAD;
+	hints_output_t hints_output = HINTS_OUTPUT_JSON;
+	pmu_output_t pmu_output = PMU_OUTPUT_TEXT;
 
 	INIT_CPUID_STATE(&state);
 
+	memset(&bench_opts, 0, sizeof(bench_opts));
+	bench_opts.output = BENCH_OUTPUT_TEXT;
+	bench_opts.samples = 1000;
+
+	memset(&latency_opts, 0, sizeof(latency_opts));
+	latency_opts.output = LATENCY_OUTPUT_TEXT;
+	latency_opts.rounds = 1000;
+
 	while (TRUE) {
 		static struct option long_options[] = {
 			{"version", no_argument, 0, 'v'},
@@ -212,6 +281,30 @@ int main(int argc, char **argv)
 			{"parse", required_argument, 0, 'f'},
 			{"format", required_argument, 0, 'o'},
 			{"scan-to", required_argument, 0, 2},
+			{"bench", optional_argument, 0, 3},
+			{"bench-parallel", no_argument, 0, 4},
+			{"bench-samples", required_argument, 0, 5},
+			{"timer", required_argument, 0, 6},
+			{"tsc-skew", optional_argument, 0, 7},
+			{"latency-rounds", required_argument, 0, 8},
+			{"c2c", optional_argument, 0, 9},
+			{"topology", optional_argument, 0, 10},
+			{"cache-map", optional_argument, 0, 11},
+			{"core-types", optional_argument, 0, 12},
+			{"pin-plan", required_argument, 0, 13},
+			{"pin-policy", required_argument, 0, 14},
+			{"tuning-hints", optional_argument, 0, 15},
+			{"target-header", no_argument, &do_target_header, 1},
+			{"target-flags", no_argument, &do_target_flags, 1},
+			{"isa-level", no_argument, &do_isa_level, 1},
+			{"rdt-plan", required_argument, 0, 16},
+			{"qos-caps", no_argument, &do_qos_caps, 1},
+			{"mbm-wrap", required_argument, 0, 17},
+			{"amx-config", no_argument, &do_amx_config, 1},
+			{"pmu-budget", optional_argument, 0, 18},
+			{"ibs-caps", no_argument, &do_ibs_caps, 1},
+			{"pt-caps", no_argument, &do_pt_caps, 1},
+			{"tlb-reach", no_argument, &do_tlb_reach, 1},
 			{0, 0, 0, 0}
 		};
 		int option_index = 0;
@@ -229,6 +322,125 @@ int main(int argc, char **argv)
 					if (sscanf(optarg, "%x", &scan_to) != 1)
 						scan_to = 0;
 			break;
+		case 3:
+			do_bench = 1;
+			if (!optarg || 0 == strcmp(optarg, "text"))
+				bench_opts.output = BENCH_OUTPUT_TEXT;
+			else if (0 == strcmp(optarg, "csv"))
+				bench_opts.output = BENCH_OUTPUT_CSV;
+			else if (0 == strcmp(optarg, "json"))
+				bench_opts.output = BENCH_OUTPUT_JSON;
+			else {
+				printf("Unrecognized benchmark format: '%s'\n", optarg);
+				exit(1);
+			}
+			break;
+		case 4:
+			bench_opts.parallel = 1;
+			break;
+		case 5:
+			assert(optarg);
+			if (sscanf(optarg, "%u", &bench_opts.samples) != 1 || !bench_opts.samples) {
+				printf("Option --bench-samples= requires a positive integer parameter.\n");
+				exit(1);
+			}
+			break;
+		case 6:
+			assert(optarg);
+			if (timer_parse(optarg, &bench_opts.timer) != 0) {
+				printf("Unrecognized timer: '%s'\n", optarg);
+				exit(1);
+			}
+			break;
+		case 7:
+		case 9:
+			if (c == 7)
+				do_tsc_skew = 1;
+			else
+				do_c2c = 1;
+			if (!optarg || 0 == strcmp(optarg, "text"))
+				latency_opts.output = LATENCY_OUTPUT_TEXT;
+			else if (0 == strcmp(optarg, "json"))
+				latency_opts.output = LATENCY_OUTPUT_JSON;
+			else {
+				printf("Unrecognized latency format: '%s'\n", optarg);
+				exit(1);
+			}
+			break;
+		case 8:
+			assert(optarg);
+			if (sscanf(optarg, "%u", &latency_opts.rounds) != 1 || !latency_opts.rounds) {
+				printf("Option --latency-rounds= requires a positive integer parameter.\n");
+				exit(1);
+			}
+			break;
+		case 10:
+		case 11:
+		case 12:
+			if (!optarg || 0 == strcmp(optarg, "text"))
+				topology_output = TOPOLOGY_OUTPUT_TEXT;
+			else if (0 == strcmp(optarg, "json"))
+				topology_output = TOPOLOGY_OUTPUT_JSON;
+			else if (c != 10 && 0 == strcmp(optarg, "cpuset"))
+				topology_output = TOPOLOGY_OUTPUT_CPUSET;
+			else {
+				printf("Unrecognized topology format: '%s'\n", optarg);
+				exit(1);
+			}
+			if (c == 10)
+				do_topology = 1;
+			else if (c == 11)
+				do_cache_map = 1;
+			else
+				do_core_types = 1;
+			break;
+		case 13:
+			assert(optarg);
+			if (sscanf(optarg, "%u", &pin_workers) != 1 || !pin_workers) {
+				printf("Option --pin-plan= requires a positive integer parameter.\n");
+				exit(1);
+			}
+			break;
+		case 14:
+			assert(optarg);
+			if (pin_policy_parse(optarg, &pin_policy) != 0) {
+				printf("Unrecognized pinning policy: '%s'\n", optarg);
+				exit(1);
+			}
+			break;
+		case 15:
+			if (!optarg || 0 == strcmp(optarg, "json"))
+				hints_output = HINTS_OUTPUT_JSON;
+			else if (0 == strcmp(optarg, "header"))
+				hints_output = HINTS_OUTPUT_HEADER;
+			else {
+				printf("Unrecognized tuning hints format: '%s'\n", optarg);
+				exit(1);
+			}
+			do_tuning_hints = 1;
+			break;
+		case 16:
+			assert(optarg);
+			rdt_shares = optarg;
+			break;
+		case 17:
+			assert(optarg);
+			if (sscanf(optarg, "%lf", &mbm_peak_gbps) != 1 || mbm_peak_gbps <= 0.0) {
+				printf("Option --mbm-wrap= requires a positive bandwidth in GB/s.\n");
+				exit(1);
+			}
+			break;
+		case 18:
+			if (!optarg || 0 == strcmp(optarg, "text"))
+				pmu_output = PMU_OUTPUT_TEXT;
+			else if (0 == strcmp(optarg, "json"))
+				pmu_output = PMU_OUTPUT_JSON;
+			else {
+				printf("Unrecognized PMU budget format: '%s'\n", optarg);
+				exit(1);
+			}
+			do_pmu_budget = 1;
+			break;
 		case 'c':
 			assert(optarg);
 			if (sscanf(optarg, "%d", &cpu_start) != 1) {
@@ -280,6 +492,54 @@ int main(int argc, char **argv)
 		}
 	}
 
+#ifdef CPUID_AVAILABLE
+	if (do_bench && !file) {
+		uint32_t cpus;
+
+#ifdef __linux__
+		if (do_kernel)
+			state.cpuid_call = cpuid_kernel;
+#endif
+		state.thread_init();
+		cpus = state.thread_count(&state);
+
+		/* Benchmark every CPU unless one was picked with --cpu. */
+		if (cpu_start < 0) {
+			bench_opts.cpu_start = 0;
+			bench_opts.cpu_end = cpus - 1;
+		} else {
+			bench_opts.cpu_start = bench_opts.cpu_end = cpu_start;
+		}
+		if (bench_opts.cpu_end >= cpus) {
+			printf("CPU %u doesn't seem to exist.\n", bench_opts.cpu_end);
+			exit(1);
+		}
+
+		/* Discover the leaves to time by capturing a dump of each CPU. */
+		state.cpuid_print = cpuid_dump_capture;
+		for (c = bench_opts.cpu_start; (uint32_t)c <= bench_opts.cpu_end; c++) {
+			state.thread_bind(&state, c);
+			run_cpuid(&state, 1);
+		}
+
+		ret = bench_run(&state, &bench_opts);
+		goto leave;
+	}
+
+	if ((do_tsc_skew || do_c2c) && !file) {
+#ifdef __linux__
+		if (do_kernel)
+			state.cpuid_call = cpuid_kernel;
+#endif
+		state.thread_init();
+		if (do_tsc_skew)
+			ret = tsc_skew_run(&state, &latency_opts);
+		else
+			ret = c2c_run(&state, &latency_opts);
+		goto leave;
+	}
+#endif
+
 	if (cpu_start == -2)
 		cpu_start = cpu_end = 0;
 
@@ -338,6 +598,145 @@ int main(int argc, char **argv)
 
 	state.thread_init();
 
+	if (do_isa_level) {
+		struct x86_64_level_info_t info;
+		x86_64_level_detail(&state, &info);
+		printf("%s\n", x86_64_level_name(info.level));
+		if (info.missing_count) {
+			uint32_t i;
+			fprintf(stderr, "Missing for %s:", x86_64_level_name((x86_64_level_t)(info.level + 1)));
+			for (i = 0; i < info.missing_count; i++)
+				fprintf(stderr, " %s", info.missing[i]);
+			fprintf(stderr, "\n");
+		}
+		goto leave;
+	}
+
+	if (rdt_shares) {
+		uint32_t shares[RDT_MAX_TENANTS], count;
+		struct rdt_plan_t plan;
+		rdt_plan_error_t error;
+		count = rdt_parse_shares(rdt_shares, shares, RDT_MAX_TENANTS);
+		if (!count) {
+			printf("Option --rdt-plan= requires a comma separated list of positive weights.\n");
+			exit(1);
+		}
+		error = rdt_plan(&state, shares, count, &plan);
+		if (error != RDT_PLAN_OK) {
+			printf("Unable to plan cache allocation: %s.\n", rdt_plan_error_name(error));
+			ret = 1;
+		} else
+			rdt_plan_print(&plan);
+		goto leave;
+	}
+
+	if (mbm_peak_gbps > 0.0) {
+		if (rdt_print_mbm_wrap(&state, mbm_peak_gbps) != 0) {
+			printf("Memory bandwidth monitoring is not supported.\n");
+			ret = 1;
+		}
+		goto leave;
+	}
+
+	if (do_amx_config) {
+		struct amx_info_t amx;
+		if (amx_probe(&state, &amx) != 0) {
+			printf("AMX is not supported.\n");
+			ret = 1;
+		} else
+			amx_print_config(&state, &amx);
+		goto leave;
+	}
+
+	if (do_ibs_caps) {
+		struct ibs_caps_t caps;
+		struct ibs_recommendation_t rec;
+		if (ibs_probe(&state, &caps) != 0) {
+			printf("Instruction Based Sampling is not supported.\n");
+			ret = 1;
+		} else {
+			ibs_recommend(&caps, &rec);
+			ibs_print_json(&caps, &rec);
+		}
+		goto leave;
+	}
+
+	if (do_pt_caps) {
+		struct pt_caps_t caps;
+		struct pt_recommendation_t rec;
+		if (pt_probe(&state, &caps) != 0) {
+			printf("Intel Processor Trace is not supported.\n");
+			ret = 1;
+		} else {
+			pt_recommend(&caps, &rec);
+			pt_print_json(&caps, &rec);
+		}
+		goto leave;
+	}
+
+	if (do_target_flags) {
+		target_print_flags(&state);
+		goto leave;
+	}
+
+	if (do_topology || do_cache_map || do_core_types || pin_workers || do_tuning_hints || do_target_header ||
+	    do_qos_caps || do_pmu_budget || do_tlb_reach) {
+		struct topology_t topo;
+		if (topology_probe(&state, &topo) != 0) {
+			printf("Unable to determine processor topology.\n");
+			ret = 1;
+			goto leave;
+		}
+		if (do_tuning_hints || do_target_header) {
+			struct tuning_hints_t hints;
+			if (tuning_hints_probe(&state, &topo, &hints) != 0) {
+				printf("Unable to gather tuning hints.\n");
+				ret = 1;
+			} else if (do_target_header)
+				target_print_header(&state, &hints);
+			else
+				tuning_hints_print(&hints, hints_output);
+		}
+		else if (do_qos_caps)
+			rdt_print_qos_json(&state, &topo);
+		else if (do_pmu_budget) {
+			if (pmu_print_budget(&state, &topo, pmu_output) != 0)
+				ret = 1;
+		}
+		else if (do_tlb_reach) {
+			if (tlb_print_reach(&state, &topo) != 0) {
+				printf("No TLBs reported.\n");
+				ret = 1;
+			}
+		}
+		else if (do_cache_map)
+			topology_print_cache_map(&topo, topology_output);
+		else if (do_core_types)
+			topology_print_core_types(&topo, topology_output);
+		else if (pin_workers) {
+			uint32_t *cpus = (uint32_t *)calloc(pin_workers, sizeof(uint32_t));
+			uint32_t i, placed;
+			assert(cpus);
+			placed = pin_plan(&topo, pin_policy, pin_workers, cpus);
+			if (placed < pin_workers) {
+				fprintf(stderr, "Only %u CPUs fit the '%s' policy, %u requested.\n",
+				        placed, pin_policy_name(pin_policy), pin_workers);
+				ret = 1;
+			} else {
+				for (i = 0; i < placed; i++)
+					printf("%s%u", i ? "," : "", cpus[i]);
+				printf("\n");
+			}
+			free(cpus);
+		}
+		else if (topology_output == TOPOLOGY_OUTPUT_JSON)
+			topology_print_json(&topo);
+		else
+			topology_print_tree(&topo);
+		topology_free(&topo);
+		goto leave;
+	}
+
 	if (cpu_start == -1) {
 		cpu_start = 0;
 		cpu_end = state.thread_count(&state) - 1;
@@ -0,0 +1,162 @@
+/*
+ * CPUID
+ *
+ * A simple and small tool to dump/decode CPUID information.
+ *
+ * Copyright (c) 2010-2025, Steven Noonan <steven@uplinklabs.net>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "prefix.h"
+
+#include "pinplan.h"
+#include "topology.h"
+#include "util.h"
+
+#include <string.h>
+
+static const char *policy_names[] = {
+	"spread",
+	"pack",
+	"core",
+	"nosmt",
+	"pcore"
+};
+
+int pin_policy_parse(const char *name, pin_policy_t *policy)
+{
+	uint32_t i;
+	for (i = 0; i < NELEM(policy_names); i++) {
+		if (0 == strcmp(name, policy_names[i])) {
+			*policy = (pin_policy_t)i;
+			return 0;
+		}
+	}
+	return 1;
+}
+
+const char *pin_policy_name(pin_policy_t policy)
+{
+	if ((uint32_t)policy >= NELEM(policy_names))
+		return "unknown";
+	return policy_names[policy];
+}
+
+struct pin_candidate_t {
+	uint32_t cpu;
+	uint32_t group;   /* L3 instance (or package, without L3 data) */
+	uint32_t rank;    /* position among the eligible threads of its core */
+};
+
+/* Within a group: first threads of every core, then second threads, etc. */
+static int candidate_compare(const struct topology_t *topo, const void *a, const void *b)
+{
+	const struct pin_candidate_t *x = (const struct pin_candidate_t *)a;
+	const struct pin_candidate_t *y = (const struct pin_candidate_t *)b;
+	const struct topology_cpu_t *cx = &topo->cpus[x->cpu];
+	const struct topology_cpu_t *cy = &topo->cpus[y->cpu];
+
+	if (x->group != y->group)
+		return (x->group > y->group) ? 1 : -1;
+	if (x->rank != y->rank)
+		return (x->rank > y->rank) ? 1 : -1;
+	if (cx->package != cy->package)
+		return (cx->package > cy->package) ? 1 : -1;
+	if (cx->core != cy->core)
+		return (cx->core > cy->core) ? 1 : -1;
+	return (x->cpu > y->cpu) - (x->cpu < y->cpu);
+}
+
+static BOOL same_core(const struct topology_cpu_t *a, const struct topology_cpu_t *b)
+{
+	return a->package == b->package && a->core == b->core;
+}
+
+static BOOL same_group(const struct topology_t *topo, uint32_t a, uint32_t b)
+{
+	if (topology_cache(&topo->cpus[a], L3) && topology_cache(&topo->cpus[b], L3))
+		return topology_shares_cache(topo, a, b, L3) ? TRUE : FALSE;
+	return topo->cpus[a].package == topo->cpus[b].package;
+}
+
+uint32_t pin_plan(const struct topology_t *topo, pin_policy_t policy,
+                  uint32_t workers, uint32_t *cpus)
+{
+	struct pin_candidate_t *cand;
+	uint32_t *group_start, *group_next;
+	uint32_t i, j, count = 0, groups = 0, placed = 0;
+	BOOL hybrid = FALSE;
+
+	cand = (struct pin_candidate_t *)calloc(topo->count + 1, sizeof(struct pin_candidate_t));
+	group_start = (uint32_t *)calloc(topo->count + 1, sizeof(uint32_t));
+	group_next = (uint32_t *)calloc(topo->count + 1, sizeof(uint32_t));
+	assert(cand && group_start && group_next);
+
+	for (i = 0; i < topo->count; i++)
+		if (topo->cpus[i].core_type)
+			hybrid = TRUE;
+
+	for (i = 0; i < topo->count; i++) {
+		const struct topology_cpu_t *cpu = &topo->cpus[i];
+		struct pin_candidate_t *c = &cand[count];
+
+		/* On non-hybrid parts every core counts as a performance core. */
+		if (policy == PIN_PCORE && hybrid && cpu->core_type != 0x40)
+			continue;
+
+		c->cpu = i;
+		c->group = UINT32_MAX;
+		c->rank = 0;
+		for (j = 0; j < count; j++) {
+			if (c->group == UINT32_MAX && same_group(topo, cand[j].cpu, i))
+				c->group = cand[j].group;
+			if (same_core(&topo->cpus[cand[j].cpu], cpu))
+				c->rank++;
+		}
+		if (c->group == UINT32_MAX)
+			c->group = groups++;
+
+		if ((policy == PIN_CORE || policy == PIN_NOSMT) && c->rank)
+			continue;
+		count++;
+	}
+
+	topology_sort(topo, cand, count, sizeof(struct pin_candidate_t), candidate_compare);
+
+	for (i = count; i-- > 0; )
+		group_start[cand[i].group] = i;
+	for (i = 0; i < groups; i++)
+		group_next[i] = group_start[i];
+
+	if (policy == PIN_PACK || policy == PIN_CORE) {
+		for (i = 0; i < count && placed < workers; i++)
+			cpus[placed++] = cand[i].cpu;
+	} else {
+		/* Round-robin across groups, each handing out its next CPU. */
+		while (placed < workers && placed < count) {
+			for (i = 0; i < groups && placed < workers; i++) {
+				if (group_next[i] < count && cand[group_next[i]].group == i)
+					cpus[placed++] = cand[group_next[i]++].cpu;
+			}
+		}
+	}
+
+	free(group_next);
+	free(group_start);
+	free(cand);
+	return placed;
+}
+
+/* vim: set ts=4 sts=4 sw=4 noet: */
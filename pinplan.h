@@ -0,0 +1,48 @@
+/*
+ * CPUID
+ *
+ * A simple and small tool to dump/decode CPUID information.
+ *
+ * Copyright (c) 2010-2025, Steven Noonan <steven@uplinklabs.net>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef __pinplan_h
+#define __pinplan_h
+
+struct topology_t;
+
+typedef enum {
+	PIN_SPREAD = 0,  /* round-robin across L3 instances, cores before SMT siblings */
+	PIN_PACK,        /* fill one L3 instance before moving to the next */
+	PIN_CORE,        /* one thread per physical core, packed by L3 */
+	PIN_NOSMT,       /* one thread per physical core, spread across L3s */
+	PIN_PCORE        /* performance cores only, spread across L3s */
+} pin_policy_t;
+
+int pin_policy_parse(const char *name, pin_policy_t *policy);
+const char *pin_policy_name(pin_policy_t policy);
+
+/* Picks 'workers' logical CPUs according to the policy and stores them, in
+ * the order workers should be placed, in 'cpus'. Returns the number of
+ * CPUs the policy allows if that is fewer than 'workers' (and leaves 'cpus'
+ * partially filled), or 'workers' on success.
+ */
+uint32_t pin_plan(const struct topology_t *topo, pin_policy_t policy,
+                  uint32_t workers, uint32_t *cpus);
+
+#endif
+
+/* vim: set ts=4 sts=4 sw=4 noet: */
@@ -0,0 +1,387 @@
+/*
+ * CPUID
+ *
+ * A simple and small tool to dump/decode CPUID information.
+ *
+ * Copyright (c) 2010-2025, Steven Noonan <steven@uplinklabs.net>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "prefix.h"
+
+#include "cpuid.h"
+#include "handlers.h"
+#include "pmu.h"
+#include "state.h"
+#include "topology.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void query(struct cpuid_state_t *state, struct cpu_regs_t *regs,
+                  uint32_t leaf, uint32_t subleaf)
+{
+	ZERO_REGS(regs);
+	regs->eax = leaf;
+	regs->ecx = subleaf;
+	state->cpuid_call(regs, state);
+}
+
+static uint32_t low_bits(uint32_t count)
+{
+	return count >= 32 ? 0xffffffff : (1u << count) - 1;
+}
+
+static void probe_intel(struct cpuid_state_t *state, uint32_t maxleaf, struct pmu_budget_t *budget)
+{
+	struct cpu_regs_t regs;
+	uint32_t ebx_length;
+
+	if (maxleaf < 0xA)
+		return;
+
+	query(state, &regs, 0xA, 0);
+	budget->version = regs.eax & 0xff;
+	if (!budget->version)
+		return;
+	budget->gp_counters = (regs.eax >> 8) & 0xff;
+	budget->gp_width = (regs.eax >> 16) & 0xff;
+	budget->gp_mask = low_bits(budget->gp_counters);
+	ebx_length = regs.eax >> 24;
+	/* A set EBX bit marks the event as unavailable. */
+	budget->arch_events = ~regs.ebx & low_bits(ebx_length);
+
+	if (budget->version > 1) {
+		budget->fixed_counters = regs.edx & 0x1f;
+		budget->fixed_width = (regs.edx >> 5) & 0xff;
+		budget->fixed_mask = low_bits(budget->fixed_counters);
+	}
+	/* From version 5, ECX lists fixed counters beyond the contiguous ones. */
+	if (budget->version >= 5)
+		budget->fixed_mask |= regs.ecx;
+
+	if (maxleaf < 0x23)
+		goto out;
+
+	query(state, &regs, 0x23, 0);
+	if (!(regs.eax & 0x1))
+		goto out;
+	budget->has_leaf23 = 1;
+	budget->topdown_slots = regs.ecx & 0xff;
+
+	if (regs.eax & 0x2) {
+		struct cpu_regs_t sub;
+		query(state, &sub, 0x23, 1);
+		budget->gp_mask = sub.eax;
+		budget->fixed_mask = sub.ebx;
+	}
+	if (regs.eax & 0x4) {
+		struct cpu_regs_t sub;
+		query(state, &sub, 0x23, 2);
+		budget->acr_gp_mask = sub.eax;
+		budget->acr_fixed_mask = sub.ebx;
+	}
+	if (regs.eax & 0x8) {
+		struct cpu_regs_t sub;
+		query(state, &sub, 0x23, 3);
+		budget->arch_events = sub.eax;
+	}
+
+out:
+	budget->gp_counters = popcnt(budget->gp_mask);
+	budget->fixed_counters = popcnt(budget->fixed_mask);
+}
+
+static void probe_amd(struct cpuid_state_t *state, uint32_t maxext, struct pmu_budget_t *budget)
+{
+	struct cpu_regs_t regs;
+
+	if (maxext < 0x80000001)
+		return;
+
+	/* Before PerfMonV2, the core counter count follows PerfCtrExtCore, and
+	 * the northbridge and L3 counters have fixed counts.
+	 */
+	query(state, &regs, 0x80000001, 0);
+	budget->gp_counters = (regs.ecx & 0x00800000) ? 6 : 4;
+	budget->nb_counters = (regs.ecx & 0x01000000) ? 4 : 0;
+	budget->llc_counters = (regs.ecx & 0x10000000) ? 6 : 0;
+	budget->gp_width = 48;
+
+	if (maxext >= 0x80000022) {
+		query(state, &regs, 0x80000022, 0);
+		if (regs.eax & 0x1) {
+			budget->perfmon_v2 = 1;
+			budget->version = 2;
+			budget->gp_counters = regs.ebx & 0xf;
+			budget->nb_counters = (regs.ebx >> 10) & 0x3f;
+			budget->umc_counters = (regs.ebx >> 16) & 0x3f;
+		}
+	}
+	budget->gp_mask = low_bits(budget->gp_counters);
+}
+
+int pmu_probe(struct cpuid_state_t *state, struct pmu_budget_t *budget)
+{
+	struct cpu_regs_t regs;
+	uint32_t maxleaf, maxext;
+	char vendor[13];
+
+	memset(budget, 0, sizeof(struct pmu_budget_t));
+
+	query(state, &regs, 0, 0);
+	maxleaf = regs.eax;
+	memcpy(vendor, &regs.ebx, 4);
+	memcpy(vendor + 4, &regs.edx, 4);
+	memcpy(vendor + 8, &regs.ecx, 4);
+	vendor[12] = 0;
+
+	query(state, &regs, 0x80000000, 0);
+	maxext = (regs.eax & 0xffff0000) == 0x80000000 ? regs.eax : 0;
+
+	if (vendor_id(vendor) & (VENDOR_AMD | VENDOR_HYGON))
+		probe_amd(state, maxext, budget);
+	else
+		probe_intel(state, maxleaf, budget);
+
+	return budget->gp_counters || budget->fixed_counters ? 0 : 1;
+}
+
+int ibs_probe(struct cpuid_state_t *state, struct ibs_caps_t *caps)
+{
+	struct cpu_regs_t regs;
+	uint32_t maxext;
+
+	memset(caps, 0, sizeof(struct ibs_caps_t));
+
+	query(state, &regs, 0x80000000, 0);
+	maxext = (regs.eax & 0xffff0000) == 0x80000000 ? regs.eax : 0;
+	if (maxext < 0x8000001B)
+		return 1;
+
+	/* 0x80000001 ECX[10] is IBS. */
+	query(state, &regs, 0x80000001, 0);
+	if (!(regs.ecx & 0x400))
+		return 1;
+
+	query(state, &regs, 0x8000001B, 0);
+	if (!(regs.eax & 0x1))
+		return 1;
+
+	caps->fetch_sampling = (regs.eax >> 1) & 1;
+	caps->op_sampling = (regs.eax >> 2) & 1;
+	caps->rdwr_op_count = (regs.eax >> 3) & 1;
+	caps->op_count_mode = (regs.eax >> 4) & 1;
+	caps->branch_target = (regs.eax >> 5) & 1;
+	caps->op_count_ext = (regs.eax >> 6) & 1;
+	caps->rip_invalid_check = (regs.eax >> 7) & 1;
+	caps->fused_branch = (regs.eax >> 8) & 1;
+	caps->fetch_ctl_ext = (regs.eax >> 9) & 1;
+	caps->op_data4 = (regs.eax >> 10) & 1;
+	caps->l3_miss_filter = (regs.eax >> 11) & 1;
+	caps->load_latency_filter = (regs.eax >> 12) & 1;
+	caps->dtlb_stats = (regs.eax >> 19) & 1;
+
+	/* MaxCnt fields hold the period in units of 16, 16 bits wide, or 23
+	 * bits for ops with OpCntExt.
+	 */
+	if (caps->fetch_sampling)
+		caps->max_fetch_period = ((1ULL << 16) - 1) << 4;
+	if (caps->op_sampling)
+		caps->max_op_period = ((1ULL << (caps->op_count_ext ? 23 : 16)) - 1) << 4;
+
+	return 0;
+}
+
+void ibs_recommend(const struct ibs_caps_t *caps, struct ibs_recommendation_t *rec)
+{
+	memset(rec, 0, sizeof(struct ibs_recommendation_t));
+
+	/* An op sample describes a whole op (addresses, latency, cache and
+	 * TLB outcome), so it beats a fetch sample for the same interrupt
+	 * cost.
+	 */
+	if (caps->op_sampling) {
+		rec->sample = IBS_SAMPLE_OP;
+		rec->period = caps->max_op_period;
+		/* Counting dispatched ops ties the sample rate to work done, so a
+		 * stalled core doesn't sample any faster.
+		 */
+		rec->count_ops = caps->op_count_mode;
+		rec->l3_miss_only = caps->l3_miss_filter;
+		rec->discard_invalid_rip = caps->rip_invalid_check;
+		rec->branch_target = caps->branch_target;
+	} else if (caps->fetch_sampling) {
+		rec->sample = IBS_SAMPLE_FETCH;
+		rec->period = caps->max_fetch_period;
+		rec->l3_miss_only = caps->l3_miss_filter;
+	}
+}
+
+const char *ibs_sample_name(ibs_sample_t sample)
+{
+	switch (sample) {
+	case IBS_SAMPLE_OP:    return "op";
+	case IBS_SAMPLE_FETCH: return "fetch";
+	default:               return "none";
+	}
+}
+
+#define JSON_BOOL(x) ((x) ? "true" : "false")
+
+void ibs_print_json(const struct ibs_caps_t *caps, const struct ibs_recommendation_t *rec)
+{
+	printf("{\n  \"capabilities\": {\n");
+	printf("    \"fetch_sampling\": %s,\n", JSON_BOOL(caps->fetch_sampling));
+	printf("    \"op_sampling\": %s,\n", JSON_BOOL(caps->op_sampling));
+	printf("    \"rdwr_op_count\": %s,\n", JSON_BOOL(caps->rdwr_op_count));
+	printf("    \"op_count_mode\": %s,\n", JSON_BOOL(caps->op_count_mode));
+	printf("    \"branch_target\": %s,\n", JSON_BOOL(caps->branch_target));
+	printf("    \"op_count_ext\": %s,\n", JSON_BOOL(caps->op_count_ext));
+	printf("    \"rip_invalid_check\": %s,\n", JSON_BOOL(caps->rip_invalid_check));
+	printf("    \"fused_branch\": %s,\n", JSON_BOOL(caps->fused_branch));
+	printf("    \"fetch_ctl_ext\": %s,\n", JSON_BOOL(caps->fetch_ctl_ext));
+	printf("    \"op_data4\": %s,\n", JSON_BOOL(caps->op_data4));
+	printf("    \"l3_miss_filter\": %s,\n", JSON_BOOL(caps->l3_miss_filter));
+	printf("    \"load_latency_filter\": %s,\n", JSON_BOOL(caps->load_latency_filter));
+	printf("    \"dtlb_stats\": %s,\n", JSON_BOOL(caps->dtlb_stats));
+	printf("    \"max_op_period\": %" PRIu64 ",\n", caps->max_op_period);
+	printf("    \"max_fetch_period\": %" PRIu64 "\n", caps->max_fetch_period);
+	printf("  },\n  \"recommendation\": {\n");
+	printf("    \"sample\": \"%s\",\n", ibs_sample_name(rec->sample));
+	printf("    \"period\": %" PRIu64 ",\n", rec->period);
+	printf("    \"count\": \"%s\",\n", rec->count_ops ? "ops" : "cycles");
+	printf("    \"l3_miss_only\": %s,\n", JSON_BOOL(rec->l3_miss_only));
+	printf("    \"discard_invalid_rip\": %s,\n", JSON_BOOL(rec->discard_invalid_rip));
+	printf("    \"branch_target\": %s\n", JSON_BOOL(rec->branch_target));
+	printf("  }\n}\n");
+}
+
+struct budget_group_t {
+	struct pmu_budget_t budget;
+	uint8_t core_type;
+	uint32_t count;
+	uint32_t *cpus;
+};
+
+static void print_group_text(const struct budget_group_t *group, const char *cpuset)
+{
+	const struct pmu_budget_t *b = &group->budget;
+
+	printf("  CPUs %s", cpuset);
+	if (group->core_type)
+		printf(" (%s)", hybrid_core_type_name(group->core_type));
+	printf(":\n");
+	if (!b->gp_counters && !b->fixed_counters) {
+		printf("    No performance counters reported\n");
+		return;
+	}
+	printf("    %u general-purpose counters (mask 0x%x, %u bits)\n",
+	       b->gp_counters, b->gp_mask, b->gp_width);
+	if (b->fixed_counters)
+		printf("    %u fixed counters (mask 0x%x, %u bits)\n",
+		       b->fixed_counters, b->fixed_mask, b->fixed_width);
+	if (b->topdown_slots)
+		printf("    %u top-down slots per cycle\n", b->topdown_slots);
+	if (b->acr_gp_mask || b->acr_fixed_mask)
+		printf("    Auto counter reload on GP mask 0x%x, fixed mask 0x%x\n",
+		       b->acr_gp_mask, b->acr_fixed_mask);
+	if (b->nb_counters || b->llc_counters || b->umc_counters)
+		printf("    Uncore: %u data fabric, %u L3, %u memory controller counters\n",
+		       b->nb_counters, b->llc_counters, b->umc_counters);
+}
+
+static void print_group_json(const struct budget_group_t *group, const char *cpuset)
+{
+	const struct pmu_budget_t *b = &group->budget;
+	uint32_t i;
+
+	printf("    { \"cpuset\": \"%s\", \"core_type\": %u, \"version\": %u, "
+	       "\"gp\": %u, \"gp_mask\": \"0x%x\", \"gp_width\": %u, "
+	       "\"fixed\": %u, \"fixed_mask\": \"0x%x\", \"fixed_width\": %u, "
+	       "\"arch_events\": \"0x%x\", \"topdown_slots\": %u, "
+	       "\"acr_gp_mask\": \"0x%x\", \"acr_fixed_mask\": \"0x%x\", "
+	       "\"nb\": %u, \"llc\": %u, \"umc\": %u, \"cpus\": [",
+	       cpuset, group->core_type, b->version,
+	       b->gp_counters, b->gp_mask, b->gp_width,
+	       b->fixed_counters, b->fixed_mask, b->fixed_width,
+	       b->arch_events, b->topdown_slots,
+	       b->acr_gp_mask, b->acr_fixed_mask,
+	       b->nb_counters, b->llc_counters, b->umc_counters);
+	for (i = 0; i < group->count; i++)
+		printf("%s%u", i ? ", " : "", group->cpus[i]);
+	printf("] }");
+}
+
+int pmu_print_budget(struct cpuid_state_t *state, const struct topology_t *topo, pmu_output_t output)
+{
+	struct budget_group_t *groups;
+	uint32_t bufsize = topo->count * 12 + 1;
+	char *buffer;
+	uint32_t i, k, count = 0;
+
+	groups = (struct budget_group_t *)calloc(topo->count + 1, sizeof(struct budget_group_t));
+	buffer = (char *)malloc(bufsize);
+	assert(groups && buffer);
+
+	for (i = 0; i < topo->count; i++) {
+		const struct topology_cpu_t *cpu = &topo->cpus[i];
+		struct pmu_budget_t budget;
+
+		if (state->thread_bind(state, cpu->cpu) != 0)
+			continue;
+		pmu_probe(state, &budget);
+
+		for (k = 0; k < count; k++)
+			if (groups[k].core_type == cpu->core_type &&
+			    memcmp(&groups[k].budget, &budget, sizeof(budget)) == 0)
+				break;
+		if (k == count) {
+			groups[k].budget = budget;
+			groups[k].core_type = cpu->core_type;
+			groups[k].cpus = (uint32_t *)calloc(topo->count, sizeof(uint32_t));
+			assert(groups[k].cpus);
+			count++;
+		}
+		groups[k].cpus[groups[k].count++] = cpu->cpu;
+	}
+
+	if (output == PMU_OUTPUT_JSON)
+		printf("{\n  \"budgets\": [\n");
+	else
+		printf("PMU counter budget:\n");
+	for (k = 0; k < count; k++) {
+		topology_format_cpus(groups[k].cpus, groups[k].count, buffer, bufsize);
+		if (output == PMU_OUTPUT_JSON) {
+			print_group_json(&groups[k], buffer);
+			printf("%s\n", k + 1 < count ? "," : "");
+		} else
+			print_group_text(&groups[k], buffer);
+	}
+	if (output == PMU_OUTPUT_JSON)
+		printf("  ]\n}\n");
+	else
+		printf("\n");
+
+	for (k = 0; k < count; k++)
+		free(groups[k].cpus);
+	free(groups);
+	free(buffer);
+	return count ? 0 : 1;
+}
+
+/* vim: set ts=4 sts=4 sw=4 noet: */
@@ -0,0 +1,115 @@
+/*
+ * CPUID
+ *
+ * A simple and small tool to dump/decode CPUID information.
+ *
+ * Copyright (c) 2010-2025, Steven Noonan <steven@uplinklabs.net>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef __pmu_h
+#define __pmu_h
+
+struct cpuid_state_t;
+struct topology_t;
+
+/* The performance counters one logical CPU can program at once, from leaves
+ * 0xA and 0x23 on Intel, or 0x80000001 and 0x80000022 on AMD. Hybrid parts
+ * report different budgets on each core type.
+ */
+struct pmu_budget_t {
+	uint32_t version;          /* architectural perfmon version (2 for AMD PerfMonV2) */
+	uint32_t gp_counters;
+	uint32_t gp_mask;          /* bitmap of usable general-purpose counters */
+	uint32_t gp_width;
+	uint32_t fixed_counters;
+	uint32_t fixed_mask;
+	uint32_t fixed_width;
+	uint32_t arch_events;      /* bitmap of available architectural events */
+	uint32_t topdown_slots;    /* TMA slots per cycle, from leaf 0x23 */
+	uint32_t acr_gp_mask;      /* counters that support auto counter reload */
+	uint32_t acr_fixed_mask;
+	uint32_t nb_counters;      /* AMD data fabric (northbridge) counters */
+	uint32_t llc_counters;     /* AMD L3 counters */
+	uint32_t umc_counters;     /* AMD memory controller counters */
+	unsigned int has_leaf23:1;
+	unsigned int perfmon_v2:1; /* AMD global control/status registers */
+};
+
+/* Reads the budget of the current CPU. Returns nonzero if the processor
+ * reports no performance counters.
+ */
+int pmu_probe(struct cpuid_state_t *state, struct pmu_budget_t *budget);
+
+/* AMD Instruction Based Sampling, from leaf 0x8000001B EAX. */
+struct ibs_caps_t {
+	unsigned int fetch_sampling:1;
+	unsigned int op_sampling:1;
+	unsigned int rdwr_op_count:1;     /* current op count is readable and writable */
+	unsigned int op_count_mode:1;     /* op sampling can count dispatched ops, not just cycles */
+	unsigned int branch_target:1;     /* IbsBrTarget MSR */
+	unsigned int op_count_ext:1;      /* op max/current count widened by 7 bits */
+	unsigned int rip_invalid_check:1;
+	unsigned int fused_branch:1;
+	unsigned int fetch_ctl_ext:1;     /* IbsFetchCtlExtd MSR (ITLB refill latency) */
+	unsigned int op_data4:1;
+	unsigned int l3_miss_filter:1;    /* sample only ops and fetches that miss the L3 */
+	unsigned int load_latency_filter:1;
+	unsigned int dtlb_stats:1;        /* simplified DTLB page size and miss reporting */
+	uint64_t max_op_period;           /* in ops or cycles */
+	uint64_t max_fetch_period;        /* in cycles */
+};
+
+/* Reads the IBS capabilities of the current CPU. Returns nonzero if the
+ * processor has no IBS.
+ */
+int ibs_probe(struct cpuid_state_t *state, struct ibs_caps_t *caps);
+
+typedef enum {
+	IBS_SAMPLE_NONE = 0,
+	IBS_SAMPLE_OP,
+	IBS_SAMPLE_FETCH
+} ibs_sample_t;
+
+/* The cheapest IBS setup that still gives useful always-on samples: the
+ * longest period the hardware allows, and whatever hardware filtering
+ * drops samples before they raise an interrupt.
+ */
+struct ibs_recommendation_t {
+	ibs_sample_t sample;
+	uint64_t period;
+	unsigned int count_ops:1;         /* count dispatched ops rather than cycles */
+	unsigned int l3_miss_only:1;      /* filter to L3 misses for memory profiles */
+	unsigned int discard_invalid_rip:1;
+	unsigned int branch_target:1;
+};
+
+void ibs_recommend(const struct ibs_caps_t *caps, struct ibs_recommendation_t *rec);
+const char *ibs_sample_name(ibs_sample_t sample);
+void ibs_print_json(const struct ibs_caps_t *caps, const struct ibs_recommendation_t *rec);
+
+typedef enum {
+	PMU_OUTPUT_TEXT = 0,
+	PMU_OUTPUT_JSON
+} pmu_output_t;
+
+/* Probes every CPU and prints one line (or JSON object) per distinct
+ * budget, with the CPUs that have it.
+ */
+int pmu_print_budget(struct cpuid_state_t *state, const struct topology_t *topo, pmu_output_t output);
+
+#endif
+
+/* vim: set ts=4 sts=4 sw=4 noet: */
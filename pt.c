@@ -0,0 +1,205 @@
+/*
+ * CPUID
+ *
+ * A simple and small tool to dump/decode CPUID information.
+ *
+ * Copyright (c) 2010-2025, Steven Noonan <steven@uplinklabs.net>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "prefix.h"
+
+#include "pt.h"
+#include "state.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static void query(struct cpuid_state_t *state, struct cpu_regs_t *regs,
+                  uint32_t leaf, uint32_t subleaf)
+{
+	ZERO_REGS(regs);
+	regs->eax = leaf;
+	regs->ecx = subleaf;
+	state->cpuid_call(regs, state);
+}
+
+int pt_probe(struct cpuid_state_t *state, struct pt_caps_t *caps)
+{
+	struct cpu_regs_t regs;
+	uint32_t max;
+
+	memset(caps, 0, sizeof(struct pt_caps_t));
+
+	query(state, &regs, 0, 0);
+	if (regs.eax < 0x14)
+		return 1;
+
+	query(state, &regs, 7, 0);
+	if (!(regs.ebx & 0x02000000))
+		return 1;
+
+	query(state, &regs, 0x14, 0);
+	max = regs.eax;
+	caps->cr3_filter = (regs.ebx & 0x001) ? 1 : 0;
+	caps->psb_cyc = (regs.ebx & 0x002) ? 1 : 0;
+	caps->ip_filter = (regs.ebx & 0x004) ? 1 : 0;
+	caps->mtc = (regs.ebx & 0x008) ? 1 : 0;
+	caps->ptwrite = (regs.ebx & 0x010) ? 1 : 0;
+	caps->power_event = (regs.ebx & 0x020) ? 1 : 0;
+	caps->psb_pmi_preserve = (regs.ebx & 0x040) ? 1 : 0;
+	caps->event_trace = (regs.ebx & 0x080) ? 1 : 0;
+	caps->tnt_disable = (regs.ebx & 0x100) ? 1 : 0;
+	caps->topa = (regs.ecx & 0x1) ? 1 : 0;
+	caps->topa_multi = (regs.ecx & 0x2) ? 1 : 0;
+	caps->single_range = (regs.ecx & 0x4) ? 1 : 0;
+	caps->trace_transport = (regs.ecx & 0x8) ? 1 : 0;
+	caps->lip = (regs.ecx & 0x80000000) ? 1 : 0;
+
+	if (max < 1)
+		return 0;
+
+	/* The bitmaps are only meaningful when the matching subleaf 0 bit says
+	 * the field can be programmed at all.
+	 */
+	query(state, &regs, 0x14, 1);
+	if (caps->ip_filter)
+		caps->address_ranges = regs.eax & 0x7;
+	if (caps->mtc)
+		caps->mtc_periods = regs.eax >> 16;
+	if (caps->psb_cyc) {
+		caps->cyc_thresholds = regs.ebx & 0xffff;
+		caps->psb_freqs = regs.ebx >> 16;
+	}
+
+	return 0;
+}
+
+uint32_t pt_mtc_period(uint32_t encoding)
+{
+	return 1u << encoding;
+}
+
+uint32_t pt_cyc_threshold(uint32_t encoding)
+{
+	return encoding ? 1u << (encoding - 1) : 0;
+}
+
+uint32_t pt_psb_bytes(uint32_t encoding)
+{
+	return 2048u << encoding;
+}
+
+static int highest_encoding(uint32_t bitmap)
+{
+	int n;
+	for (n = 15; n >= 0; n--)
+		if (bitmap & (1u << n))
+			return n;
+	return -1;
+}
+
+void pt_recommend(const struct pt_caps_t *caps, struct pt_recommendation_t *rec)
+{
+	memset(rec, 0, sizeof(struct pt_recommendation_t));
+
+	/* Multi-entry ToPA lets the buffer be as large as we like without
+	 * physically contiguous memory, and only interrupts on the entries we
+	 * ask for. Single-range is next best; a single-entry ToPA table has to
+	 * stop at the end of every buffer.
+	 */
+	if (caps->topa_multi)
+		rec->output = PT_OUTPUT_TOPA_MULTI;
+	else if (caps->single_range)
+		rec->output = PT_OUTPUT_SINGLE_RANGE;
+	else if (caps->topa)
+		rec->output = PT_OUTPUT_TOPA;
+
+	/* PSB and MTC packets are pure overhead for a decoder that only needs
+	 * to resync now and then, so use the sparsest encodings available.
+	 */
+	rec->mtc_encoding = highest_encoding(caps->mtc_periods);
+	rec->psb_encoding = highest_encoding(caps->psb_freqs);
+
+	/* Without TNT packets only indirect branches are traced, which is
+	 * enough for call graphs and is the bulk of the trace volume saved.
+	 */
+	rec->tnt_disable = caps->tnt_disable;
+}
+
+const char *pt_output_name(pt_output_t output)
+{
+	switch (output) {
+	case PT_OUTPUT_SINGLE_RANGE: return "single-range";
+	case PT_OUTPUT_TOPA_MULTI:   return "topa-multi";
+	case PT_OUTPUT_TOPA:         return "topa";
+	default:                     return "none";
+	}
+}
+
+#define JSON_BOOL(x) ((x) ? "true" : "false")
+
+static void print_encodings(const char *name, uint32_t bitmap, const char *unit,
+                            uint32_t (*value)(uint32_t), int last)
+{
+	uint32_t n, count = 0;
+
+	printf("    \"%s\": [", name);
+	for (n = 0; n < 16; n++) {
+		if (!(bitmap & (1u << n)))
+			continue;
+		printf("%s{ \"encoding\": %u, \"%s\": %u }", count++ ? ", " : "", n, unit, value(n));
+	}
+	printf("]%s\n", last ? "" : ",");
+}
+
+void pt_print_json(const struct pt_caps_t *caps, const struct pt_recommendation_t *rec)
+{
+	printf("{\n  \"capabilities\": {\n");
+	printf("    \"cr3_filter\": %s,\n", JSON_BOOL(caps->cr3_filter));
+	printf("    \"psb_cyc\": %s,\n", JSON_BOOL(caps->psb_cyc));
+	printf("    \"ip_filter\": %s,\n", JSON_BOOL(caps->ip_filter));
+	printf("    \"mtc\": %s,\n", JSON_BOOL(caps->mtc));
+	printf("    \"ptwrite\": %s,\n", JSON_BOOL(caps->ptwrite));
+	printf("    \"power_event\": %s,\n", JSON_BOOL(caps->power_event));
+	printf("    \"psb_pmi_preserve\": %s,\n", JSON_BOOL(caps->psb_pmi_preserve));
+	printf("    \"event_trace\": %s,\n", JSON_BOOL(caps->event_trace));
+	printf("    \"tnt_disable\": %s,\n", JSON_BOOL(caps->tnt_disable));
+	printf("    \"topa\": %s,\n", JSON_BOOL(caps->topa));
+	printf("    \"topa_multi\": %s,\n", JSON_BOOL(caps->topa_multi));
+	printf("    \"single_range\": %s,\n", JSON_BOOL(caps->single_range));
+	printf("    \"trace_transport\": %s,\n", JSON_BOOL(caps->trace_transport));
+	printf("    \"lip\": %s,\n", JSON_BOOL(caps->lip));
+	printf("    \"address_ranges\": %u,\n", caps->address_ranges);
+	print_encodings("mtc_periods", caps->mtc_periods, "crystal_ticks", pt_mtc_period, 0);
+	print_encodings("cyc_thresholds", caps->cyc_thresholds, "cycles", pt_cyc_threshold, 0);
+	print_encodings("psb_freqs", caps->psb_freqs, "bytes", pt_psb_bytes, 1);
+	printf("  },\n  \"recommendation\": {\n");
+	printf("    \"output\": \"%s\",\n", pt_output_name(rec->output));
+	if (rec->mtc_encoding >= 0)
+		printf("    \"mtc_freq\": %d,\n", rec->mtc_encoding);
+	else
+		printf("    \"mtc_freq\": null,\n");
+	if (rec->psb_encoding >= 0)
+		printf("    \"psb_freq\": %d,\n", rec->psb_encoding);
+	else
+		printf("    \"psb_freq\": null,\n");
+	printf("    \"cyc\": false,\n");
+	printf("    \"tnt_disable\": %s\n", JSON_BOOL(rec->tnt_disable));
+	printf("  }\n}\n");
+}
+
+/* vim: set ts=4 sts=4 sw=4 noet: */
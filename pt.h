@@ -0,0 +1,86 @@
+/*
+ * CPUID
+ *
+ * A simple and small tool to dump/decode CPUID information.
+ *
+ * Copyright (c) 2010-2025, Steven Noonan <steven@uplinklabs.net>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef __pt_h
+#define __pt_h
+
+struct cpuid_state_t;
+
+/* Intel Processor Trace capabilities, from leaf 0x14 subleaves 0 and 1. */
+struct pt_caps_t {
+	unsigned int cr3_filter:1;
+	unsigned int psb_cyc:1;           /* configurable PSB frequency, cycle-accurate mode */
+	unsigned int ip_filter:1;         /* IP filtering, TraceStop, MSRs kept across warm reset */
+	unsigned int mtc:1;
+	unsigned int ptwrite:1;
+	unsigned int power_event:1;
+	unsigned int psb_pmi_preserve:1;
+	unsigned int event_trace:1;
+	unsigned int tnt_disable:1;
+	unsigned int topa:1;
+	unsigned int topa_multi:1;        /* ToPA tables hold more than one output entry */
+	unsigned int single_range:1;
+	unsigned int trace_transport:1;
+	unsigned int lip:1;               /* IP payloads are linear addresses, not offsets */
+	uint32_t address_ranges;
+	uint32_t mtc_periods;             /* bitmap of supported MTCFreq encodings */
+	uint32_t cyc_thresholds;          /* bitmap of supported CycThresh encodings */
+	uint32_t psb_freqs;               /* bitmap of supported PSBFreq encodings */
+};
+
+/* Reads leaf 0x14 on the current CPU. Returns nonzero if the processor has
+ * no Intel PT.
+ */
+int pt_probe(struct cpuid_state_t *state, struct pt_caps_t *caps);
+
+/* What an encoding in each bitmap means: MTC packets every 2^n crystal
+ * clock ticks, CYC packets after 2^(n-1) cycles (every cycle for 0) and a
+ * PSB every 2^(n+11) output bytes.
+ */
+uint32_t pt_mtc_period(uint32_t encoding);
+uint32_t pt_cyc_threshold(uint32_t encoding);
+uint32_t pt_psb_bytes(uint32_t encoding);
+
+typedef enum {
+	PT_OUTPUT_NONE = 0,
+	PT_OUTPUT_SINGLE_RANGE,
+	PT_OUTPUT_TOPA_MULTI,
+	PT_OUTPUT_TOPA
+} pt_output_t;
+
+/* The cheapest setup for always-on control flow tracing: the sparsest sync
+ * and timing packets the hardware allows, no cycle-accurate mode, and an
+ * output scheme that doesn't stop for the PMI on every buffer.
+ */
+struct pt_recommendation_t {
+	pt_output_t output;
+	int mtc_encoding;                 /* -1 if MTC can't be configured */
+	int psb_encoding;                 /* -1 if PSB frequency is fixed */
+	unsigned int tnt_disable:1;
+};
+
+void pt_recommend(const struct pt_caps_t *caps, struct pt_recommendation_t *rec);
+const char *pt_output_name(pt_output_t output);
+void pt_print_json(const struct pt_caps_t *caps, const struct pt_recommendation_t *rec);
+
+#endif
+
+/* vim: set ts=4 sts=4 sw=4 noet: */
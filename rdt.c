@@ -0,0 +1,573 @@
+/*
+ * CPUID
+ *
+ * A simple and small tool to dump/decode CPUID information.
+ *
+ * Copyright (c) 2010-2025, Steven Noonan <steven@uplinklabs.net>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "prefix.h"
+
+#include "cpuid.h"
+#include "handlers.h"
+#include "rdt.h"
+#include "state.h"
+#include "topology.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void query(struct cpuid_state_t *state, struct cpu_regs_t *regs,
+                  uint32_t leaf, uint32_t subleaf)
+{
+	ZERO_REGS(regs);
+	regs->eax = leaf;
+	regs->ecx = subleaf;
+	state->cpuid_call(regs, state);
+}
+
+static void probe_cat(struct cpuid_state_t *state, uint32_t subleaf, struct rdt_cat_t *cat)
+{
+	struct cpu_regs_t regs;
+	query(state, &regs, 0x10, subleaf);
+	cat->cbm_len = (regs.eax & 0x1f) + 1;
+	cat->shareable = regs.ebx;
+	cat->clos_count = (regs.edx & 0xffff) + 1;
+	cat->non_cpu = (regs.ecx >> 1) & 1;
+	cat->cdp = (regs.ecx >> 2) & 1;
+	cat->noncontiguous = (regs.ecx >> 3) & 1;
+}
+
+int rdt_alloc_probe(struct cpuid_state_t *state, struct rdt_alloc_t *alloc)
+{
+	struct cpu_regs_t regs;
+
+	memset(alloc, 0, sizeof(struct rdt_alloc_t));
+
+	query(state, &regs, 0, 0);
+	if (regs.eax < 0x10)
+		return 1;
+
+	/* Leaf 7 EBX[15] is PQE, which enumerates leaf 0x10. */
+	query(state, &regs, 7, 0);
+	if (!(regs.ebx & (1 << 15)))
+		return 1;
+
+	query(state, &regs, 0x10, 0);
+	alloc->resources = regs.ebx & (RDT_RES_L3_CAT | RDT_RES_L2_CAT | RDT_RES_MBA);
+	if (!alloc->resources)
+		return 1;
+
+	if (alloc->resources & RDT_RES_L3_CAT)
+		probe_cat(state, 1, &alloc->l3);
+	if (alloc->resources & RDT_RES_L2_CAT)
+		probe_cat(state, 2, &alloc->l2);
+	if (alloc->resources & RDT_RES_MBA) {
+		query(state, &regs, 0x10, 3);
+		alloc->mba.max_delay = (regs.eax & 0xfff) + 1;
+		alloc->mba.linear = (regs.ecx >> 2) & 1;
+		alloc->mba.clos_count = (regs.edx & 0xffff) + 1;
+		/* Bandwidth caps go in steps of 100 minus the largest delay,
+		 * which is also the smallest cap that can be set.
+		 */
+		alloc->mba.granularity = alloc->mba.max_delay < 100 ? 100 - alloc->mba.max_delay : 1;
+	}
+
+	return 0;
+}
+
+int rdt_mon_probe(struct cpuid_state_t *state, struct rdt_mon_t *mon)
+{
+	struct cpu_regs_t regs;
+
+	memset(mon, 0, sizeof(struct rdt_mon_t));
+
+	query(state, &regs, 0, 0);
+	if (regs.eax < 0xF)
+		return 1;
+
+	/* Leaf 7 EBX[12] is PQM, which enumerates leaf 0xF. */
+	query(state, &regs, 7, 0);
+	if (!(regs.ebx & (1 << 12)))
+		return 1;
+
+	query(state, &regs, 0xF, 0);
+	mon->rmid_count = regs.ebx + 1;
+	if (!(regs.edx & 0x2))
+		return 1;
+
+	query(state, &regs, 0xF, 1);
+	mon->counter_width = 24 + (regs.eax & 0xff);
+	mon->overflow_bit = (regs.eax >> 8) & 1;
+	mon->non_cpu_occupancy = (regs.eax >> 9) & 1;
+	mon->non_cpu_mbm = (regs.eax >> 10) & 1;
+	mon->upscale = regs.ebx;
+	mon->l3_rmid_count = regs.ecx + 1;
+	mon->l3_events = regs.edx & (RDT_MON_L3_OCCUPANCY | RDT_MON_L3_TOTAL_BW | RDT_MON_L3_LOCAL_BW);
+	return 0;
+}
+
+uint64_t rdt_mbm_wrap_bytes(uint32_t counter_width, uint32_t upscale)
+{
+	uint64_t range;
+	if (counter_width >= 64)
+		return UINT64_MAX;
+	range = (uint64_t)1 << counter_width;
+	if (upscale && range > UINT64_MAX / upscale)
+		return UINT64_MAX;
+	return range * upscale;
+}
+
+static void print_wrap_json(const char *key, uint32_t width, uint32_t upscale, double peak_gbps)
+{
+	uint64_t bytes = rdt_mbm_wrap_bytes(width, upscale);
+	double wrap_ms = (double)bytes / (peak_gbps * 1e9) * 1000.0;
+
+	/* Reading at least once per wrap period is enough to undo one wrap
+	 * with modular arithmetic; half of it leaves room for scheduling
+	 * delays.
+	 */
+	printf("  \"%s\": { \"width\": %u, \"upscale_bytes\": %u, \"wrap_bytes\": %" PRIu64 ", "
+	       "\"wrap_ms\": %.3f, \"poll_interval_ms\": %.3f }",
+	       key, width, upscale, bytes, wrap_ms, wrap_ms / 2.0);
+}
+
+int rdt_print_mbm_wrap(struct cpuid_state_t *state, double peak_gbps)
+{
+	struct rdt_mon_t mon;
+	struct rdt_amd_qos_t amd;
+
+	if (rdt_mon_probe(state, &mon) != 0 ||
+	    !(mon.l3_events & (RDT_MON_L3_TOTAL_BW | RDT_MON_L3_LOCAL_BW)))
+		return 1;
+
+	printf("{\n  \"peak_gbps\": %.3f,\n", peak_gbps);
+	print_wrap_json("mbm", mon.counter_width, mon.upscale, peak_gbps);
+	printf(",\n  \"overflow_bit\": %s", mon.overflow_bit ? "true" : "false");
+
+	/* ABMC counters have a width of their own, and the same upscaling. */
+	if (rdt_amd_probe(state, &amd) == 0 && (amd.features & RDT_AMD_ABMC)) {
+		printf(",\n");
+		print_wrap_json("abmc", amd.abmc_width, mon.upscale, peak_gbps);
+	}
+	printf("\n}\n");
+	return 0;
+}
+
+static void probe_amd_bw(struct cpuid_state_t *state, uint32_t subleaf, struct rdt_amd_bw_t *bw)
+{
+	struct cpu_regs_t regs;
+	query(state, &regs, 0x80000020, subleaf);
+	bw->bw_len = regs.eax;
+	bw->clos_count = regs.edx + 1;
+}
+
+int rdt_amd_probe(struct cpuid_state_t *state, struct rdt_amd_qos_t *qos)
+{
+	struct cpu_regs_t regs;
+
+	memset(qos, 0, sizeof(struct rdt_amd_qos_t));
+
+	query(state, &regs, 0x80000000, 0);
+	if (regs.eax < 0x80000020)
+		return 1;
+
+	query(state, &regs, 0x80000020, 0);
+	qos->features = regs.ebx & (RDT_AMD_L3BE | RDT_AMD_SMBA | RDT_AMD_BMEC |
+	                            RDT_AMD_ABMC | RDT_AMD_SDCIAE);
+	if (!qos->features)
+		return 1;
+
+	if (qos->features & RDT_AMD_L3BE)
+		probe_amd_bw(state, 1, &qos->l3be);
+	if (qos->features & RDT_AMD_SMBA)
+		probe_amd_bw(state, 2, &qos->smba);
+	if (qos->features & RDT_AMD_BMEC) {
+		query(state, &regs, 0x80000020, 3);
+		qos->bmec_events = regs.ebx & 0xff;
+		qos->bmec_sources = regs.ecx;
+	}
+	if (qos->features & RDT_AMD_ABMC) {
+		query(state, &regs, 0x80000020, 5);
+		qos->abmc_width = (regs.eax & 0xff) + 24;
+		qos->abmc_overflow = (regs.eax >> 8) & 1;
+		qos->abmc_counters = (regs.ebx & 0xffff) + 1;
+		qos->abmc_select_cos = regs.ecx & 1;
+	}
+
+	return 0;
+}
+
+uint64_t rdt_amd_bw_max_mbps(const struct rdt_amd_bw_t *bw)
+{
+	if (bw->bw_len == 0 || bw->bw_len > 32)
+		return 0;
+	return (((uint64_t)1 << bw->bw_len) - 1) * 125;
+}
+
+static const char *bmec_sources[] = {
+	"local_fill",           /* L3 fills from local NUMA memory */
+	"remote_fill",          /* L3 fills from remote NUMA memory */
+	"local_nt_write",       /* non-temporal writes to local memory */
+	"remote_nt_write",      /* non-temporal writes to remote memory */
+	"local_slow_fill",      /* L3 fills from local slow memory */
+	"remote_slow_fill",     /* L3 fills from remote slow memory */
+	"dirty_victim",         /* dirty L3 victims written to any memory */
+};
+
+const char *rdt_bmec_source_name(uint32_t bit)
+{
+	return bit < NELEM(bmec_sources) ? bmec_sources[bit] : NULL;
+}
+
+/* Total L3 size in bytes, as the topology model sees it on this CPU. */
+static uint64_t l3_cache_size(struct cpuid_state_t *state)
+{
+	struct topology_cpu_t cpu;
+	const struct topology_cache_t *l3;
+
+	memset(&cpu, 0, sizeof(struct topology_cpu_t));
+	topology_probe_cpu_caches(state, &cpu);
+	l3 = topology_cache(&cpu, L3);
+	return l3 ? (uint64_t)l3->desc.size * 1024 : 0;
+}
+
+static void print_cat_json(const char *key, const struct rdt_cat_t *cat)
+{
+	printf(",\n    \"%s\": { \"cbm_len\": %u, \"shareable\": \"0x%x\", \"clos\": %u, "
+	       "\"cdp\": %s, \"noncontiguous\": %s }",
+	       key, cat->cbm_len, cat->shareable, cat->clos_count,
+	       cat->cdp ? "true" : "false", cat->noncontiguous ? "true" : "false");
+}
+
+static void print_amd_bw_json(const char *key, const struct rdt_amd_bw_t *bw)
+{
+	/* Limits count in 1/8 GB/s, i.e. 125 MB/s steps. The unlimited value is
+	 * the one just past the largest limit.
+	 */
+	printf(",\n    \"%s\": { \"bw_len\": %u, \"clos\": %u, \"unit_mbps\": 125, "
+	       "\"max_mbps\": %" PRIu64 ", \"unlimited\": %" PRIu64 " }",
+	       key, bw->bw_len, bw->clos_count,
+	       rdt_amd_bw_max_mbps(bw), rdt_amd_bw_max_mbps(bw) / 125 + 1);
+}
+
+/* Numbers the L3 domains, storing each CPU's domain in 'domain'. CPUs
+ * without an L3 all land in one domain per package.
+ */
+static uint32_t l3_domains(const struct topology_t *topo, uint32_t *domain, uint32_t *first)
+{
+	uint32_t i, k, count = 0;
+
+	for (i = 0; i < topo->count; i++) {
+		const struct topology_cpu_t *cpu = &topo->cpus[i];
+		const struct topology_cache_t *l3 = topology_cache(cpu, L3);
+		for (k = 0; k < count; k++) {
+			const struct topology_cpu_t *other = &topo->cpus[first[k]];
+			const struct topology_cache_t *other_l3 = topology_cache(other, L3);
+			if (other->package != cpu->package)
+				continue;
+			if (!l3 && !other_l3)
+				break;
+			if (l3 && other_l3 && l3->id == other_l3->id)
+				break;
+		}
+		if (k == count)
+			first[count++] = i;
+		domain[i] = k;
+	}
+	return count;
+}
+
+void rdt_print_qos_json(struct cpuid_state_t *state, const struct topology_t *topo)
+{
+	struct rdt_mon_t mon;
+	struct rdt_alloc_t alloc;
+	struct rdt_amd_qos_t amd;
+	const char *vendor;
+	int has_mon, has_alloc, has_amd;
+	uint32_t *domain, *first, *cpus;
+	uint32_t bufsize = topo->count * 12 + 1;
+	char *buffer;
+	uint32_t i, k, n, ndomains;
+
+	if (topo->count)
+		state->thread_bind(state, topo->cpus[0].cpu);
+	has_mon = rdt_mon_probe(state, &mon) == 0;
+	has_alloc = rdt_alloc_probe(state, &alloc) == 0;
+	has_amd = rdt_amd_probe(state, &amd) == 0;
+
+	/* Topology marks Hygon as AMD too. */
+	vendor = vendor_name((topo->vendor & VENDOR_HYGON) ? VENDOR_HYGON : (int)topo->vendor);
+	printf("{\n  \"vendor\": \"%s\",\n", vendor ? vendor : "unknown");
+
+	printf("  \"monitoring\": ");
+	if (has_mon) {
+		printf("{\n    \"rmids\": %u,\n    \"l3_rmids\": %u,\n    \"upscale_bytes\": %u,\n",
+		       mon.rmid_count, mon.l3_rmid_count, mon.upscale);
+		printf("    \"counter_width\": %u,\n    \"overflow_bit\": %s,\n",
+		       mon.counter_width, mon.overflow_bit ? "true" : "false");
+		printf("    \"l3_occupancy\": %s,\n    \"l3_total_bw\": %s,\n    \"l3_local_bw\": %s",
+		       (mon.l3_events & RDT_MON_L3_OCCUPANCY) ? "true" : "false",
+		       (mon.l3_events & RDT_MON_L3_TOTAL_BW) ? "true" : "false",
+		       (mon.l3_events & RDT_MON_L3_LOCAL_BW) ? "true" : "false");
+		if (has_amd && (amd.features & RDT_AMD_BMEC)) {
+			printf(",\n    \"bmec\": { \"events\": %u, \"sources\": [", amd.bmec_events);
+			for (i = 0, n = 0; i < 32; i++) {
+				const char *name = rdt_bmec_source_name(i);
+				if (!(amd.bmec_sources & (1u << i)) || !name)
+					continue;
+				printf("%s\"%s\"", n++ ? ", " : "", name);
+			}
+			printf("] }");
+		}
+		if (has_amd && (amd.features & RDT_AMD_ABMC))
+			printf(",\n    \"abmc\": { \"counters\": %u, \"width\": %u, \"overflow_bit\": %s, "
+			       "\"select_cos\": %s }",
+			       amd.abmc_counters, amd.abmc_width,
+			       amd.abmc_overflow ? "true" : "false",
+			       amd.abmc_select_cos ? "true" : "false");
+		printf("\n  },\n");
+	} else
+		printf("null,\n");
+
+	printf("  \"allocation\": ");
+	if (has_alloc || has_amd) {
+		printf("{\n    \"sdciae\": %s", (has_amd && (amd.features & RDT_AMD_SDCIAE)) ? "true" : "false");
+		if (has_alloc && (alloc.resources & RDT_RES_L3_CAT))
+			print_cat_json("l3_cat", &alloc.l3);
+		if (has_alloc && (alloc.resources & RDT_RES_L2_CAT))
+			print_cat_json("l2_cat", &alloc.l2);
+		if (has_alloc && (alloc.resources & RDT_RES_MBA))
+			printf(",\n    \"mba\": { \"max_delay\": %u, \"granularity\": %u, \"linear\": %s, \"clos\": %u }",
+			       alloc.mba.max_delay, alloc.mba.granularity,
+			       alloc.mba.linear ? "true" : "false", alloc.mba.clos_count);
+		if (has_amd && (amd.features & RDT_AMD_L3BE))
+			print_amd_bw_json("l3be", &amd.l3be);
+		if (has_amd && (amd.features & RDT_AMD_SMBA))
+			print_amd_bw_json("smba", &amd.smba);
+		printf("\n  },\n");
+	} else
+		printf("null,\n");
+
+	domain = (uint32_t *)calloc(topo->count + 1, sizeof(uint32_t));
+	first = (uint32_t *)calloc(topo->count + 1, sizeof(uint32_t));
+	cpus = (uint32_t *)calloc(topo->count + 1, sizeof(uint32_t));
+	buffer = (char *)malloc(bufsize);
+	assert(domain && first && cpus && buffer);
+
+	ndomains = l3_domains(topo, domain, first);
+	printf("  \"domains\": [");
+	for (k = 0; k < ndomains; k++) {
+		const struct topology_cpu_t *cpu = &topo->cpus[first[k]];
+		const struct topology_cache_t *l3 = topology_cache(cpu, L3);
+		for (i = 0, n = 0; i < topo->count; i++)
+			if (domain[i] == k)
+				cpus[n++] = topo->cpus[i].cpu;
+		printf("%s\n    { \"index\": %u, \"package\": %u, \"l3_id\": %u, \"l3_kb\": %u, "
+		       "\"cpuset\": \"%s\", \"cpus\": [",
+		       k ? "," : "", k, cpu->package, l3 ? l3->id : 0, l3 ? l3->desc.size : 0,
+		       topology_format_cpus(cpus, n, buffer, bufsize));
+		for (i = 0; i < n; i++)
+			printf("%s%u", i ? ", " : "", cpus[i]);
+		printf("] }");
+	}
+	printf("\n  ]\n}\n");
+
+	free(buffer);
+	free(cpus);
+	free(first);
+	free(domain);
+}
+
+uint32_t rdt_parse_shares(const char *spec, uint32_t *shares, uint32_t max)
+{
+	uint32_t count = 0;
+	const char *p = spec;
+
+	while (*p) {
+		char *end;
+		unsigned long value = strtoul(p, &end, 10);
+		if (end == p || value == 0 || value > 0xffff || count == max)
+			return 0;
+		shares[count++] = (uint32_t)value;
+		if (*end == ',')
+			end++;
+		else if (*end)
+			return 0;
+		p = end;
+	}
+	return count;
+}
+
+/* How far a tenant's bits fall short of its exact share, scaled by the total
+ * weight. Negative once the tenant has more than its share.
+ */
+static int64_t bits_remainder(const struct rdt_tenant_t *tenant, uint32_t total_bits, uint64_t weight)
+{
+	return (int64_t)(tenant->share * (uint64_t)total_bits) - (int64_t)(tenant->bits * weight);
+}
+
+/* Largest remainder split of 'total_bits' by weight, with a floor of one
+ * bit for everyone.
+ */
+static void split_bits(struct rdt_tenant_t *tenants, uint32_t count, uint32_t total_bits)
+{
+	uint64_t weight = 0;
+	uint32_t i, assigned = 0;
+
+	for (i = 0; i < count; i++)
+		weight += tenants[i].share;
+
+	for (i = 0; i < count; i++) {
+		tenants[i].bits = (uint32_t)(tenants[i].share * (uint64_t)total_bits / weight);
+		if (!tenants[i].bits)
+			tenants[i].bits = 1;
+		assigned += tenants[i].bits;
+	}
+
+	while (assigned < total_bits) {
+		uint32_t best = 0;
+		int64_t best_rem = bits_remainder(&tenants[0], total_bits, weight);
+		for (i = 1; i < count; i++) {
+			int64_t rem = bits_remainder(&tenants[i], total_bits, weight);
+			if (rem > best_rem) {
+				best_rem = rem;
+				best = i;
+			}
+		}
+		tenants[best].bits++;
+		assigned++;
+	}
+
+	/* Only reachable when the one bit floor pushed us over. */
+	while (assigned > total_bits) {
+		uint32_t best = 0;
+		for (i = 1; i < count; i++)
+			if (tenants[i].bits > tenants[best].bits)
+				best = i;
+		tenants[best].bits--;
+		assigned--;
+	}
+}
+
+rdt_plan_error_t rdt_plan(struct cpuid_state_t *state, const uint32_t *shares, uint32_t count,
+                          struct rdt_plan_t *plan)
+{
+	const struct rdt_cat_t *l3;
+	uint32_t i, shift, weight = 0;
+
+	memset(plan, 0, sizeof(struct rdt_plan_t));
+	if (!count || count > RDT_MAX_TENANTS)
+		return RDT_PLAN_NO_TENANTS;
+
+	rdt_alloc_probe(state, &plan->alloc);
+	if (!(plan->alloc.resources & RDT_RES_L3_CAT))
+		return RDT_PLAN_NO_CAT;
+
+	l3 = &plan->alloc.l3;
+	if (count >= l3->clos_count)
+		return RDT_PLAN_TOO_MANY_CLOS;
+	if ((plan->alloc.resources & RDT_RES_MBA) && count >= plan->alloc.mba.clos_count)
+		return RDT_PLAN_TOO_MANY_CLOS;
+	if (count > l3->cbm_len)
+		return RDT_PLAN_TOO_MANY_BITS;
+
+	plan->l3_size = l3_cache_size(state);
+	plan->count = count;
+	for (i = 0; i < count; i++) {
+		plan->tenants[i].share = shares[i];
+		plan->tenants[i].clos = i + 1;
+		weight += shares[i];
+	}
+
+	split_bits(plan->tenants, count, l3->cbm_len);
+
+	/* Hand out ranges from bit 0 up. The shareable bits are normally at the
+	 * top of the mask, so the last tenants are the ones that end up
+	 * competing with I/O for them.
+	 */
+	shift = 0;
+	for (i = 0; i < count; i++) {
+		struct rdt_tenant_t *tenant = &plan->tenants[i];
+		uint64_t mask = ((1ULL << tenant->bits) - 1) << shift;
+		tenant->cbm = (uint32_t)mask;
+		tenant->bytes = plan->l3_size * tenant->bits / l3->cbm_len;
+		shift += tenant->bits;
+
+		if (plan->alloc.resources & RDT_RES_MBA) {
+			uint32_t gran = plan->alloc.mba.granularity;
+			uint32_t pct = (uint32_t)((tenant->share * 100ULL + weight - 1) / weight);
+			pct = (pct + gran - 1) / gran * gran;
+			if (pct < gran)
+				pct = gran;
+			if (pct > 100)
+				pct = 100;
+			tenant->mba = pct;
+		}
+	}
+
+	return RDT_PLAN_OK;
+}
+
+const char *rdt_plan_error_name(rdt_plan_error_t error)
+{
+	switch (error) {
+	case RDT_PLAN_OK:
+		return "no error";
+	case RDT_PLAN_NO_CAT:
+		return "L3 cache allocation is not supported";
+	case RDT_PLAN_NO_TENANTS:
+		return "no tenants given, or too many";
+	case RDT_PLAN_TOO_MANY_CLOS:
+		return "more tenants than free classes of service";
+	case RDT_PLAN_TOO_MANY_BITS:
+		return "more tenants than capacity bitmask bits";
+	}
+	return "unknown error";
+}
+
+void rdt_plan_print(const struct rdt_plan_t *plan)
+{
+	const struct rdt_cat_t *l3 = &plan->alloc.l3;
+	uint32_t i;
+
+	printf("L3 CAT: %u-bit capacity bitmask, %u classes of service\n",
+	       l3->cbm_len, l3->clos_count);
+	if (plan->l3_size)
+		printf("L3 size: %" PRIu64 " KB, %" PRIu64 " KB per bit\n",
+		       plan->l3_size / 1024, plan->l3_size / l3->cbm_len / 1024);
+	if (l3->shareable)
+		printf("Shareable bits: 0x%x (also filled by non-CPU agents)\n", l3->shareable);
+	printf("\n");
+
+	printf("CLOS  Share  CBM         Bits  Size (KB)  MBA\n");
+	for (i = 0; i < plan->count; i++) {
+		const struct rdt_tenant_t *tenant = &plan->tenants[i];
+		char mba[16];
+		if (tenant->mba)
+			sprintf(mba, "%u%%", tenant->mba);
+		else
+			strcpy(mba, "-");
+		printf("%-5u %-6u 0x%08x  %-5u %-10" PRIu64 " %s%s\n",
+		       tenant->clos, tenant->share, tenant->cbm, tenant->bits,
+		       tenant->bytes / 1024, mba,
+		       (tenant->cbm & l3->shareable) ? "  (overlaps shareable bits)" : "");
+	}
+}
+
+/* vim: set ts=4 sts=4 sw=4 noet: */
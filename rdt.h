@@ -0,0 +1,186 @@
+/*
+ * CPUID
+ *
+ * A simple and small tool to dump/decode CPUID information.
+ *
+ * Copyright (c) 2010-2025, Steven Noonan <steven@uplinklabs.net>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef __rdt_h
+#define __rdt_h
+
+struct cpuid_state_t;
+
+/* Resource IDs in leaf 0x10 subleaf 0 EBX. Each one also names the subleaf
+ * describing that resource.
+ */
+#define RDT_RES_L3_CAT 0x2
+#define RDT_RES_L2_CAT 0x4
+#define RDT_RES_MBA    0x8
+
+/* Cache allocation, from leaf 0x10 subleaf 1 (L3) or 2 (L2). */
+struct rdt_cat_t {
+	uint32_t cbm_len;       /* bits in a capacity bitmask */
+	uint32_t shareable;     /* bits other agents (e.g. I/O) may also fill */
+	uint32_t clos_count;    /* classes of service, including CLOS 0 */
+	unsigned int cdp:1;           /* code/data prioritization */
+	unsigned int non_cpu:1;       /* allocation for non-CPU agents */
+	unsigned int noncontiguous:1; /* bitmasks may have holes */
+};
+
+/* Memory bandwidth allocation, from leaf 0x10 subleaf 3. */
+struct rdt_mba_t {
+	uint32_t max_delay;     /* highest throttling value, in percent */
+	uint32_t granularity;   /* step size and minimum of a bandwidth cap, in percent */
+	uint32_t clos_count;
+	unsigned int linear:1;  /* throttling values are a linear scale */
+};
+
+struct rdt_alloc_t {
+	uint32_t resources;     /* RDT_RES_* */
+	struct rdt_cat_t l3;
+	struct rdt_cat_t l2;
+	struct rdt_mba_t mba;
+};
+
+/* Reads leaf 0x10 on the current CPU. Returns nonzero if the processor has no
+ * allocation support at all.
+ */
+int rdt_alloc_probe(struct cpuid_state_t *state, struct rdt_alloc_t *alloc);
+
+/* Event bits in leaf 0xF subleaf 1 EDX. */
+#define RDT_MON_L3_OCCUPANCY 0x1
+#define RDT_MON_L3_TOTAL_BW  0x2
+#define RDT_MON_L3_LOCAL_BW  0x4
+
+/* L3 monitoring, from leaf 0xF. */
+struct rdt_mon_t {
+	uint32_t rmid_count;    /* subleaf 0 EBX + 1, across all resources */
+	uint32_t l3_rmid_count; /* subleaf 1 ECX + 1 */
+	uint32_t l3_events;     /* RDT_MON_* */
+	uint32_t upscale;       /* bytes per counter unit */
+	uint32_t counter_width; /* bits in IA32_QM_CTR, 24 plus subleaf 1 EAX[7:0] */
+	unsigned int overflow_bit:1;  /* IA32_QM_CTR bit 61 flags a wrap */
+	unsigned int non_cpu_occupancy:1;
+	unsigned int non_cpu_mbm:1;
+};
+
+/* Reads leaf 0xF on the current CPU. Returns nonzero if there is no L3
+ * monitoring.
+ */
+int rdt_mon_probe(struct cpuid_state_t *state, struct rdt_mon_t *mon);
+
+/* Bytes of traffic an MBM counter can count before wrapping around. */
+uint64_t rdt_mbm_wrap_bytes(uint32_t counter_width, uint32_t upscale);
+
+/* Prints, as JSON, how long the MBM counters take to wrap when one RMID
+ * moves 'peak_gbps' GB/s, and the polling interval that keeps a sampler
+ * from missing a wrap.
+ */
+int rdt_print_mbm_wrap(struct cpuid_state_t *state, double peak_gbps);
+
+/* Feature bits in leaf 0x80000020 subleaf 0 EBX. Like leaf 0x10, the first
+ * four also name the subleaf describing them.
+ */
+#define RDT_AMD_L3BE   0x02    /* L3 external bandwidth enforcement */
+#define RDT_AMD_SMBA   0x04    /* slow memory bandwidth enforcement */
+#define RDT_AMD_BMEC   0x08    /* bandwidth monitoring event configuration */
+#define RDT_AMD_ABMC   0x20    /* assignable bandwidth monitoring counters */
+#define RDT_AMD_SDCIAE 0x40    /* L3 smart data cache injection allocation enforcement */
+
+/* Bandwidth limits are programmed per CLOS and per L3 domain (CCX), in
+ * units of 1/8 GB/s. A value of 1 << bw_len means no limit.
+ */
+struct rdt_amd_bw_t {
+	uint32_t bw_len;        /* width of the limit field in bits */
+	uint32_t clos_count;
+};
+
+struct rdt_amd_qos_t {
+	uint32_t features;      /* RDT_AMD_* */
+	struct rdt_amd_bw_t l3be;
+	struct rdt_amd_bw_t smba;
+	uint32_t bmec_events;   /* number of configurable events */
+	uint32_t bmec_sources;  /* bitmask of countable traffic types */
+	uint32_t abmc_counters;
+	uint32_t abmc_width;    /* counter width in bits */
+	unsigned int abmc_overflow:1;
+	unsigned int abmc_select_cos:1; /* counters can track a CLOS, not an RMID */
+};
+
+/* Reads leaf 0x80000020 on the current CPU. Returns nonzero on processors
+ * without it.
+ */
+int rdt_amd_probe(struct cpuid_state_t *state, struct rdt_amd_qos_t *qos);
+
+/* Highest limit that can be programmed short of "unlimited", in MB/s. */
+uint64_t rdt_amd_bw_max_mbps(const struct rdt_amd_bw_t *bw);
+
+/* Name of bit 'bit' of the BMEC event source mask, or NULL. */
+const char *rdt_bmec_source_name(uint32_t bit);
+
+struct topology_t;
+
+/* Prints the monitoring and allocation capabilities as JSON, along with the
+ * L3 domains (CCXs on AMD) they apply to. RMIDs, CLOSes and bandwidth limits
+ * are all per domain.
+ */
+void rdt_print_qos_json(struct cpuid_state_t *state, const struct topology_t *topo);
+
+#define RDT_MAX_TENANTS 32
+
+typedef enum {
+	RDT_PLAN_OK = 0,
+	RDT_PLAN_NO_CAT,
+	RDT_PLAN_NO_TENANTS,
+	RDT_PLAN_TOO_MANY_CLOS,
+	RDT_PLAN_TOO_MANY_BITS
+} rdt_plan_error_t;
+
+struct rdt_tenant_t {
+	uint32_t share;         /* relative weight given on input */
+	uint32_t clos;
+	uint32_t cbm;
+	uint32_t bits;
+	uint64_t bytes;
+	uint32_t mba;           /* bandwidth cap in percent, 0 without MBA */
+};
+
+struct rdt_plan_t {
+	struct rdt_alloc_t alloc;
+	uint64_t l3_size;       /* bytes, from leaf 4 (or 0x8000001D) */
+	uint32_t count;
+	struct rdt_tenant_t tenants[RDT_MAX_TENANTS];
+};
+
+/* Parses a comma separated list of weights such as "50,25,25". Returns the
+ * number of weights stored, or 0 if the list is malformed.
+ */
+uint32_t rdt_parse_shares(const char *spec, uint32_t *shares, uint32_t max);
+
+/* Splits the L3 capacity bitmask into one contiguous range per tenant, in
+ * proportion to the given weights. Every tenant gets at least one bit and
+ * its own CLOS, starting at CLOS 1; CLOS 0 stays the default for everything
+ * else.
+ */
+rdt_plan_error_t rdt_plan(struct cpuid_state_t *state, const uint32_t *shares, uint32_t count,
+                          struct rdt_plan_t *plan);
+const char *rdt_plan_error_name(rdt_plan_error_t error);
+void rdt_plan_print(const struct rdt_plan_t *plan);
+
+#endif
+
+/* vim: set ts=4 sts=4 sw=4 noet: */
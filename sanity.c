@@ -35,6 +35,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "bench.h"
 #include "clock.h"
 #include "sanity.h"
 #include "state.h"
@@ -100,7 +101,10 @@ static void *apic_nonsensical_worker_thread(void *flagptr)
 #endif
 
 struct apic_validate_t {
-	struct cpuid_state_t *state;
+	/* Each validation thread drives its own state, so that no two threads
+	 * ever touch the same cpuid_state_t.
+	 */
+	struct cpuid_state_t state;
 	uint32_t index;
 	uint8_t *worker_flag;
 	uint8_t expected;
@@ -114,7 +118,7 @@ static DWORD WINAPI apic_validation_thread(LPVOID ptr)
 	SetThreadAffinityMask(GetCurrentThread(), 1ULL << meta->index);
 	while (!meta->failed && *meta->worker_flag) {
 		Sleep(5);
-		if (get_apicid(meta->state) != meta->expected) {
+		if (get_apicid(&meta->state) != meta->expected) {
 			meta->failed = 1;
 		}
 	}
@@ -124,10 +128,10 @@ static DWORD WINAPI apic_validation_thread(LPVOID ptr)
 static void *apic_validation_thread(void *ptr)
 {
 	struct apic_validate_t *meta = (struct apic_validate_t *)ptr;
-	thread_bind_native(NULL, meta->index);
+	thread_bind_native(&meta->state, meta->index);
 	while (!meta->failed && *meta->worker_flag) {
 		usleep(5000);
-		if (get_apicid(meta->state) != meta->expected) {
+		if (get_apicid(&meta->state) != meta->expected) {
 			meta->failed = 1;
 		}
 	}
@@ -150,7 +154,7 @@ typedef pthread_t thread_handle_t;
 static int sane_apicid(struct cpuid_state_t *state)
 {
 	int ret = 0;
-	uint32_t hwthreads = thread_count_native(NULL), i,
+	uint32_t hwthreads = state->thread_count(state), i,
 	         worker_count;
 	uint8_t *apic_ids = NULL, *apic_copy = NULL, worker_flag;
 	struct apic_validate_t *apic_state = NULL;
@@ -198,7 +202,8 @@ static int sane_apicid(struct cpuid_state_t *state)
 	apic_workers = (thread_handle_t *)malloc(hwthreads * sizeof(thread_handle_t));
 	memset(apic_state, 0, hwthreads * sizeof(struct apic_validate_t));
 	for (i = 0; i < hwthreads; i++) {
-		apic_state[i].state = state;
+		INIT_CPUID_STATE(&apic_state[i].state);
+		apic_state[i].state.cpuid_call = state->cpuid_call;
 		apic_state[i].index = i;
 		apic_state[i].expected = apic_ids[i];
 		apic_state[i].worker_flag = &worker_flag;
@@ -265,6 +270,10 @@ static int sane_apicid(struct cpuid_state_t *state)
 	
 	free(apic_ids);
 	free(apic_copy);
+	if (apic_state) {
+		for (i = 0; i < hwthreads; i++)
+			FREE_CPUID_STATE(&apic_state[i].state);
+	}
 	free(apic_state);
 
 	return ret;
@@ -307,34 +316,15 @@ static int sane_l3_sharing(struct cpuid_state_t *state)
 	return 0;
 }
 
-static int measure_leaf(struct cpuid_state_t *state, uint32_t eax, uint32_t ecx)
+static void measure_leaf(struct cpuid_state_t *state, const struct cpu_timer_t *timer,
+                         uint32_t eax, uint32_t ecx)
 {
-	uint64_t s, e, d, best;
-	uint32_t i, iters = 25;
-	uint32_t t, trials = 1000;
-	struct cpu_regs_t regs;
+	struct bench_stats_t stats;
 
 	printf("Leaf 0x%08x:%02x  ", eax, ecx);
-	best = UINT32_MAX;
-	for (t = 0; t < trials; t++) {
-		s = get_cpu_clock();
-		for (i = 0; i < iters; i++) {
-			ZERO_REGS(&regs);
-			regs.eax = eax;
-			regs.ecx = ecx;
-			state->cpuid_call(&regs, state);
-		}
-		e = get_cpu_clock();
-		d = e - s;
-		if (d < best)
-			best = d;
-		if (t % 3 == 0)
-			sched_yield();
-	}
-
-	printf("cost per read: %6" PRIu64 " ns (%6" PRIu64 " cycles)\n",
-	       cpu_clock_to_wall(best) / iters, (best) / iters);
-	return 0;
+	bench_measure(state, timer, eax, ecx, 1000, &stats);
+	printf("cost per read: %6" PRIu64 " ns (%6" PRIu64 " %s)\n",
+	       timer_to_ns(timer, stats.min), stats.min, timer_unit(timer));
 }
 
 static int sane_performance(struct cpuid_state_t *state)
@@ -348,15 +338,28 @@ static int sane_performance(struct cpuid_state_t *state)
 		{ 0x80000000, 0x1a }
 	};
 	uint32_t leaf_count = sizeof(leaves) / sizeof(leaves[0]);
+	struct cpu_timer_t timer;
 	uint32_t i, j;
+
+	init_cpu_clock(state);
+	printf("TSC frequency: %" PRIu64 " kHz (from %s)\n",
+	       cpu_clock_khz(), cpu_clock_source());
+	printf("\n");
+
+	/* Opening the timer calibrates its overhead, so do it once for all leaves. */
+	if (timer_open(&timer, TIMER_DEFAULT, state) != 0) {
+		printf("Unable to open a timer.\n");
+		return 1;
+	}
 	for (i = 0; i < leaf_count; i++)
 	{
 		for (j = 0; j <= leaves[i].max; j++)
 		{
-			measure_leaf(state, leaves[i].eax + j, 0);
+			measure_leaf(state, &timer, leaves[i].eax + j, 0);
 		}
 		printf("\n");
 	}
+	timer_close(&timer);
 	return 0;
 }
 
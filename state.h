@@ -42,6 +42,27 @@ struct cpuid_leaf_t {
 	struct cpu_regs_t output;
 };
 
+/* Per-instance context for the cpuid_call and thread_count backends. These
+ * live inside struct cpuid_state_t rather than as statics in the backends so
+ * that independent states can be driven from separate threads.
+ */
+struct cpuid_native_ctx_t {
+	/* Whether the CPUID instruction was probed for (32-bit x86 only). */
+	unsigned probed:1;
+	unsigned supported:1;
+};
+
+struct cpuid_kernel_ctx_t {
+	/* Open handle on /dev/cpu/<cpu>/cpuid, or -1. */
+	int fd;
+	uint32_t cpu;
+};
+
+struct thread_native_ctx_t {
+	/* Cached result of thread_count_native(), or 0 if not yet counted. */
+	uint32_t count;
+};
+
 struct cpuid_state_t
 {
 	thread_init_handler_t thread_init;
@@ -56,6 +77,10 @@ struct cpuid_state_t
 
 	uint32_t logical_in_socket;
 
+	struct cpuid_native_ctx_t native;
+	struct cpuid_kernel_ctx_t kernel;
+	struct thread_native_ctx_t threads;
+
 	struct cpuid_leaf_t **cpuid_leaves;
 	struct cpu_regs_t last_leaf;
 	union {
@@ -81,9 +106,11 @@ struct cpuid_state_t
 	(x)->thread_init = thread_init_native; \
 	(x)->thread_bind = thread_bind_native; \
 	(x)->thread_count = thread_count_native; \
+	(x)->kernel.fd = -1; \
 	}
 
 #define FREE_CPUID_STATE(x) { \
+		cpuid_release(x); \
 		if ((x)->cpuid_leaves) { \
 			uint32_t i; \
 			for (i = 0; i < (x)->cpu_logical_count; i++) { \
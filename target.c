@@ -0,0 +1,311 @@
+/*
+ * CPUID
+ *
+ * A simple and small tool to dump/decode CPUID information.
+ *
+ * Copyright (c) 2010-2025, Steven Noonan <steven@uplinklabs.net>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "prefix.h"
+
+#include "feature.h"
+#include "handlers.h"
+#include "hints.h"
+#include "isa.h"
+#include "state.h"
+#include "target.h"
+#include "util.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+struct tune_model_t {
+	uint16_t vendor;
+	uint16_t family;
+	uint16_t model_lo;
+	uint16_t model_hi;
+	const char *name;
+};
+
+/* Display family and model (including the extended fields) to GCC/Clang
+ * -mtune names. The first match wins, so narrower ranges come first.
+ */
+static const struct tune_model_t tune_models[] = {
+	{ VENDOR_INTEL, 0x06, 0x0f, 0x0f, "core2" },
+	{ VENDOR_INTEL, 0x06, 0x16, 0x17, "core2" },
+	{ VENDOR_INTEL, 0x06, 0x1d, 0x1d, "core2" },
+	{ VENDOR_INTEL, 0x06, 0x1a, 0x1a, "nehalem" },
+	{ VENDOR_INTEL, 0x06, 0x1e, 0x1f, "nehalem" },
+	{ VENDOR_INTEL, 0x06, 0x2e, 0x2e, "nehalem" },
+	{ VENDOR_INTEL, 0x06, 0x25, 0x25, "westmere" },
+	{ VENDOR_INTEL, 0x06, 0x2c, 0x2c, "westmere" },
+	{ VENDOR_INTEL, 0x06, 0x2f, 0x2f, "westmere" },
+	{ VENDOR_INTEL, 0x06, 0x2a, 0x2a, "sandybridge" },
+	{ VENDOR_INTEL, 0x06, 0x2d, 0x2d, "sandybridge" },
+	{ VENDOR_INTEL, 0x06, 0x3a, 0x3a, "ivybridge" },
+	{ VENDOR_INTEL, 0x06, 0x3e, 0x3e, "ivybridge" },
+	{ VENDOR_INTEL, 0x06, 0x3c, 0x3c, "haswell" },
+	{ VENDOR_INTEL, 0x06, 0x3f, 0x3f, "haswell" },
+	{ VENDOR_INTEL, 0x06, 0x45, 0x46, "haswell" },
+	{ VENDOR_INTEL, 0x06, 0x3d, 0x3d, "broadwell" },
+	{ VENDOR_INTEL, 0x06, 0x47, 0x47, "broadwell" },
+	{ VENDOR_INTEL, 0x06, 0x4f, 0x4f, "broadwell" },
+	{ VENDOR_INTEL, 0x06, 0x56, 0x56, "broadwell" },
+	{ VENDOR_INTEL, 0x06, 0x4e, 0x4e, "skylake" },
+	{ VENDOR_INTEL, 0x06, 0x5e, 0x5e, "skylake" },
+	{ VENDOR_INTEL, 0x06, 0x8e, 0x8e, "skylake" },
+	{ VENDOR_INTEL, 0x06, 0x9e, 0x9e, "skylake" },
+	{ VENDOR_INTEL, 0x06, 0xa5, 0xa6, "skylake" },
+	{ VENDOR_INTEL, 0x06, 0x55, 0x55, "skylake-avx512" },
+	{ VENDOR_INTEL, 0x06, 0x66, 0x66, "cannonlake" },
+	{ VENDOR_INTEL, 0x06, 0x7d, 0x7e, "icelake-client" },
+	{ VENDOR_INTEL, 0x06, 0x6a, 0x6a, "icelake-server" },
+	{ VENDOR_INTEL, 0x06, 0x6c, 0x6c, "icelake-server" },
+	{ VENDOR_INTEL, 0x06, 0x8c, 0x8d, "tigerlake" },
+	{ VENDOR_INTEL, 0x06, 0xa7, 0xa7, "rocketlake" },
+	{ VENDOR_INTEL, 0x06, 0x97, 0x97, "alderlake" },
+	{ VENDOR_INTEL, 0x06, 0x9a, 0x9a, "alderlake" },
+	{ VENDOR_INTEL, 0x06, 0xbe, 0xbf, "alderlake" },
+	{ VENDOR_INTEL, 0x06, 0xb7, 0xb7, "raptorlake" },
+	{ VENDOR_INTEL, 0x06, 0xba, 0xba, "raptorlake" },
+	{ VENDOR_INTEL, 0x06, 0xaa, 0xaa, "meteorlake" },
+	{ VENDOR_INTEL, 0x06, 0xac, 0xac, "meteorlake" },
+	{ VENDOR_INTEL, 0x06, 0xb5, 0xb5, "arrowlake" },
+	{ VENDOR_INTEL, 0x06, 0xc5, 0xc6, "arrowlake" },
+	{ VENDOR_INTEL, 0x06, 0xbd, 0xbd, "lunarlake" },
+	{ VENDOR_INTEL, 0x06, 0x8f, 0x8f, "sapphirerapids" },
+	{ VENDOR_INTEL, 0x06, 0xcf, 0xcf, "emeraldrapids" },
+	{ VENDOR_INTEL, 0x06, 0xad, 0xae, "graniterapids" },
+	{ VENDOR_INTEL, 0x06, 0xaf, 0xaf, "sierraforest" },
+	{ VENDOR_INTEL, 0x06, 0xb6, 0xb6, "grandridge" },
+	{ VENDOR_INTEL, 0x06, 0x1c, 0x1c, "bonnell" },
+	{ VENDOR_INTEL, 0x06, 0x26, 0x27, "bonnell" },
+	{ VENDOR_INTEL, 0x06, 0x35, 0x36, "bonnell" },
+	{ VENDOR_INTEL, 0x06, 0x37, 0x37, "silvermont" },
+	{ VENDOR_INTEL, 0x06, 0x4a, 0x4a, "silvermont" },
+	{ VENDOR_INTEL, 0x06, 0x4c, 0x4d, "silvermont" },
+	{ VENDOR_INTEL, 0x06, 0x5a, 0x5a, "silvermont" },
+	{ VENDOR_INTEL, 0x06, 0x5d, 0x5d, "silvermont" },
+	{ VENDOR_INTEL, 0x06, 0x5c, 0x5c, "goldmont" },
+	{ VENDOR_INTEL, 0x06, 0x5f, 0x5f, "goldmont" },
+	{ VENDOR_INTEL, 0x06, 0x7a, 0x7a, "goldmont-plus" },
+	{ VENDOR_INTEL, 0x06, 0x86, 0x86, "tremont" },
+	{ VENDOR_INTEL, 0x06, 0x96, 0x96, "tremont" },
+	{ VENDOR_INTEL, 0x06, 0x9c, 0x9c, "tremont" },
+	{ VENDOR_INTEL, 0x06, 0x57, 0x57, "knl" },
+	{ VENDOR_INTEL, 0x06, 0x85, 0x85, "knm" },
+	{ VENDOR_INTEL, 0x0f, 0x00, 0xff, "nocona" },
+
+	{ VENDOR_AMD,   0x10, 0x00, 0xff, "amdfam10" },
+	{ VENDOR_AMD,   0x14, 0x00, 0xff, "btver1" },
+	{ VENDOR_AMD,   0x15, 0x00, 0x01, "bdver1" },
+	{ VENDOR_AMD,   0x15, 0x02, 0x1f, "bdver2" },
+	{ VENDOR_AMD,   0x15, 0x30, 0x3f, "bdver3" },
+	{ VENDOR_AMD,   0x15, 0x60, 0x7f, "bdver4" },
+	{ VENDOR_AMD,   0x16, 0x00, 0x2f, "btver1" },
+	{ VENDOR_AMD,   0x16, 0x30, 0xff, "btver2" },
+	{ VENDOR_AMD,   0x17, 0x00, 0x2f, "znver1" },
+	{ VENDOR_AMD,   0x17, 0x30, 0xff, "znver2" },
+	{ VENDOR_AMD,   0x18, 0x00, 0xff, "znver1" },  /* Hygon Dhyana */
+	{ VENDOR_AMD,   0x19, 0x10, 0x1f, "znver4" },
+	{ VENDOR_AMD,   0x19, 0x60, 0x7f, "znver4" },
+	{ VENDOR_AMD,   0x19, 0xa0, 0xaf, "znver4" },
+	{ VENDOR_AMD,   0x19, 0x00, 0xff, "znver3" },
+	{ VENDOR_AMD,   0x1a, 0x00, 0xff, "znver5" },
+	{ 0, 0, 0, 0, NULL }
+};
+
+const char *target_tune_name(struct cpuid_state_t *state)
+{
+	const struct tune_model_t *t;
+	struct cpu_regs_t regs;
+	struct cpu_signature_t sig;
+	char buf[13];
+	uint32_t vendor, family, model;
+
+	ZERO_REGS(&regs);
+	state->cpuid_call(&regs, state);
+	if (regs.eax < 1)
+		return "generic";
+	memcpy(&buf[0], &regs.ebx, 4);
+	memcpy(&buf[4], &regs.edx, 4);
+	memcpy(&buf[8], &regs.ecx, 4);
+	buf[12] = 0;
+	vendor = vendor_id(buf);
+	if (vendor == VENDOR_HYGON)
+		vendor = VENDOR_AMD;
+
+	ZERO_REGS(&regs);
+	regs.eax = 1;
+	state->cpuid_call(&regs, state);
+	memcpy(&sig, &regs.eax, sizeof(sig));
+
+	/* Same derivation as handle_features(). */
+	family = sig.family + sig.extfamily;
+	model = sig.model;
+	if (sig.family == 0xf || (sig.family == 0x6 && (vendor & VENDOR_INTEL)))
+		model += sig.extmodel << 4;
+
+	for (t = tune_models; t->name; t++) {
+		if ((vendor & t->vendor) && family == t->family &&
+		    model >= t->model_lo && model <= t->model_hi)
+			return t->name;
+	}
+	return "generic";
+}
+
+#define MAX_FLAGS 128
+
+/* Extensions whose registers live in XSAVE state, by flag prefix, and the
+ * XCR0 components the OS has to enable before they can run. The first
+ * matching prefix wins.
+ */
+static const struct {
+	const char *prefix;
+	uint64_t xcr0;
+} state_flags[] = {
+	{ "avx512",     0xe6 },
+	{ "avx",        0x6 },
+	{ "fma",        0x6 },      /* fma and fma4 */
+	{ "f16c",       0x6 },
+	{ "xop",        0x6 },
+	{ "vaes",       0x6 },
+	{ "vpclmulqdq", 0x6 },
+	{ "sha512",     0x6 },
+	{ "sm3",        0x6 },
+	{ "sm4",        0x6 },
+	{ "amx",        0x60000 },
+	{ "apx",        0x80000 },
+	{ NULL, 0 }
+};
+
+static uint64_t flag_xcr0(const char *flag)
+{
+	uint32_t i;
+	for (i = 0; state_flags[i].prefix; i++) {
+		if (!strncmp(flag, state_flags[i].prefix, strlen(state_flags[i].prefix)))
+			return state_flags[i].xcr0;
+	}
+	return 0;
+}
+
+/* The flags the processor reports and the OS lets run. An extension whose
+ * state XCR0 leaves off faults on first use, so it's marked absent.
+ */
+static uint32_t present_flags(struct cpuid_state_t *state, struct feature_flag_t *flags)
+{
+	uint32_t i, count = feature_flags(state, flags, MAX_FLAGS);
+	uint64_t xcr0;
+
+	if (count > MAX_FLAGS) {
+		fprintf(stderr, "warning: only the first %u of %u compiler flags were checked.\n",
+		        MAX_FLAGS, count);
+		count = MAX_FLAGS;
+	}
+
+	isa_read_xcr0(state, &xcr0);
+	for (i = 0; i < count; i++) {
+		uint64_t needed = flag_xcr0(flags[i].flag);
+		if ((xcr0 & needed) != needed)
+			flags[i].present = 0;
+	}
+	return count;
+}
+
+static void format_flags(struct cpuid_state_t *state, const struct feature_flag_t *flags,
+                         uint32_t count, char *buffer, size_t bufsize)
+{
+	x86_64_level_t level = x86_64_level(state);
+	char flag[64];
+	uint32_t i;
+
+	/* The psABI level sets the baseline, so the flags still make sense to
+	 * a compiler that doesn't know some of the -m options below.
+	 */
+	snprintf(buffer, bufsize, "-march=%s -mtune=%s",
+	         level == X86_64_NONE ? "i686" : x86_64_level_name(level),
+	         target_tune_name(state));
+	for (i = 0; i < count; i++) {
+		if (!flags[i].present)
+			continue;
+		snprintf(flag, sizeof(flag), " -m%s", flags[i].flag);
+		safe_strcat(buffer, flag, bufsize);
+	}
+}
+
+void target_print_flags(struct cpuid_state_t *state)
+{
+	struct feature_flag_t flags[MAX_FLAGS];
+	char buffer[4096];
+	uint32_t count = present_flags(state, flags);
+
+	format_flags(state, flags, count, buffer, sizeof(buffer));
+	printf("%s\n", buffer);
+}
+
+/* "sse4.1" -> "SSE4_1", "amx-bf16" -> "AMX_BF16", or lowercase for C++. */
+static const char *identifier(const char *flag, int upper, char *buffer, size_t bufsize)
+{
+	size_t i;
+	for (i = 0; flag[i] && i < bufsize - 1; i++) {
+		if (flag[i] == '.' || flag[i] == '-')
+			buffer[i] = '_';
+		else
+			buffer[i] = upper ? (char)toupper((unsigned char)flag[i]) : flag[i];
+	}
+	buffer[i] = 0;
+	return buffer;
+}
+
+void target_print_header(struct cpuid_state_t *state, const struct tuning_hints_t *hints)
+{
+	struct feature_flag_t flags[MAX_FLAGS];
+	char buffer[4096], name[64];
+	uint32_t i, count = present_flags(state, flags);
+
+	format_flags(state, flags, count, buffer, sizeof(buffer));
+
+	printf("/* Generated by cpuid --target-header. Build with the flags in\n"
+	       " * CPUID_TARGET_CFLAGS so the compiler may use every feature marked\n"
+	       " * present here.\n"
+	       " */\n\n");
+	printf("#ifndef CPUID_TARGET_H\n#define CPUID_TARGET_H\n\n");
+	printf("#define CPUID_TARGET_MTUNE \"%s\"\n", target_tune_name(state));
+	printf("#define CPUID_TARGET_CFLAGS \"%s\"\n\n", buffer);
+
+	printf("#define CPUID_TARGET_LINE_SIZE %u\n", hints->line_size);
+	printf("#define CPUID_TARGET_L1D_SIZE %u\n", hints->l1d_size);
+	printf("#define CPUID_TARGET_L2_SIZE %u\n", hints->l2_size);
+	printf("#define CPUID_TARGET_LLC_SIZE %u\n\n", hints->llc_size);
+
+	for (i = 0; i < count; i++)
+		printf("#define CPUID_TARGET_HAS_%s %d\n",
+		       identifier(flags[i].flag, 1, name, sizeof(name)), flags[i].present);
+
+	printf("\n#ifdef __cplusplus\nnamespace cpuid_target {\n\n");
+	printf("constexpr unsigned line_size = %u;\n", hints->line_size);
+	printf("constexpr unsigned l1d_size = %u;\n", hints->l1d_size);
+	printf("constexpr unsigned l2_size = %u;\n", hints->l2_size);
+	printf("constexpr unsigned llc_size = %u;\n\n", hints->llc_size);
+	for (i = 0; i < count; i++)
+		printf("constexpr bool has_%s = %s;\n",
+		       identifier(flags[i].flag, 0, name, sizeof(name)),
+		       flags[i].present ? "true" : "false");
+	printf("\n} /* namespace cpuid_target */\n#endif\n\n#endif\n");
+}
+
+/* vim: set ts=4 sts=4 sw=4 noet: */
@@ -0,0 +1,46 @@
+/*
+ * CPUID
+ *
+ * A simple and small tool to dump/decode CPUID information.
+ *
+ * Copyright (c) 2010-2025, Steven Noonan <steven@uplinklabs.net>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef __target_h
+#define __target_h
+
+struct cpuid_state_t;
+struct tuning_hints_t;
+
+/* Returns the GCC/Clang -mtune name for the processor's family and model,
+ * or "generic" for parts the table doesn't know.
+ */
+const char *target_tune_name(struct cpuid_state_t *state);
+
+/* Prints the compiler flags that target the processor: -march for the
+ * baseline ISA, -mtune, and a -m<feature> for every extension it reports.
+ */
+void target_print_flags(struct cpuid_state_t *state);
+
+/* Prints a C/C++ header describing the processor at compile time: feature
+ * booleans (constexpr in C++, macros in C), cache sizes, line size and the
+ * flags above.
+ */
+void target_print_header(struct cpuid_state_t *state, const struct tuning_hints_t *hints);
+
+#endif
+
+/* vim: set ts=4 sts=4 sw=4 noet: */
@@ -71,6 +71,10 @@ extern int utilUnbindThreadFromCPU(void);
 
 #endif
 
+#ifndef TARGET_OS_WINDOWS
+#include <pthread.h>
+#endif
+
 #include "state.h"
 #include "util.h"
 
@@ -126,13 +130,16 @@ uint32_t thread_count_native(struct cpuid_state_t *state)
 
 	return (uint32_t)count;
 #else
-	static unsigned int i = 0;
-	if (i) return i;
+	uint32_t i = 0;
+	if (state && state->threads.count)
+		return state->threads.count;
 	if (thread_bind_native(state, 0) != 0) {
 		fprintf(stderr, "ERROR: thread_bind() doesn't appear to be working correctly.\n");
 		abort();
 	}
 	while (thread_bind_native(state, ++i) == 0);
+	if (state)
+		state->threads.count = i;
 	return i;
 #endif
 }
@@ -301,4 +308,61 @@ int thread_bind_stub(struct cpuid_state_t *state, uint32_t id)
 	return 0;
 }
 
+struct thread_t {
+	thread_start_t start;
+	void *arg;
+#ifdef TARGET_OS_WINDOWS
+	HANDLE handle;
+#else
+	pthread_t handle;
+#endif
+};
+
+#ifdef TARGET_OS_WINDOWS
+static DWORD WINAPI thread_trampoline(LPVOID ptr)
+{
+	struct thread_t *thread = (struct thread_t *)ptr;
+	thread->start(thread->arg);
+	return 0;
+}
+#endif
+
+struct thread_t *thread_spawn(thread_start_t start, void *arg)
+{
+	struct thread_t *thread = (struct thread_t *)malloc(sizeof(struct thread_t));
+	if (!thread)
+		return NULL;
+
+	thread->start = start;
+	thread->arg = arg;
+
+#ifdef TARGET_OS_WINDOWS
+	thread->handle = CreateThread(NULL, 0, thread_trampoline, thread, 0, NULL);
+	if (!thread->handle) {
+		free(thread);
+		return NULL;
+	}
+#else
+	if (pthread_create(&thread->handle, NULL, start, arg) != 0) {
+		free(thread);
+		return NULL;
+	}
+#endif
+
+	return thread;
+}
+
+void thread_join(struct thread_t *thread)
+{
+	if (!thread)
+		return;
+#ifdef TARGET_OS_WINDOWS
+	WaitForSingleObject(thread->handle, INFINITE);
+	CloseHandle(thread->handle);
+#else
+	pthread_join(thread->handle, NULL);
+#endif
+	free(thread);
+}
+
 /* vim: set ts=4 sts=4 sw=4 noet: */
@@ -38,6 +38,13 @@ void thread_init_stub(void);
 int thread_bind_stub(struct cpuid_state_t *state, uint32_t id);
 uint32_t thread_count_stub(struct cpuid_state_t *state);
 
+/* Minimal portable wrappers for running work on helper threads. */
+struct thread_t;
+typedef void *(*thread_start_t)(void *);
+
+struct thread_t *thread_spawn(thread_start_t start, void *arg);
+void thread_join(struct thread_t *thread);
+
 #endif
 
 /* vim: set ts=4 sts=4 sw=4 noet: */
@@ -0,0 +1,347 @@
+/*
+ * CPUID
+ *
+ * A simple and small tool to dump/decode CPUID information.
+ *
+ * Copyright (c) 2010-2025, Steven Noonan <steven@uplinklabs.net>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "prefix.h"
+
+#include "cpuid.h"
+#include "state.h"
+#include "tlb.h"
+#include "topology.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void query(struct cpuid_state_t *state, struct cpu_regs_t *regs,
+                  uint32_t leaf, uint32_t subleaf)
+{
+	ZERO_REGS(regs);
+	regs->eax = leaf;
+	regs->ecx = subleaf;
+	state->cpuid_call(regs, state);
+}
+
+static const char *page_size_names[TLB_PAGE_SIZES] = { "4K", "2M", "1G" };
+static const uint64_t page_size_bytes[TLB_PAGE_SIZES] = { 4096ULL, 2097152ULL, 1073741824ULL };
+
+/* 4M pages only exist in 32-bit non-PAE paging, so TLB entries that hold
+ * 4M but not 2M pages don't count toward any of the sizes listed here.
+ */
+static const uint32_t page_size_attrs[TLB_PAGE_SIZES] = { PAGES_4K, PAGES_2M, PAGES_1G };
+
+const char *tlb_page_size_name(tlb_page_size_t size)
+{
+	return size < TLB_PAGE_SIZES ? page_size_names[size] : "unknown";
+}
+
+uint64_t tlb_page_size_bytes(tlb_page_size_t size)
+{
+	return size < TLB_PAGE_SIZES ? page_size_bytes[size] : 0;
+}
+
+static void add_tlb(struct tlb_info_t *info, const struct cache_desc_t *desc)
+{
+	switch (desc->type) {
+	case DATA_TLB:
+	case CODE_TLB:
+	case SHARED_TLB:
+	case LOADONLY_TLB:
+	case STOREONLY_TLB:
+		break;
+	default:
+		return;
+	}
+	if (info->count < TLB_MAX)
+		info->tlbs[info->count++] = *desc;
+}
+
+/* The AMD leaves pack an instruction and a data TLB into each register,
+ * entries in the low bits of each half and associativity above them.
+ */
+static void add_amd_pair(struct tlb_info_t *info, cache_level_t level, uint32_t reg,
+                         uint32_t attrs, int legacy_l1)
+{
+	struct cache_desc_t desc;
+	uint32_t half;
+
+	for (half = 0; half < 2; half++) {
+		uint32_t bits = half ? reg >> 16 : reg & 0xffff;
+
+		memset(&desc, 0, sizeof(struct cache_desc_t));
+		desc.level = level;
+		desc.type = half ? DATA_TLB : CODE_TLB;
+		desc.attrs = attrs;
+		if (legacy_l1) {
+			/* 0x80000005 gives 8-bit entry counts and plain way counts. */
+			desc.size = bits & 0xff;
+			desc.assoc = (bits >> 8) & 0xff;
+		} else {
+			desc.size = bits & 0xfff;
+			desc.assoc = amd_assoc_ways((bits >> 12) & 0xf);
+		}
+		if (desc.size)
+			add_tlb(info, &desc);
+	}
+}
+
+static void probe_amd(struct cpuid_state_t *state, struct tlb_info_t *info)
+{
+	struct cpu_regs_t regs;
+	uint32_t maxext;
+
+	query(state, &regs, 0x80000000, 0);
+	maxext = (regs.eax & 0xffff0000) == 0x80000000 ? regs.eax : 0;
+
+	if (maxext >= 0x80000005) {
+		query(state, &regs, 0x80000005, 0);
+		add_amd_pair(info, L1, regs.ebx, PAGES_4K, 1);
+		add_amd_pair(info, L1, regs.eax, PAGES_2M | PAGES_4M, 1);
+	}
+
+	if (maxext >= 0x80000006) {
+		query(state, &regs, 0x80000006, 0);
+		add_amd_pair(info, L2, regs.ebx, PAGES_4K, 0);
+		add_amd_pair(info, L2, regs.eax, PAGES_2M | PAGES_4M, 0);
+	}
+
+	if (maxext >= 0x80000019) {
+		query(state, &regs, 0x80000019, 0);
+		add_amd_pair(info, L1, regs.eax, PAGES_1G, 0);
+		add_amd_pair(info, L2, regs.ebx, PAGES_1G, 0);
+	}
+}
+
+/* Leaf 0x18 replaces the leaf 2 TLB descriptors (via descriptor 0xFE) on
+ * recent Intel parts. Subleaf 0 EAX holds the highest subleaf.
+ */
+static void probe_leaf_18(struct cpuid_state_t *state, struct tlb_info_t *info)
+{
+	struct cpu_regs_t regs;
+	uint32_t i, max = 0;
+
+	for (i = 0; i <= max; i++) {
+		struct cache_desc_t desc;
+
+		query(state, &regs, 0x18, i);
+		if (i == 0)
+			max = regs.eax;
+
+		if (decode_intel_tlb(&regs, &desc) == 0)
+			add_tlb(info, &desc);
+	}
+}
+
+static void probe_intel(struct cpuid_state_t *state, struct tlb_info_t *info)
+{
+	struct cache_desc_t descs[32];
+	struct cpu_signature_t sig;
+	struct cpu_regs_t regs;
+	uint32_t i, maxleaf, count;
+
+	query(state, &regs, 0, 0);
+	maxleaf = regs.eax;
+	if (maxleaf < 2)
+		return;
+
+	query(state, &regs, 1, 0);
+	memcpy(&sig, &regs.eax, sizeof(sig));
+
+	query(state, &regs, 2, 0);
+	count = decode_intel_caches(&regs, &sig, descs, NELEM(descs), NULL);
+	for (i = 0; i < count; i++)
+		add_tlb(info, &descs[i]);
+
+	if (maxleaf >= 0x18)
+		probe_leaf_18(state, info);
+}
+
+int tlb_probe(struct cpuid_state_t *state, uint32_t vendor, struct tlb_info_t *info)
+{
+	memset(info, 0, sizeof(struct tlb_info_t));
+
+	if (vendor & VENDOR_INTEL)
+		probe_intel(state, info);
+	if (vendor & (VENDOR_AMD | VENDOR_HYGON))
+		probe_amd(state, info);
+
+	return info->count ? 0 : 1;
+}
+
+void tlb_reach(const struct tlb_info_t *info, struct tlb_reach_t reach[TLB_PAGE_SIZES])
+{
+	uint32_t i, j;
+
+	memset(reach, 0, TLB_PAGE_SIZES * sizeof(struct tlb_reach_t));
+
+	for (i = 0; i < info->count; i++) {
+		const struct cache_desc_t *desc = &info->tlbs[i];
+		int first;
+
+		if (desc->type != DATA_TLB && desc->type != LOADONLY_TLB && desc->type != SHARED_TLB)
+			continue;
+
+		/* Leaf 2 gives most TLBs no level at all; a shared TLB is the STLB. */
+		first = desc->type != SHARED_TLB && (desc->level == NO || desc->level <= L1);
+
+		for (j = 0; j < TLB_PAGE_SIZES; j++) {
+			uint32_t *slot;
+			if (!(desc->attrs & page_size_attrs[j]))
+				continue;
+			slot = first ? &reach[j].l1_entries : &reach[j].l2_entries;
+			if (desc->size > *slot)
+				*slot = desc->size;
+		}
+	}
+
+	for (j = 0; j < TLB_PAGE_SIZES; j++) {
+		uint32_t entries = reach[j].l2_entries > reach[j].l1_entries ?
+		                   reach[j].l2_entries : reach[j].l1_entries;
+		reach[j].reach = entries * page_size_bytes[j];
+	}
+}
+
+static const char *type_name(cache_type_t type)
+{
+	switch (type) {
+	case DATA_TLB:      return "data";
+	case CODE_TLB:      return "code";
+	case SHARED_TLB:    return "shared";
+	case LOADONLY_TLB:  return "load";
+	case STOREONLY_TLB: return "store";
+	default:            return "unknown";
+	}
+}
+
+struct tlb_group_t {
+	struct tlb_info_t info;
+	uint8_t core_type;
+	uint32_t count;
+	uint32_t *cpus;
+};
+
+static void print_group(const struct tlb_group_t *group, const char *cpuset)
+{
+	struct tlb_reach_t reach[TLB_PAGE_SIZES];
+	uint32_t i;
+
+	printf("    {\n      \"cpuset\": \"%s\",\n      \"core_type\": %u,\n      \"tlbs\": [",
+	       cpuset, group->core_type);
+	for (i = 0; i < group->info.count; i++) {
+		const struct cache_desc_t *desc = &group->info.tlbs[i];
+		uint32_t n = 0;
+
+		printf("%s\n        { \"level\": ", i ? "," : "");
+		if (desc->level == NO)
+			printf("null");
+		else
+			printf("%u", (uint32_t)desc->level);
+		printf(", \"type\": \"%s\", \"entries\": %u, \"ways\": ", type_name(desc->type), desc->size);
+		if (desc->assoc == 0xff)
+			printf("\"full\"");
+		else
+			printf("%u", desc->assoc);
+		printf(", \"pages\": [");
+		if (desc->attrs & PAGES_4K)
+			printf("%s\"4K\"", n++ ? ", " : "");
+		if (desc->attrs & PAGES_2M)
+			printf("%s\"2M\"", n++ ? ", " : "");
+		if (desc->attrs & PAGES_4M)
+			printf("%s\"4M\"", n++ ? ", " : "");
+		if (desc->attrs & PAGES_1G)
+			printf("%s\"1G\"", n++ ? ", " : "");
+		printf("] }");
+	}
+	printf("\n      ],\n      \"reach\": [");
+
+	tlb_reach(&group->info, reach);
+	for (i = 0; i < TLB_PAGE_SIZES; i++) {
+		printf("%s\n        { \"page_size\": \"%s\", \"l1_entries\": %u, \"l2_entries\": %u, "
+		       "\"reach\": %" PRIu64 ", \"gain\": ",
+		       i ? "," : "", page_size_names[i], reach[i].l1_entries, reach[i].l2_entries,
+		       reach[i].reach);
+		/* How much more memory stays TLB-mapped than with 4K pages alone. */
+		if (reach[TLB_PAGE_4K].reach)
+			printf("%" PRIu64, reach[i].reach / reach[TLB_PAGE_4K].reach);
+		else
+			printf("null");
+		printf(" }");
+	}
+	printf("\n      ],\n      \"cpus\": [");
+	for (i = 0; i < group->count; i++)
+		printf("%s%u", i ? ", " : "", group->cpus[i]);
+	printf("]\n    }");
+}
+
+int tlb_print_reach(struct cpuid_state_t *state, const struct topology_t *topo)
+{
+	struct tlb_group_t *groups;
+	struct tlb_info_t *info;
+	uint32_t bufsize = topo->count * 12 + 1;
+	char *buffer;
+	uint32_t i, k, count = 0;
+
+	groups = (struct tlb_group_t *)calloc(topo->count + 1, sizeof(struct tlb_group_t));
+	info = (struct tlb_info_t *)malloc(sizeof(struct tlb_info_t));
+	buffer = (char *)malloc(bufsize);
+	assert(groups && info && buffer);
+
+	for (i = 0; i < topo->count; i++) {
+		const struct topology_cpu_t *cpu = &topo->cpus[i];
+
+		if (state->thread_bind(state, cpu->cpu) != 0)
+			continue;
+		if (tlb_probe(state, topo->vendor, info) != 0)
+			continue;
+
+		for (k = 0; k < count; k++)
+			if (groups[k].core_type == cpu->core_type &&
+			    memcmp(&groups[k].info, info, sizeof(struct tlb_info_t)) == 0)
+				break;
+		if (k == count) {
+			groups[k].info = *info;
+			groups[k].core_type = cpu->core_type;
+			groups[k].cpus = (uint32_t *)calloc(topo->count, sizeof(uint32_t));
+			assert(groups[k].cpus);
+			count++;
+		}
+		groups[k].cpus[groups[k].count++] = cpu->cpu;
+	}
+
+	if (count) {
+		printf("{\n  \"models\": [\n");
+		for (k = 0; k < count; k++) {
+			topology_format_cpus(groups[k].cpus, groups[k].count, buffer, bufsize);
+			print_group(&groups[k], buffer);
+			printf("%s\n", k + 1 < count ? "," : "");
+		}
+		printf("  ]\n}\n");
+	}
+
+	for (k = 0; k < count; k++)
+		free(groups[k].cpus);
+	free(groups);
+	free(info);
+	free(buffer);
+	return count ? 0 : 1;
+}
+
+/* vim: set ts=4 sts=4 sw=4 noet: */
@@ -0,0 +1,73 @@
+/*
+ * CPUID
+ *
+ * A simple and small tool to dump/decode CPUID information.
+ *
+ * Copyright (c) 2010-2025, Steven Noonan <steven@uplinklabs.net>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef __tlb_h
+#define __tlb_h
+
+#include "cache.h"
+
+struct cpuid_state_t;
+struct topology_t;
+
+typedef enum {
+	TLB_PAGE_4K = 0,
+	TLB_PAGE_2M,
+	TLB_PAGE_1G,
+	TLB_PAGE_SIZES
+} tlb_page_size_t;
+
+#define TLB_MAX 32
+
+/* Every TLB of one core, whichever leaf described it: leaf 2 descriptors
+ * and leaf 0x18 on Intel, 0x80000005, 0x80000006 and 0x80000019 on AMD.
+ * Each entry is a cache_desc_t with 'size' in entries and the PAGES_*
+ * attributes it can hold.
+ */
+struct tlb_info_t {
+	uint32_t count;
+	struct cache_desc_t tlbs[TLB_MAX];
+};
+
+struct tlb_reach_t {
+	uint32_t l1_entries;   /* first level data (or load-only) TLB */
+	uint32_t l2_entries;   /* second level or shared TLB */
+	uint64_t reach;        /* bytes mapped by the larger of the two */
+};
+
+/* Collects the TLBs of the current CPU. Returns nonzero if the processor
+ * reports none.
+ */
+int tlb_probe(struct cpuid_state_t *state, uint32_t vendor, struct tlb_info_t *info);
+
+/* Data TLB entries and reach for each page size. */
+void tlb_reach(const struct tlb_info_t *info, struct tlb_reach_t reach[TLB_PAGE_SIZES]);
+
+const char *tlb_page_size_name(tlb_page_size_t size);
+uint64_t tlb_page_size_bytes(tlb_page_size_t size);
+
+/* Probes every CPU and prints each distinct TLB model, its reach per page
+ * size and the CPUs that have it, as JSON.
+ */
+int tlb_print_reach(struct cpuid_state_t *state, const struct topology_t *topo);
+
+#endif
+
+/* vim: set ts=4 sts=4 sw=4 noet: */
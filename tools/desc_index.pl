@@ -0,0 +1,67 @@
+#!/usr/bin/env perl
+$|=1;	# Flush writes as soon as print finishes.
+
+# Regenerates the desc_index[] table in cache.c from descs[], so the leaf 2
+# lookup index stays a compile-time constant without being kept in step by
+# hand. With --check, only reports whether the table in the file is current.
+#
+#   tools/desc_index.pl [--check] cache.c
+
+use strict;
+use warnings;
+
+my $check = 0;
+if (@ARGV && $ARGV[0] eq "--check") {
+	$check = 1;
+	shift @ARGV;
+}
+my $file = $ARGV[0] || die ("usage: $0 [--check] cache.c\n");
+
+local $/=undef;
+open IN, "<", $file or die ("Can't open $file:$!");
+my $source = <IN>;
+close IN;
+
+$source =~ /static const struct cache_desc_index_t descs\[\] = \{\n(.*?)\n\};/s
+	or die ("$file: can't find descs[]\n");
+my @bytes = map { hex } ($1 =~ /^\s*\{ 0x([0-9a-fA-F]{2}),/mg);
+
+die ("$file: descs[] has " . scalar(@bytes) . " entries, more than a uint8_t index holds\n")
+	if (@bytes > 255);
+
+my (@first, @count);
+for (my $i = 0; $i < @bytes; $i++) {
+	my $b = $bytes[$i];
+	die (sprintf("%s: descs[] is out of order at entry %d (0x%02x)\n", $file, $i, $b))
+		if ($i && $bytes[$i - 1] > $b);
+	$first[$b] = $i unless ($count[$b]);
+	$count[$b]++;
+}
+
+my $table = "static const struct cache_desc_span_t desc_index[256] = {\n";
+for (my $row = 0; $row < 256; $row += 8) {
+	my @cells;
+	for (my $b = $row; $b < $row + 8; $b++) {
+		push @cells, sprintf("{ %3d, %d }", $count[$b] ? $first[$b] : 0, $count[$b] || 0);
+	}
+	$table .= sprintf("\t/* 0x%02x */ %s%s\n", $row, join(", ", @cells), $row + 8 < 256 ? "," : "");
+}
+$table .= "};";
+
+my $updated = $source;
+$updated =~ s/static const struct cache_desc_span_t desc_index\[256\] = \{\n.*?\n\};/$table/s
+	or die ("$file: can't find desc_index[]\n");
+
+if ($check) {
+	if ($updated ne $source) {
+		print STDERR "$file: desc_index[] is out of date, run $0 $file\n";
+		exit 1;
+	}
+	exit 0;
+}
+
+if ($updated ne $source) {
+	open OUT, ">", $file or die ("Can't write $file:$!");
+	print OUT $updated;
+	close OUT or die $!;
+}
@@ -0,0 +1,808 @@
+/*
+ * CPUID
+ *
+ * A simple and small tool to dump/decode CPUID information.
+ *
+ * Copyright (c) 2010-2025, Steven Noonan <steven@uplinklabs.net>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "prefix.h"
+
+#include "cpuid.h"
+#include "handlers.h"
+#include "state.h"
+#include "topology.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* Number of APIC ID bits needed to hold 'count' distinct values. */
+static uint8_t shift_for_count(uint32_t count)
+{
+	uint8_t shift = 0;
+	while (count > 1 && (1U << shift) < count)
+		shift++;
+	return shift;
+}
+
+/* Leaves 0xB and 0x1F list one subleaf per level, each giving the level type
+ * and the number of APIC ID bits to shift out to reach the next level's ID.
+ * Leaf 0xB only ever reports SMT and core.
+ */
+static int topology_probe_extended(struct cpuid_state_t *state, struct topology_t *topo,
+                                   uint32_t leaf, uint32_t *apic_id)
+{
+	struct cpu_regs_t regs;
+	uint32_t i, level, top = 0;
+	uint8_t package = 0;
+
+	memset(topo->shift, 0, sizeof(topo->shift));
+	topo->reported = 0;
+	for (i = 0; i < 16; i++) {
+		ZERO_REGS(&regs);
+		regs.eax = leaf;
+		regs.ecx = i;
+		state->cpuid_call(&regs, state);
+		level = (regs.ecx >> 8) & 0xff;
+		if (!level || !regs.ebx)
+			break;
+		*apic_id = regs.edx;
+
+		/* The last valid subleaf's shift gives the package ID, whatever
+		 * its level type.
+		 */
+		package = regs.eax & 0x1f;
+
+		/* A level type we don't know is left out; the next known level's
+		 * shift covers its bits anyway.
+		 */
+		if (level > TOPOLOGY_DIEGRP + 1)
+			continue;
+		topo->shift[level - 1] = package;
+		topo->reported |= 1U << (level - 1);
+		if (level - 1 > top)
+			top = level - 1;
+	}
+	if (!topo->reported)
+		return 1;
+
+	/* Unreported levels take the width of the level below. Unknown levels
+	 * above the highest known one fold into it, so that the package ID
+	 * starts where the last subleaf says.
+	 */
+	if (topo->shift[top] < package)
+		topo->shift[top] = package;
+	for (level = TOPOLOGY_CORE; level < TOPOLOGY_PACKAGE; level++) {
+		if (!(topo->reported & (1U << level)))
+			topo->shift[level] = topo->shift[level - 1];
+	}
+	topo->shift[TOPOLOGY_PACKAGE] = 32;
+	topo->reported |= 1U << TOPOLOGY_PACKAGE;
+	topo->source = leaf;
+	return 0;
+}
+
+static void topology_set_shifts(struct topology_t *topo, uint8_t smt, uint8_t package)
+{
+	uint32_t level;
+
+	topo->shift[TOPOLOGY_THREAD] = smt;
+	for (level = TOPOLOGY_CORE; level < TOPOLOGY_PACKAGE; level++)
+		topo->shift[level] = package;
+	topo->shift[TOPOLOGY_PACKAGE] = 32;
+	topo->reported = (1U << TOPOLOGY_THREAD) | (1U << TOPOLOGY_CORE) | (1U << TOPOLOGY_PACKAGE);
+}
+
+/* AMD parts without leaf 0xB: the extended APIC ID and threads per core
+ * come from leaf 0x8000001E, the APIC ID width from leaf 0x80000008.
+ */
+static int topology_probe_amd(struct cpuid_state_t *state, struct topology_t *topo,
+                              uint32_t extmax, uint32_t *apic_id)
+{
+	struct cpu_regs_t regs;
+	uint32_t threads, width;
+
+	if (extmax < 0x8000001e)
+		return 1;
+
+	ZERO_REGS(&regs);
+	regs.eax = 0x80000001;
+	state->cpuid_call(&regs, state);
+	if (!(regs.ecx & (1 << 22)))
+		return 1;
+
+	ZERO_REGS(&regs);
+	regs.eax = 0x8000001e;
+	state->cpuid_call(&regs, state);
+	*apic_id = regs.eax;
+	threads = ((regs.ebx >> 8) & 0xff) + 1;
+
+	ZERO_REGS(&regs);
+	regs.eax = 0x80000008;
+	state->cpuid_call(&regs, state);
+	width = (regs.ecx >> 12) & 0xf;
+	if (!width)
+		width = shift_for_count((regs.ecx & 0xff) + 1);
+
+	topology_set_shifts(topo, shift_for_count(threads), (uint8_t)width);
+	topo->source = 0x8000001e;
+	return 0;
+}
+
+static void topology_probe_leaf_1(struct cpuid_state_t *state, struct topology_t *topo,
+                                  uint32_t *apic_id)
+{
+	struct cpu_regs_t regs;
+	uint8_t package = 0;
+
+	ZERO_REGS(&regs);
+	regs.eax = 1;
+	state->cpuid_call(&regs, state);
+	*apic_id = regs.ebx >> 24;
+
+	/* Without leaf 0xB there's no SMT width to go on, so treat every
+	 * logical processor in the package as its own core.
+	 */
+	if (regs.edx & (1 << 28))
+		package = shift_for_count((regs.ebx >> 16) & 0xff);
+	topology_set_shifts(topo, 0, package);
+	topo->source = 1;
+}
+
+static uint32_t topology_vendor(struct cpuid_state_t *state)
+{
+	struct cpu_regs_t regs;
+	char buf[13];
+	uint32_t vendor;
+
+	if (state->vendor != VENDOR_UNKNOWN)
+		return state->vendor;
+
+	ZERO_REGS(&regs);
+	state->cpuid_call(&regs, state);
+	memcpy(&buf[0], &regs.ebx, 4);
+	memcpy(&buf[4], &regs.edx, 4);
+	memcpy(&buf[8], &regs.ecx, 4);
+	buf[12] = 0;
+
+	vendor = vendor_id(buf);
+	if (vendor == VENDOR_HYGON)
+		vendor |= VENDOR_AMD;
+	return vendor;
+}
+
+/* Leaf 4 (Intel) and leaf 0x8000001D (AMD) share a register layout, so one
+ * decoder covers both.
+ */
+static void topology_probe_caches(struct cpuid_state_t *state, struct topology_cpu_t *cpu,
+                                  uint32_t leaf)
+{
+	struct cpu_regs_t regs;
+	uint32_t i;
+
+	cpu->cache_count = 0;
+	for (i = 0; i < TOPOLOGY_MAX_CACHES; i++) {
+		struct topology_cache_t *cache = &cpu->caches[cpu->cache_count];
+		uint32_t type, sharing;
+
+		ZERO_REGS(&regs);
+		regs.eax = leaf;
+		regs.ecx = i;
+		state->cpuid_call(&regs, state);
+
+		type = regs.eax & 0x1f;
+		if (!type)
+			break;
+
+		memset(cache, 0, sizeof(struct topology_cache_t));
+		cache->desc.level = (cache_level_t)(L0 + ((regs.eax >> 5) & 0x7));
+		cache->desc.type = (cache_type_t)(DATA + type - 1);
+		cache->desc.assoc = (regs.eax & (1 << 9)) ? 0xff : ((regs.ebx >> 22) & 0x3ff) + 1;
+		cache->desc.linesize = (regs.ebx & 0xfff) + 1;
+		cache->desc.partitions = ((regs.ebx >> 12) & 0x3ff) + 1;
+		cache->desc.size = (((regs.ebx >> 22) & 0x3ff) + 1) *
+		                   cache->desc.partitions * cache->desc.linesize *
+		                   (regs.ecx + 1) / 1024;
+		sharing = ((regs.eax >> 14) & 0xfff) + 1;
+		cache->desc.max_threads_sharing = sharing;
+		cache->id = cpu->apic_id >> shift_for_count(sharing);
+		cpu->cache_count++;
+	}
+}
+
+void topology_probe_cpu_caches(struct cpuid_state_t *state, struct topology_cpu_t *cpu)
+{
+	struct cpu_regs_t regs;
+	uint32_t vendor, maxleaf, extmax;
+
+	vendor = topology_vendor(state);
+
+	ZERO_REGS(&regs);
+	state->cpuid_call(&regs, state);
+	maxleaf = regs.eax;
+
+	ZERO_REGS(&regs);
+	regs.eax = 0x80000000;
+	state->cpuid_call(&regs, state);
+	extmax = regs.eax;
+	if (extmax < 0x80000000 || extmax > 0x8000ffff)
+		extmax = 0;
+
+	/* AMD parts answer leaf 4 with zeros, so prefer their own leaf, and
+	 * fall back to it anywhere leaf 4 comes up empty.
+	 */
+	cpu->cache_count = 0;
+	if ((vendor & VENDOR_AMD) && extmax >= 0x8000001d)
+		topology_probe_caches(state, cpu, 0x8000001d);
+	else if (maxleaf >= 4)
+		topology_probe_caches(state, cpu, 4);
+	if (!cpu->cache_count && extmax >= 0x8000001d)
+		topology_probe_caches(state, cpu, 0x8000001d);
+}
+
+int topology_probe(struct cpuid_state_t *state, struct topology_t *topo)
+{
+	struct cpu_regs_t regs;
+	uint32_t i, maxleaf, level;
+
+	memset(topo, 0, sizeof(struct topology_t));
+	topo->count = state->thread_count(state);
+	if (!topo->count)
+		return 1;
+
+	topo->cpus = (struct topology_cpu_t *)calloc(topo->count, sizeof(struct topology_cpu_t));
+	if (!topo->cpus)
+		return 1;
+
+	for (i = 0; i < topo->count; i++) {
+		struct topology_cpu_t *cpu = &topo->cpus[i];
+		uint32_t id = 0, extmax;
+
+		if (state->thread_bind(state, i) != 0) {
+			topology_free(topo);
+			return 1;
+		}
+
+		if (i == 0)
+			topo->vendor = topology_vendor(state);
+
+		ZERO_REGS(&regs);
+		state->cpuid_call(&regs, state);
+		maxleaf = regs.eax;
+
+		ZERO_REGS(&regs);
+		regs.eax = 0x80000000;
+		state->cpuid_call(&regs, state);
+		extmax = regs.eax;
+		if (extmax < 0x80000000 || extmax > 0x8000ffff)
+			extmax = 0;
+
+		if ((maxleaf < 0x1f || topology_probe_extended(state, topo, 0x1f, &id) != 0) &&
+		    (maxleaf < 0xb || topology_probe_extended(state, topo, 0xb, &id) != 0) &&
+		    (!(topo->vendor & VENDOR_AMD) || topology_probe_amd(state, topo, extmax, &id) != 0))
+			topology_probe_leaf_1(state, topo, &id);
+
+		cpu->cpu = i;
+		cpu->apic_id = id;
+		for (level = TOPOLOGY_THREAD; level < TOPOLOGY_PACKAGE; level++) {
+			uint8_t below = level ? topo->shift[level - 1] : 0;
+			cpu->ids[level] = (id & ((1U << topo->shift[level]) - 1)) >> below;
+		}
+		cpu->ids[TOPOLOGY_PACKAGE] = id >> topo->shift[TOPOLOGY_DIEGRP];
+		cpu->thread = cpu->ids[TOPOLOGY_THREAD];
+		cpu->core = (id & ((1U << topo->shift[TOPOLOGY_DIEGRP]) - 1)) >> topo->shift[TOPOLOGY_THREAD];
+		cpu->package = cpu->ids[TOPOLOGY_PACKAGE];
+
+		/* On AMD, leaf 0x8000001E also names the node (die) this CPU
+		 * belongs to, which leaf 0xB doesn't distinguish.
+		 */
+		if ((topo->vendor & VENDOR_AMD) && extmax >= 0x8000001e) {
+			uint32_t nodes;
+			ZERO_REGS(&regs);
+			regs.eax = 0x8000001e;
+			state->cpuid_call(&regs, state);
+			cpu->node = regs.ecx & 0xff;
+			nodes = ((regs.ecx >> 8) & 0x7) + 1;
+			if (!(topo->reported & (1U << TOPOLOGY_DIE)) && nodes > 1)
+				cpu->ids[TOPOLOGY_DIE] = cpu->node % nodes;
+		}
+
+		if ((topo->vendor & VENDOR_INTEL) && maxleaf >= 0x1a) {
+			ZERO_REGS(&regs);
+			regs.eax = 0x1a;
+			state->cpuid_call(&regs, state);
+			cpu->core_type = regs.eax >> 24;
+			cpu->native_model = regs.eax & 0xffffff;
+		}
+
+		topology_probe_cpu_caches(state, cpu);
+	}
+
+	return 0;
+}
+
+static const char *level_names[TOPOLOGY_LEVELS] = {
+	"thread",
+	"core",
+	"module",
+	"tile",
+	"die",
+	"diegrp",
+	"package"
+};
+
+static const char *level_titles[TOPOLOGY_LEVELS] = {
+	"Thread",
+	"Core",
+	"Module",
+	"Tile",
+	"Die",
+	"Die group",
+	"Package"
+};
+
+const char *topology_level_name(topology_level_t level)
+{
+	if ((uint32_t)level >= TOPOLOGY_LEVELS)
+		return "unknown";
+	return level_names[level];
+}
+
+/* Levels worth showing, outermost first: those the CPU enumerates, plus any
+ * where CPUs actually differ (e.g. AMD nodes). The thread level is always
+ * last.
+ */
+static uint32_t shown_levels(const struct topology_t *topo, topology_level_t *levels)
+{
+	uint32_t count = 0, i;
+	int level;
+
+	for (level = TOPOLOGY_PACKAGE; level >= TOPOLOGY_THREAD; level--) {
+		BOOL show = (topo->reported & (1U << level)) ? TRUE : FALSE;
+		for (i = 1; !show && i < topo->count; i++)
+			if (topo->cpus[i].ids[level] != topo->cpus[0].ids[level])
+				show = TRUE;
+		if (show || level == TOPOLOGY_THREAD)
+			levels[count++] = (topology_level_t)level;
+	}
+	return count;
+}
+
+void topology_sort(const struct topology_t *topo, void *base, size_t count, size_t size,
+                   topology_compare_t compare)
+{
+	unsigned char *items = (unsigned char *)base;
+	unsigned char *key;
+	size_t i, j;
+
+	if (count < 2)
+		return;
+	key = (unsigned char *)malloc(size);
+	assert(key);
+
+	/* Insertion sort: stable, and the lists are a few thousand CPUs at most. */
+	for (i = 1; i < count; i++) {
+		memcpy(key, items + i * size, size);
+		for (j = i; j > 0 && compare(topo, items + (j - 1) * size, key) > 0; j--)
+			memcpy(items + j * size, items + (j - 1) * size, size);
+		memcpy(items + j * size, key, size);
+	}
+	free(key);
+}
+
+static int cpu_compare(const struct topology_t *topo, const void *a, const void *b)
+{
+	const struct topology_cpu_t *x = &topo->cpus[*(const uint32_t *)a];
+	const struct topology_cpu_t *y = &topo->cpus[*(const uint32_t *)b];
+	int level;
+
+	for (level = TOPOLOGY_PACKAGE; level >= TOPOLOGY_THREAD; level--) {
+		if (x->ids[level] != y->ids[level])
+			return (x->ids[level] > y->ids[level]) ? 1 : -1;
+	}
+	return (x->cpu > y->cpu) - (x->cpu < y->cpu);
+}
+
+static uint32_t *sorted_cpus(const struct topology_t *topo)
+{
+	uint32_t *order = (uint32_t *)malloc(topo->count * sizeof(uint32_t));
+	uint32_t i;
+
+	assert(order);
+	for (i = 0; i < topo->count; i++)
+		order[i] = i;
+	topology_sort(topo, order, topo->count, sizeof(uint32_t), cpu_compare);
+	return order;
+}
+
+/* Index into 'levels' of the outermost level at which two CPUs differ. */
+static uint32_t first_difference(const struct topology_cpu_t *x, const struct topology_cpu_t *y,
+                                 const topology_level_t *levels, uint32_t count)
+{
+	uint32_t depth;
+	for (depth = 0; depth < count; depth++)
+		if (x->ids[levels[depth]] != y->ids[levels[depth]])
+			break;
+	return depth;
+}
+
+void topology_print_tree(const struct topology_t *topo)
+{
+	topology_level_t levels[TOPOLOGY_LEVELS];
+	uint32_t *order = sorted_cpus(topo);
+	uint32_t count = shown_levels(topo, levels);
+	uint32_t i, depth;
+
+	printf("Processor topology (%u logical CPUs, from leaf 0x%08x):\n", topo->count, topo->source);
+	for (i = 0; i < topo->count; i++) {
+		const struct topology_cpu_t *cpu = &topo->cpus[order[i]];
+		depth = i ? first_difference(&topo->cpus[order[i - 1]], cpu, levels, count) : 0;
+		for (; depth + 1 < count; depth++)
+			printf("%*s%s %u\n", 2 + (int)depth * 2, "",
+			       level_titles[levels[depth]], cpu->ids[levels[depth]]);
+		printf("%*s%s %u: CPU %u (APIC ID %u)\n", 2 + (int)(count - 1) * 2, "",
+		       level_titles[TOPOLOGY_THREAD], cpu->thread, cpu->cpu, cpu->apic_id);
+	}
+	printf("\n");
+	free(order);
+}
+
+void topology_print_json(const struct topology_t *topo)
+{
+	topology_level_t levels[TOPOLOGY_LEVELS];
+	uint32_t *order = sorted_cpus(topo);
+	uint32_t count = shown_levels(topo, levels);
+	uint32_t i, depth, open = 0;
+
+	printf("{\n  \"source\": \"0x%08x\",\n  \"cpus\": %u,\n  \"levels\": [", topo->source, topo->count);
+	for (depth = 0; depth < count; depth++)
+		printf("%s\"%s\"", depth ? ", " : "", level_names[levels[depth]]);
+	printf("],\n  \"shifts\": {");
+	for (depth = 0; depth + 1 < count; depth++)
+		printf("%s \"%s\": %u", depth ? "," : "", level_names[levels[depth + 1]],
+		       topo->shift[levels[depth + 1]]);
+	printf(" },\n  \"tree\": [");
+
+	for (i = 0; i < topo->count; i++) {
+		const struct topology_cpu_t *cpu = &topo->cpus[order[i]];
+		depth = i ? first_difference(&topo->cpus[order[i - 1]], cpu, levels, count) : 0;
+		if (depth + 1 > count)
+			depth = count - 1;
+
+		/* Close the nodes this CPU doesn't share with the previous one. */
+		for (; open > depth; open--)
+			printf("\n%*s]}", 2 + (int)open * 2, "");
+		if (i)
+			printf(",");
+
+		for (; open + 1 < count; open++)
+			printf("\n%*s{ \"%s\": %u, \"children\": [", 4 + (int)open * 2, "",
+			       level_names[levels[open]], cpu->ids[levels[open]]);
+		printf("\n%*s{ \"thread\": %u, \"cpu\": %u, \"apic_id\": %u }",
+		       4 + (int)open * 2, "", cpu->thread, cpu->cpu, cpu->apic_id);
+	}
+	for (; open > 0; open--)
+		printf("\n%*s]}", 2 + (int)open * 2, "");
+	printf("\n  ]\n}\n");
+	free(order);
+}
+
+struct cache_instance_t {
+	const struct topology_cache_t *cache;
+	uint32_t package;
+	uint32_t index;     /* ordinal among instances of the same level and type */
+	uint32_t count;
+	uint32_t *cpus;
+};
+
+static int instance_compare(const void *a, const void *b)
+{
+	const struct cache_instance_t *x = (const struct cache_instance_t *)a;
+	const struct cache_instance_t *y = (const struct cache_instance_t *)b;
+	if (x->cache->desc.level != y->cache->desc.level)
+		return (x->cache->desc.level > y->cache->desc.level) ? 1 : -1;
+	if (x->cache->desc.type != y->cache->desc.type)
+		return (x->cache->desc.type > y->cache->desc.type) ? 1 : -1;
+	return (x->cpus[0] > y->cpus[0]) - (x->cpus[0] < y->cpus[0]);
+}
+
+/* Groups the per-CPU cache records into physical instances. */
+static uint32_t cache_instances(const struct topology_t *topo, struct cache_instance_t **out)
+{
+	struct cache_instance_t *list;
+	uint32_t i, j, k, count = 0;
+
+	list = (struct cache_instance_t *)calloc(topo->count * TOPOLOGY_MAX_CACHES + 1, sizeof(struct cache_instance_t));
+	assert(list);
+
+	for (i = 0; i < topo->count; i++) {
+		const struct topology_cpu_t *cpu = &topo->cpus[i];
+		for (j = 0; j < cpu->cache_count; j++) {
+			const struct topology_cache_t *cache = &cpu->caches[j];
+			for (k = 0; k < count; k++) {
+				if (list[k].cache->desc.level == cache->desc.level &&
+				    list[k].cache->desc.type == cache->desc.type &&
+				    list[k].cache->id == cache->id &&
+				    list[k].package == cpu->package)
+					break;
+			}
+			if (k == count) {
+				list[k].cache = cache;
+				list[k].package = cpu->package;
+				list[k].cpus = (uint32_t *)calloc(topo->count, sizeof(uint32_t));
+				assert(list[k].cpus);
+				count++;
+			}
+			list[k].cpus[list[k].count++] = i;
+		}
+	}
+
+	qsort(list, count, sizeof(struct cache_instance_t), instance_compare);
+	for (k = 0; k < count; k++) {
+		if (k && list[k].cache->desc.level == list[k - 1].cache->desc.level &&
+		    list[k].cache->desc.type == list[k - 1].cache->desc.type)
+			list[k].index = list[k - 1].index + 1;
+	}
+
+	*out = list;
+	return count;
+}
+
+static void free_cache_instances(struct cache_instance_t *list, uint32_t count)
+{
+	uint32_t k;
+	for (k = 0; k < count; k++)
+		free(list[k].cpus);
+	free(list);
+}
+
+static const char *cache_type_suffix(cache_type_t type)
+{
+	switch (type) {
+	case DATA:
+		return "d";
+	case CODE:
+		return "i";
+	default:
+		return "";
+	}
+}
+
+static const char *cache_type_name(cache_type_t type)
+{
+	switch (type) {
+	case DATA:
+		return "data";
+	case CODE:
+		return "instruction";
+	default:
+		return "unified";
+	}
+}
+
+void topology_print_cache_map(const struct topology_t *topo, topology_output_t output)
+{
+	struct cache_instance_t *list;
+	uint32_t count = cache_instances(topo, &list);
+	uint32_t bufsize = topo->count * 12 + 1;
+	char *buffer = (char *)malloc(bufsize);
+	uint32_t k, i;
+
+	assert(buffer);
+
+	switch (output) {
+	case TOPOLOGY_OUTPUT_CPUSET:
+		for (k = 0; k < count; k++) {
+			const struct cache_instance_t *inst = &list[k];
+			printf("L%d%s %u %s\n", inst->cache->desc.level,
+			       cache_type_suffix(inst->cache->desc.type), inst->index,
+			       topology_format_cpus(inst->cpus, inst->count, buffer, bufsize));
+		}
+		break;
+	case TOPOLOGY_OUTPUT_JSON:
+		printf("{\n  \"caches\": [");
+		for (k = 0; k < count; k++) {
+			const struct cache_instance_t *inst = &list[k];
+			printf("%s\n    { \"level\": %d, \"type\": \"%s\", \"index\": %u, \"id\": %u, "
+			       "\"package\": %u, \"size_kb\": %u, \"cpuset\": \"%s\", \"cpus\": [",
+			       k ? "," : "", inst->cache->desc.level,
+			       cache_type_name(inst->cache->desc.type), inst->index,
+			       inst->cache->id, inst->package, inst->cache->desc.size,
+			       topology_format_cpus(inst->cpus, inst->count, buffer, bufsize));
+			for (i = 0; i < inst->count; i++)
+				printf("%s%u", i ? ", " : "", inst->cpus[i]);
+			printf("] }");
+		}
+		printf("\n  ]\n}\n");
+		break;
+	default:
+		printf("Cache sharing map (%u instances):\n", count);
+		for (k = 0; k < count; k++) {
+			const struct cache_instance_t *inst = &list[k];
+			printf("  L%d %-11s #%-3u %7u KB, package %u: CPUs %s\n",
+			       inst->cache->desc.level, cache_type_name(inst->cache->desc.type),
+			       inst->index, inst->cache->desc.size, inst->package,
+			       topology_format_cpus(inst->cpus, inst->count, buffer, bufsize));
+		}
+		printf("\n");
+		break;
+	}
+
+	free(buffer);
+	free_cache_instances(list, count);
+}
+
+static const char *core_type_key(uint8_t core_type)
+{
+	switch (core_type) {
+	case 0x20:
+		return "efficient";
+	case 0x40:
+		return "performance";
+	default:
+		return "uniform";
+	}
+}
+
+/* Collects the CPUs of one core type into 'cpus', and numbers the distinct
+ * L2 instances among them in 'l2' (parallel to 'cpus').
+ */
+static uint32_t core_type_cpus(const struct topology_t *topo, uint8_t core_type,
+                               uint32_t *cpus, uint32_t *l2, uint32_t *l2_count)
+{
+	uint32_t i, j, count = 0;
+
+	*l2_count = 0;
+	for (i = 0; i < topo->count; i++) {
+		if (topo->cpus[i].core_type != core_type)
+			continue;
+		cpus[count] = i;
+		l2[count] = UINT32_MAX;
+		for (j = 0; j < count; j++) {
+			if (topology_shares_cache(topo, cpus[j], i, L2)) {
+				l2[count] = l2[j];
+				break;
+			}
+		}
+		if (l2[count] == UINT32_MAX)
+			l2[count] = (*l2_count)++;
+		count++;
+	}
+	return count;
+}
+
+void topology_print_core_types(const struct topology_t *topo, topology_output_t output)
+{
+	uint32_t *cpus = (uint32_t *)malloc(topo->count * sizeof(uint32_t));
+	uint32_t *l2 = (uint32_t *)malloc(topo->count * sizeof(uint32_t));
+	uint32_t *members = (uint32_t *)malloc(topo->count * sizeof(uint32_t));
+	uint32_t bufsize = topo->count * 12 + 1;
+	char *buffer = (char *)malloc(bufsize);
+	uint8_t types[256];
+	uint32_t ntypes = 0, t, i, g, m;
+
+	assert(cpus && l2 && members && buffer);
+
+	/* Core types in order of first appearance. */
+	for (i = 0; i < topo->count; i++) {
+		for (t = 0; t < ntypes; t++)
+			if (types[t] == topo->cpus[i].core_type)
+				break;
+		if (t == ntypes)
+			types[ntypes++] = topo->cpus[i].core_type;
+	}
+
+	if (output == TOPOLOGY_OUTPUT_JSON)
+		printf("{\n  \"hybrid\": %s,\n  \"types\": [", (ntypes > 1 || types[0]) ? "true" : "false");
+	else if (output == TOPOLOGY_OUTPUT_TEXT)
+		printf("Core types:\n");
+
+	for (t = 0; t < ntypes; t++) {
+		uint32_t l2_count, count = core_type_cpus(topo, types[t], cpus, l2, &l2_count);
+		const struct topology_cpu_t *first = &topo->cpus[cpus[0]];
+
+		topology_format_cpus(cpus, count, buffer, bufsize);
+		switch (output) {
+		case TOPOLOGY_OUTPUT_CPUSET:
+			printf("%s %s\n", core_type_key(types[t]), buffer);
+			break;
+		case TOPOLOGY_OUTPUT_JSON:
+			printf("%s\n    { \"type\": \"%s\", \"core_type\": %u, \"native_model\": %u, \"cpuset\": \"%s\", \"l2_groups\": [",
+			       t ? "," : "", core_type_key(types[t]), types[t], first->native_model, buffer);
+			break;
+		default:
+			if (types[t])
+				printf("  %s, native model 0x%06x:\n", hybrid_core_type_name(types[t]), first->native_model);
+			else
+				printf("  All CPUs (not a hybrid processor):\n");
+			printf("    CPUs: %s\n    L2 groups:", buffer);
+			break;
+		}
+		if (output == TOPOLOGY_OUTPUT_CPUSET)
+			continue;
+
+		for (g = 0; g < l2_count; g++) {
+			for (i = 0, m = 0; i < count; i++)
+				if (l2[i] == g)
+					members[m++] = cpus[i];
+			topology_format_cpus(members, m, buffer, bufsize);
+			if (output == TOPOLOGY_OUTPUT_JSON)
+				printf("%s\"%s\"", g ? ", " : "", buffer);
+			else
+				printf(" {%s}", buffer);
+		}
+		printf(output == TOPOLOGY_OUTPUT_JSON ? "] }" : "\n");
+	}
+
+	if (output == TOPOLOGY_OUTPUT_JSON)
+		printf("\n  ]\n}\n");
+	else if (output == TOPOLOGY_OUTPUT_TEXT)
+		printf("\n");
+
+	free(buffer);
+	free(members);
+	free(l2);
+	free(cpus);
+}
+
+const struct topology_cache_t *topology_cache(const struct topology_cpu_t *cpu, cache_level_t level)
+{
+	uint32_t i;
+	for (i = 0; i < cpu->cache_count; i++) {
+		const struct topology_cache_t *cache = &cpu->caches[i];
+		if (cache->desc.level == level && cache->desc.type != CODE)
+			return cache;
+	}
+	return NULL;
+}
+
+int topology_shares_cache(const struct topology_t *topo, uint32_t a, uint32_t b, cache_level_t level)
+{
+	const struct topology_cache_t *x = topology_cache(&topo->cpus[a], level);
+	const struct topology_cache_t *y = topology_cache(&topo->cpus[b], level);
+	if (!x || !y)
+		return 0;
+	return x->id == y->id && topo->cpus[a].package == topo->cpus[b].package;
+}
+
+char *topology_format_cpus(const uint32_t *cpus, uint32_t count, char *buffer, size_t bufsize)
+{
+	char range[32];
+	uint32_t i, start;
+
+	buffer[0] = 0;
+	for (i = 0; i < count; i = start) {
+		start = i + 1;
+		while (start < count && cpus[start] == cpus[start - 1] + 1)
+			start++;
+		if (start - i > 1)
+			sprintf(range, "%s%u-%u", i ? "," : "", cpus[i], cpus[start - 1]);
+		else
+			sprintf(range, "%s%u", i ? "," : "", cpus[i]);
+		safe_strcat(buffer, range, bufsize);
+	}
+	return buffer;
+}
+
+void topology_free(struct topology_t *topo)
+{
+	free(topo->cpus);
+	topo->cpus = NULL;
+	topo->count = 0;
+}
+
+/* vim: set ts=4 sts=4 sw=4 noet: */
@@ -0,0 +1,144 @@
+/*
+ * CPUID
+ *
+ * A simple and small tool to dump/decode CPUID information.
+ *
+ * Copyright (c) 2010-2025, Steven Noonan <steven@uplinklabs.net>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef __topology_h
+#define __topology_h
+
+#include "cache.h"
+
+struct cpuid_state_t;
+
+#define TOPOLOGY_MAX_CACHES 8
+
+/* One cache as seen from one logical CPU. Every CPU that reports the same
+ * level, type and id shares the same physical instance.
+ */
+struct topology_cache_t {
+	struct cache_desc_t desc;
+	uint32_t id;         /* APIC ID with the sharing bits shifted out */
+};
+
+/* Levels of the APIC ID hierarchy, from the innermost out. They match the
+ * level types of leaf 0x1F, minus one.
+ */
+typedef enum {
+	TOPOLOGY_THREAD = 0,
+	TOPOLOGY_CORE,
+	TOPOLOGY_MODULE,
+	TOPOLOGY_TILE,
+	TOPOLOGY_DIE,
+	TOPOLOGY_DIEGRP,
+	TOPOLOGY_PACKAGE,
+	TOPOLOGY_LEVELS
+} topology_level_t;
+
+struct topology_cpu_t {
+	uint32_t cpu;        /* OS logical CPU index */
+	uint32_t apic_id;    /* x2APIC ID, or the initial APIC ID from leaf 1 */
+
+	/* Index of this CPU at each level, within the enclosing level. */
+	uint32_t ids[TOPOLOGY_LEVELS];
+
+	/* Shorthands used all over: the package, the core number within the
+	 * package (every APIC ID bit between the thread and package fields),
+	 * and the thread within the core.
+	 */
+	uint32_t package;
+	uint32_t core;
+	uint32_t thread;
+
+	uint32_t node;       /* AMD node ID from leaf 0x8000001E, or 0 */
+	uint8_t core_type;   /* leaf 0x1A core type (0x20 Atom, 0x40 Core), or 0 */
+	uint32_t native_model;
+	uint32_t cache_count;
+	struct topology_cache_t caches[TOPOLOGY_MAX_CACHES];
+};
+
+struct topology_t {
+	uint32_t count;
+	uint32_t vendor;
+	uint32_t source;       /* leaf the hierarchy was decoded from */
+
+	/* APIC ID bits covering each level and everything below it. A level
+	 * the CPU doesn't report has the same shift as the one below, and so
+	 * a zero-width field.
+	 */
+	uint8_t shift[TOPOLOGY_LEVELS];
+	uint32_t reported;     /* bitmask of levels enumerated by the CPU */
+	struct topology_cpu_t *cpus;
+};
+
+/* Binds to each logical CPU in turn and decodes its APIC ID into package,
+ * core and thread indices. Works with any cpuid_call/thread_bind backend,
+ * so dumps loaded from a file can be described too.
+ */
+int topology_probe(struct cpuid_state_t *state, struct topology_t *topo);
+void topology_free(struct topology_t *topo);
+
+/* Decodes the caches of the CPU the caller is bound to into cpu->caches,
+ * from leaf 4 or 0x8000001D, whichever the vendor fills in.
+ */
+void topology_probe_cpu_caches(struct cpuid_state_t *state, struct topology_cpu_t *cpu);
+
+typedef enum {
+	TOPOLOGY_OUTPUT_TEXT = 0,
+	TOPOLOGY_OUTPUT_JSON,
+	TOPOLOGY_OUTPUT_CPUSET
+} topology_output_t;
+
+const char *topology_level_name(topology_level_t level);
+
+/* Prints the package/die/.../thread tree with the OS CPU numbers at its
+ * leaves, either as indented text or as nested JSON.
+ */
+void topology_print_tree(const struct topology_t *topo);
+void topology_print_json(const struct topology_t *topo);
+
+/* Lists every physical cache instance with the logical CPUs sharing it.
+ * The cpuset form prints one "<cache> <index> <cpulist>" line per instance,
+ * where cpulist is in the format cpuset(7) and taskset -c accept.
+ */
+void topology_print_cache_map(const struct topology_t *topo, topology_output_t output);
+
+/* Lists the CPUs of each hybrid core type (leaf 0x1A), split further into
+ * the groups that share an L2, as E-core clusters do.
+ */
+void topology_print_core_types(const struct topology_t *topo, topology_output_t output);
+
+/* Returns the data or unified cache at the given level, or NULL. */
+const struct topology_cache_t *topology_cache(const struct topology_cpu_t *cpu, cache_level_t level);
+
+/* Nonzero if both CPUs sit behind the same data/unified cache at 'level'. */
+int topology_shares_cache(const struct topology_t *topo, uint32_t a, uint32_t b, cache_level_t level);
+
+/* Sorts 'count' elements of 'size' bytes with a comparison that can look
+ * CPUs up in 'topo'. The sort is stable.
+ */
+typedef int (*topology_compare_t)(const struct topology_t *topo, const void *a, const void *b);
+void topology_sort(const struct topology_t *topo, void *base, size_t count, size_t size,
+                   topology_compare_t compare);
+
+/* Formats a sorted list of CPU numbers in cpuset list form ("0-3,8,10-11"). */
+char *topology_format_cpus(const uint32_t *cpus, uint32_t count, char *buffer, size_t bufsize);
+
+#endif
+
+/* vim: set ts=4 sts=4 sw=4 noet: */